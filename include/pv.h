@@ -16,14 +16,29 @@
 #include <ios>
 #include <set>
 #include <map>
+#include <vector>
 #include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <typeinfo>
+#include <typeindex>
+#include <cxxabi.h>
 #include <algorithm>
 #include <utility>
+#include <functional>
 #include <string>
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <iomanip>
 #include <cstdint>
+#include <cstring>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/wait.h>
 
 #ifndef _PV_H_
 #define _PV_H_
@@ -33,11 +48,24 @@
 #include "pv_bitwidth.h"        // defines a bitwidth template class along with a 
                                 // templated function to compute bit width
 #include "pv_value.h"           // defines classes related to Verilog values
+#include "pv_bits.h"            // defines pv::Bits<N>, an arbitrary width bit vector type
+#include "pv_logic.h"           // defines pv::Logic<N>, a four-state (0/1/x/z) logic vector type
+#include "pv_lanes.h"           // defines pv::Lanes<T, K>, K lanes of T simulated in lock step
 #include "pv_module.h"          // defines "Module" superclass
+#include "pv_state.h"           // defines pv::StateHolder (signal state save/restore for checkpoints)
+#include "pv_profile.h"         // defines pv::cycle_clock and pv::Profiler (per-module eval() profiling)
+#include "pv_trace_event.h"     // defines pv::TraceEventWriter (Chrome trace-event export of sim phases)
+#include "pv_signal_pool.h"     // defines pv::SignalPool (struct-of-arrays wire storage, PV_SOA_SIGNALS)
 #include "pv_wires.h"           // defines WireBase, WireTemplateBase superclasses; 
                                 // defines Wire, QWire, Input, and Output classes
 #include "pv_register.h"        // defines RegisterBase superclass and templated Register class.
+#include "pv_memory.h"          // defines the Memory<T, Depth> template class (RAM/ROM primitive)
+#include "pv_fifo.h"            // defines the Fifo<T, Depth> template class (synchronous FIFO primitive)
+#include "pv_register_array.h"  // defines the RegisterArray<T, N> template class (register banks)
 #include "pv_vcd.h"             // defines vcd::writer class, a VCD file writer
 #include "pv_testbench.h"       // defines Testbench superclass, a special type of Module
+#include "pv_batch.h"           // defines pv::BatchRunner (independent testbenches on a thread pool)
+#include "pv_coroutine.h"       // defines pv::Stimulus coroutines and their scheduler (C++20 only)
+#include "pv_transaction.h"     // defines TransactionDriver and pv::TransactionMonitor/Checker (transaction ports)
 
 #endif // _PV_H_
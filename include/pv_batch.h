@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2023 Michael C Shebanow
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <atomic>
+#include <thread>
+#include <functional>
+
+#ifndef _PV_BATCH_H_
+#define _PV_BATCH_H_
+
+/*
+ * Batch simulation.
+ *
+ * pv::BatchRunner runs many small, independent testbenches (e.g., the unit
+ * tests of the blocks of a design) in one process, across a pool of worker
+ * threads. Each job is a factory that constructs a Testbench, plus an optional
+ * run function (by default, the job calls simulation()). A testbench is
+ * constructed, run, and destroyed by a single worker thread, and testbenches
+ * share no simulation state: the only library state shared between instances
+ * (the signal name table and the VCD string printers) is synchronized.
+ * Models and testbenches must likewise not share mutable globals, and value
+ * change traces of different testbenches (printed to std::cout) interleave.
+ *
+ * run() returns one pv::BatchResult per job, in the order the jobs were added;
+ * print_summary() prints the aggregate. Programs using a BatchRunner must be
+ * linked with -pthread.
+ */
+
+namespace pv {
+
+    // Result of one job of a BatchRunner.
+    struct BatchResult {
+        std::string name;                       // job name
+        bool completed;                         // true if the run returned (did not throw)
+        int exit_code;                          // value returned by the run (see Testbench::simulation())
+        std::string error;                      // error string of the testbench, or the exception thrown
+        uint32_t clocks;                        // clock number at the end of the run
+        SimulationStats stats;                  // simulation statistics of the testbench
+
+        // A job passes if its run returned SIM_NORMAL_EXIT (hitting the cycle limit does not pass).
+        inline bool passed() const { return completed && exit_code == 0; }
+    };
+
+    // Runner of independent testbenches across a thread pool.
+    class BatchRunner {
+    public:
+        // Job factory (returns a new Testbench, deleted by the runner) and run function.
+        typedef std::function<Testbench*()> Factory;
+        typedef std::function<int(Testbench& tb)> RunFunction;
+
+        // Constructor: number of worker threads (0 => one per hardware thread).
+        BatchRunner(const unsigned threads = 0) : num_threads(threads ? threads :
+            std::max(1u, std::thread::hardware_concurrency())), wall_seconds(0.0) {}
+        BatchRunner(const BatchRunner& br) = delete;
+
+        // Add a job. Without a run function, the job calls simulation().
+        void add(const std::string& name, const Factory& factory, const RunFunction& run = RunFunction())
+            { jobs.push_back(Job{ name, factory, run }); }
+        inline size_t size() const { return jobs.size(); }
+        inline unsigned get_threads() const { return num_threads; }
+
+        // Run all jobs, returning their results (in the order the jobs were added).
+        const std::vector<BatchResult>& run() {
+            results.assign(jobs.size(), BatchResult());
+            next_job = 0;
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            std::vector<std::thread> workers;
+            for (unsigned i = 0; i < num_threads && i < jobs.size(); i++)
+                workers.push_back(std::thread(&BatchRunner::worker, this));
+            for (size_t i = 0; i < workers.size(); i++)
+                workers[i].join();
+            wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            return results;
+        }
+        inline const std::vector<BatchResult>& get_results() const { return results; }
+
+        // Aggregate of the last run: jobs passed, statistics summed over all jobs, and wall time.
+        size_t passed() const {
+            size_t n = 0;
+            for (size_t i = 0; i < results.size(); i++)
+                n += results[i].passed();
+            return n;
+        }
+        SimulationStats total_statistics() const {
+            SimulationStats s;
+            for (size_t i = 0; i < results.size(); i++)
+                s.accumulate(results[i].stats);
+            return s;
+        }
+        inline double get_wall_seconds() const { return wall_seconds; }
+
+        // Print a summary of the last run, listing the jobs that did not pass.
+        void print_summary(std::ostream& os) const {
+            const SimulationStats s = total_statistics();
+            char buf[128];
+            os << ">>> Batch: " << results.size() << " testbenches on " << num_threads << " threads: "
+               << passed() << " passed, " << results.size() - passed() << " failed" << std::endl;
+            snprintf(buf, sizeof(buf), "%.6f s (%.1f clocks/second)", wall_seconds,
+                wall_seconds > 0.0 ? s.clocks / wall_seconds : 0.0);
+            os << ">>>   wall time           : " << buf << std::endl;
+            os << ">>>   clocks              : " << s.clocks << std::endl;
+            os << ">>>   eval() calls        : " << s.evals << std::endl;
+            for (size_t i = 0; i < results.size(); i++) {
+                const BatchResult& r = results[i];
+                if (r.passed()) continue;
+                os << ">>>   FAILED " << r.name << ": ";
+                if (r.completed) os << "exit code " << r.exit_code << " at clock " << r.clocks;
+                else os << "exception";
+                if (!r.error.empty()) os << ": " << r.error;
+                os << std::endl;
+            }
+        }
+
+    private:
+        // A job.
+        struct Job {
+            std::string name;
+            Factory factory;
+            RunFunction run;
+        };
+
+        // Worker threads, jobs, index of the next job to run, and results.
+        const unsigned num_threads;
+        std::vector<Job> jobs;
+        std::atomic<size_t> next_job;
+        std::vector<BatchResult> results;
+        double wall_seconds;
+
+        // Worker thread: run jobs until none are left.
+        void worker() {
+            for (size_t i = next_job++; i < jobs.size(); i = next_job++)
+                run_job(jobs[i], results[i]);
+        }
+
+        // Construct, run, and destroy the testbench of one job.
+        static void run_job(const Job& job, BatchResult& r) {
+            r.name = job.name;
+            r.completed = false;
+            r.exit_code = 0;
+            r.clocks = 0;
+            Testbench* tb = NULL;
+            try {
+                tb = job.factory();
+                r.exit_code = job.run ? job.run(*tb) : tb->simulation();
+                r.completed = true;
+                r.error = tb->error_string();
+            } catch (const std::exception& e) {
+                r.error = e.what();
+            }
+            if (tb) {
+                r.clocks = tb->get_clock();
+                r.stats = tb->get_statistics();
+                delete tb;
+            }
+        }
+    };
+
+} // end namespace pv
+
+#endif // _PV_BATCH_H_
@@ -0,0 +1,342 @@
+/*
+ * Copyright (c) 2023 Michael C Shebanow
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <type_traits>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#ifndef _PV_BITS_H_
+#define _PV_BITS_H_
+
+/*
+ * Arbitrary width bit vectors.
+ *
+ * The pv::Bits<N> template class is a fixed width, unsigned bit vector of N
+ * bits, stored as an array of 64-bit words (least significant word first).
+ * Bits beyond N in the top word are always kept zero, so equality is a plain
+ * word compare. Bits<N> can be used as the type of any Wire, QWire, Input,
+ * Output, or Register, making signals wider than 64 bits (cache lines, wide
+ * vector datapaths) first class:
+ *
+ *      Wire<pv::Bits<512>> instance(line);
+ *      Register<pv::Bits<512>> instance(line_q);
+ *
+ * All the usual operators are supported: bitwise (~, &, |, ^), shifts by an
+ * integer, arithmetic (+, -, *, /, %) modulo 2^N, and comparisons. Bits<N> can
+ * be constructed from any integral value (negative values are sign extended),
+ * so it mixes freely with integer constants (e.g., "line + 1").
+ *
+ * Bitwise operators and compares (the operations used for change detection in
+ * wire assignment and register clocking) are word parallel, and use AVX-512 or
+ * AVX2 when compiled for those instruction sets (e.g., -mavx2 or -march=native).
+ *
+ * Specializations of vcd::_bitwidth and vcd::value2string_t are provided so
+ * Bits<N> signals are dumped to VCD files at their full width.
+ */
+
+namespace pv {
+
+    // Word-parallel kernels over 64-bit word arrays; vectorized when AVX2/AVX-512 are available.
+    namespace bits_kernel {
+        inline void op_and(uint64_t* d, const uint64_t* a, const uint64_t* b, const int n) {
+            int i = 0;
+#if defined(__AVX512F__)
+            for (; i + 8 <= n; i += 8)
+                _mm512_storeu_si512((void*) (d + i), _mm512_and_si512(_mm512_loadu_si512((const void*) (a + i)),
+                    _mm512_loadu_si512((const void*) (b + i))));
+#elif defined(__AVX2__)
+            for (; i + 4 <= n; i += 4)
+                _mm256_storeu_si256((__m256i*) (d + i), _mm256_and_si256(_mm256_loadu_si256((const __m256i*) (a + i)),
+                    _mm256_loadu_si256((const __m256i*) (b + i))));
+#endif
+            for (; i < n; i++) d[i] = a[i] & b[i];
+        }
+        inline void op_or(uint64_t* d, const uint64_t* a, const uint64_t* b, const int n) {
+            int i = 0;
+#if defined(__AVX512F__)
+            for (; i + 8 <= n; i += 8)
+                _mm512_storeu_si512((void*) (d + i), _mm512_or_si512(_mm512_loadu_si512((const void*) (a + i)),
+                    _mm512_loadu_si512((const void*) (b + i))));
+#elif defined(__AVX2__)
+            for (; i + 4 <= n; i += 4)
+                _mm256_storeu_si256((__m256i*) (d + i), _mm256_or_si256(_mm256_loadu_si256((const __m256i*) (a + i)),
+                    _mm256_loadu_si256((const __m256i*) (b + i))));
+#endif
+            for (; i < n; i++) d[i] = a[i] | b[i];
+        }
+        inline void op_xor(uint64_t* d, const uint64_t* a, const uint64_t* b, const int n) {
+            int i = 0;
+#if defined(__AVX512F__)
+            for (; i + 8 <= n; i += 8)
+                _mm512_storeu_si512((void*) (d + i), _mm512_xor_si512(_mm512_loadu_si512((const void*) (a + i)),
+                    _mm512_loadu_si512((const void*) (b + i))));
+#elif defined(__AVX2__)
+            for (; i + 4 <= n; i += 4)
+                _mm256_storeu_si256((__m256i*) (d + i), _mm256_xor_si256(_mm256_loadu_si256((const __m256i*) (a + i)),
+                    _mm256_loadu_si256((const __m256i*) (b + i))));
+#endif
+            for (; i < n; i++) d[i] = a[i] ^ b[i];
+        }
+        inline void op_not(uint64_t* d, const uint64_t* a, const int n) {
+            int i = 0;
+#if defined(__AVX512F__)
+            const __m512i ones = _mm512_set1_epi64(-1);
+            for (; i + 8 <= n; i += 8)
+                _mm512_storeu_si512((void*) (d + i), _mm512_xor_si512(_mm512_loadu_si512((const void*) (a + i)), ones));
+#elif defined(__AVX2__)
+            const __m256i ones = _mm256_set1_epi64x(-1);
+            for (; i + 4 <= n; i += 4)
+                _mm256_storeu_si256((__m256i*) (d + i), _mm256_xor_si256(_mm256_loadu_si256((const __m256i*) (a + i)), ones));
+#endif
+            for (; i < n; i++) d[i] = ~a[i];
+        }
+        inline bool equal(const uint64_t* a, const uint64_t* b, const int n) {
+            int i = 0;
+#if defined(__AVX512F__)
+            for (; i + 8 <= n; i += 8)
+                if (_mm512_cmpneq_epi64_mask(_mm512_loadu_si512((const void*) (a + i)),
+                    _mm512_loadu_si512((const void*) (b + i))))
+                        return false;
+#elif defined(__AVX2__)
+            for (; i + 4 <= n; i += 4) {
+                __m256i x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*) (a + i)),
+                    _mm256_loadu_si256((const __m256i*) (b + i)));
+                if (!_mm256_testz_si256(x, x))
+                    return false;
+            }
+#endif
+            for (; i < n; i++)
+                if (a[i] != b[i]) return false;
+            return true;
+        }
+        inline bool is_zero(const uint64_t* a, const int n) {
+            uint64_t acc = 0;
+            for (int i = 0; i < n; i++) acc |= a[i];
+            return acc == 0;
+        }
+    } // end namespace bits_kernel
+
+    // Fixed width bit vector.
+    template <int N>
+    class Bits {
+        static_assert(N > 0, "pv::Bits<N> requires N > 0");
+    public:
+        // Geometry.
+        static const int width = N;
+        static const int num_words = (N + 63) / 64;
+        static const uint64_t top_mask = (N % 64) ? ((1ull << (N % 64)) - 1) : ~0ull;
+
+        // Constructors: zero, from any integral value (sign extended), and from other widths (explicit).
+        Bits() { std::memset(w, 0, sizeof(w)); }
+        template <typename U, typename std::enable_if<std::is_integral<U>::value || std::is_enum<U>::value, int>::type = 0>
+        Bits(const U v) {
+            const uint64_t fill = (std::is_signed<U>::value && (int64_t) v < 0) ? ~0ull : 0ull;
+            w[0] = (uint64_t) (int64_t) v;
+            for (int i = 1; i < num_words; i++) w[i] = fill;
+            mask_top();
+        }
+        template <int M>
+        explicit Bits(const Bits<M>& b) {
+            for (int i = 0; i < num_words; i++) w[i] = (i < Bits<M>::num_words) ? b.word(i) : 0ull;
+            mask_top();
+        }
+
+        // Word and bit access.
+        inline uint64_t word(const int i) const { return w[i]; }
+        inline void set_word(const int i, const uint64_t v) { w[i] = v; if (i == num_words - 1) mask_top(); }
+        inline uint64_t* words() { return w; }
+        inline const uint64_t* words() const { return w; }
+        inline bool bit(const int i) const { return (w[i >> 6] >> (i & 63)) & 1ull; }
+        inline void set_bit(const int i, const bool b) {
+            if (b) w[i >> 6] |= 1ull << (i & 63);
+            else w[i >> 6] &= ~(1ull << (i & 63));
+        }
+
+        // Conversions.
+        inline uint64_t to_uint64() const { return w[0]; }
+        explicit inline operator bool() const { return !bits_kernel::is_zero(w, num_words); }
+        inline bool operator!() const { return bits_kernel::is_zero(w, num_words); }
+
+        // Bitwise operators.
+        inline Bits operator~() const { Bits r; bits_kernel::op_not(r.w, w, num_words); r.mask_top(); return r; }
+        inline Bits operator&(const Bits& b) const { Bits r; bits_kernel::op_and(r.w, w, b.w, num_words); return r; }
+        inline Bits operator|(const Bits& b) const { Bits r; bits_kernel::op_or(r.w, w, b.w, num_words); return r; }
+        inline Bits operator^(const Bits& b) const { Bits r; bits_kernel::op_xor(r.w, w, b.w, num_words); return r; }
+        inline Bits& operator&=(const Bits& b) { bits_kernel::op_and(w, w, b.w, num_words); return *this; }
+        inline Bits& operator|=(const Bits& b) { bits_kernel::op_or(w, w, b.w, num_words); return *this; }
+        inline Bits& operator^=(const Bits& b) { bits_kernel::op_xor(w, w, b.w, num_words); return *this; }
+
+        // Shifts.
+        Bits operator<<(const int s) const {
+            Bits r;
+            if (s < 0) return s <= -N ? r : *this >> -s;
+            if (s >= N) return r;
+            const int ws = s >> 6, bs = s & 63;
+            for (int i = num_words - 1; i >= ws; i--) {
+                uint64_t v = w[i - ws] << bs;
+                if (bs && i - ws - 1 >= 0) v |= w[i - ws - 1] >> (64 - bs);
+                r.w[i] = v;
+            }
+            r.mask_top();
+            return r;
+        }
+        Bits operator>>(const int s) const {
+            Bits r;
+            if (s < 0) return s <= -N ? r : *this << -s;
+            if (s >= N) return r;
+            const int ws = s >> 6, bs = s & 63;
+            for (int i = 0; i + ws < num_words; i++) {
+                uint64_t v = w[i + ws] >> bs;
+                if (bs && i + ws + 1 < num_words) v |= w[i + ws + 1] << (64 - bs);
+                r.w[i] = v;
+            }
+            return r;
+        }
+        inline Bits& operator<<=(const int s) { *this = *this << s; return *this; }
+        inline Bits& operator>>=(const int s) { *this = *this >> s; return *this; }
+
+        // Arithmetic (modulo 2^N).
+        Bits operator+(const Bits& b) const {
+            Bits r;
+            uint64_t carry = 0;
+            for (int i = 0; i < num_words; i++) {
+                uint64_t s = w[i] + carry;
+                carry = (s < carry);
+                r.w[i] = s + b.w[i];
+                carry += (r.w[i] < s);
+            }
+            r.mask_top();
+            return r;
+        }
+        Bits operator-(const Bits& b) const {
+            Bits r;
+            uint64_t borrow = 0;
+            for (int i = 0; i < num_words; i++) {
+                uint64_t d = w[i] - b.w[i];
+                uint64_t nb = (w[i] < b.w[i]);
+                r.w[i] = d - borrow;
+                nb += (d < borrow);
+                borrow = nb;
+            }
+            r.mask_top();
+            return r;
+        }
+        inline Bits operator-() const { return Bits() - *this; }
+        Bits operator*(const Bits& b) const {
+            // Schoolbook multiplication on 32-bit limbs, truncated to N bits.
+            const int nl = num_words * 2;
+            uint32_t a32[nl], b32[nl], r32[nl];
+            for (int i = 0; i < num_words; i++) {
+                a32[2*i] = (uint32_t) w[i]; a32[2*i+1] = (uint32_t) (w[i] >> 32);
+                b32[2*i] = (uint32_t) b.w[i]; b32[2*i+1] = (uint32_t) (b.w[i] >> 32);
+            }
+            std::memset(r32, 0, sizeof(r32));
+            for (int i = 0; i < nl; i++) {
+                uint64_t carry = 0;
+                if (!a32[i]) continue;
+                for (int j = 0; i + j < nl; j++) {
+                    uint64_t t = (uint64_t) a32[i] * b32[j] + r32[i+j] + carry;
+                    r32[i+j] = (uint32_t) t;
+                    carry = t >> 32;
+                }
+            }
+            Bits r;
+            for (int i = 0; i < num_words; i++) r.w[i] = (uint64_t) r32[2*i] | ((uint64_t) r32[2*i+1] << 32);
+            r.mask_top();
+            return r;
+        }
+        Bits operator/(const Bits& b) const { Bits q, r; divmod(b, q, r); return q; }
+        Bits operator%(const Bits& b) const { Bits q, r; divmod(b, q, r); return r; }
+        inline Bits& operator+=(const Bits& b) { *this = *this + b; return *this; }
+        inline Bits& operator-=(const Bits& b) { *this = *this - b; return *this; }
+        inline Bits& operator*=(const Bits& b) { *this = *this * b; return *this; }
+        inline Bits& operator/=(const Bits& b) { *this = *this / b; return *this; }
+        inline Bits& operator%=(const Bits& b) { *this = *this % b; return *this; }
+        inline Bits& operator++() { *this = *this + Bits(1); return *this; }
+        inline Bits& operator--() { *this = *this - Bits(1); return *this; }
+        inline Bits operator++(int) { Bits t = *this; ++*this; return t; }
+        inline Bits operator--(int) { Bits t = *this; --*this; return t; }
+
+        // Comparisons (unsigned).
+        inline bool operator==(const Bits& b) const { return bits_kernel::equal(w, b.w, num_words); }
+        inline bool operator!=(const Bits& b) const { return !bits_kernel::equal(w, b.w, num_words); }
+        inline bool operator<(const Bits& b) const {
+            for (int i = num_words - 1; i >= 0; i--)
+                if (w[i] != b.w[i]) return w[i] < b.w[i];
+            return false;
+        }
+        inline bool operator>(const Bits& b) const { return b < *this; }
+        inline bool operator<=(const Bits& b) const { return !(b < *this); }
+        inline bool operator>=(const Bits& b) const { return !(*this < b); }
+
+        // Hex string (no prefix), most significant digit first.
+        std::string to_hex_string() const {
+            static const char digits[] = "0123456789abcdef";
+            std::string str;
+            for (int i = (N - 1) / 4; i >= 0; i--)
+                str += digits[(w[(i * 4) >> 6] >> ((i * 4) & 63)) & 0xf];
+            return str;
+        }
+
+    private:
+        // Storage: least significant word first.
+        uint64_t w[num_words];
+
+        // Clear bits above N in the top word.
+        inline void mask_top() { w[num_words - 1] &= top_mask; }
+
+        // Unsigned long division (shift-subtract). Division by zero yields all ones and the dividend.
+        void divmod(const Bits& d, Bits& q, Bits& r) const {
+            q = Bits(); r = Bits();
+            if (!d) { q = ~Bits(); r = *this; return; }
+            for (int i = N - 1; i >= 0; i--) {
+                r = r << 1;
+                r.set_bit(0, bit(i));
+                if (r >= d) { r = r - d; q.set_bit(i, true); }
+            }
+        }
+    };
+
+    // Streaming (hex).
+    template <int N>
+    inline std::ostream& operator<<(std::ostream& os, const Bits<N>& b) { return os << "0x" << b.to_hex_string(); }
+
+} // end namespace pv
+
+namespace vcd {
+
+    // Bit width of pv::Bits<N>.
+    template <int N>
+    struct _bitwidth<pv::Bits<N> > {
+        static constexpr int width = N;
+    };
+
+    // VCD string printer of pv::Bits<N>: prints "w" bits (the signal width).
+    template <int N>
+    struct value2string_t<pv::Bits<N> > : public value2string_base_t {
+        value2string_t(const pv::Bits<N>& v) : value2string_base_t(N) {}
+        std::string operator()(const pv::Bits<N>& v, const bool add_b_prefix = true) const {
+            std::string str;
+            if (add_b_prefix && w > 1) str += "b";
+            for (int i = w - 1; i >= 0; i--)
+                str += (i < N && v.bit(i)) ? "1" : "0";
+            return str;
+        }
+    };
+
+} // end namespace vcd
+
+#endif // _PV_BITS_H_
@@ -13,6 +13,7 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <type_traits>
 
  #ifndef _PV_BITWIDTH_H_
  #define _PV_BITWIDTH_H_
@@ -20,37 +21,66 @@
 /*
  * The bitwidth class is used to determine the width in bits of a particular data type.
  * Note: users can extend the class through other partial specializations of the template base class.
- * Typically required when computing the bit width of custom data types.
+ * Typically required when computing the bit width of custom data types. A specialization
+ * must define a compile-time constant "width", e.g.:
+ *
+ *      template <> struct _bitwidth<my_type> { static constexpr int width = 12; };
+ *
  * The VCD namespace is used for the bitwidth class as usage is related to dumping VCD files.
+ *
+ * The pv::width_mask class applies a declared bit width W to values of an integral or
+ * enum type T: the value is truncated to its W low order bits. As with a Verilog
+ * "reg [W-1:0]", the result is unsigned (i.e., it is not sign extended even if T is
+ * a signed type). The mask is a compile-time constant; for other types, for W <= 0, or
+ * for W not less than the width of T, the mask is an identity that returns its
+ * argument unchanged.
  */
 
 namespace vcd {
 
-    // Template class and template function used to determine a number of HW bits based on a type.
-    template <typename T>
-    extern int bitwidth();    
-
     // Generic type inference.
     template <typename T>
     struct _bitwidth {
-        _bitwidth() : width(sizeof(T) << 3) {}
-        const int width;
+        static constexpr int width = sizeof(T) << 3;
     }; 
+    template <typename T>
+    constexpr int _bitwidth<T>::width;
 
     // T is bool.
     template <>
     struct _bitwidth<bool> {
-        _bitwidth() : width(1) {}
-        const int width;
+        static constexpr int width = 1;
     };
 
     // Template function to return # of bits in a type through type inference
     template <typename T>
-    inline int bitwidth() {
-        _bitwidth<T> bw;
-        return bw.width;
-    }
+    constexpr int bitwidth() { return _bitwidth<T>::width; }
 
 } // end namespace vcd
 
+namespace pv {
+
+    // Unsigned integer type used to mask values of type T (integral or enum).
+    template <typename T, bool = std::is_enum<T>::value>
+    struct mask_type { typedef typename std::make_unsigned<T>::type type; };
+    template <typename T>
+    struct mask_type<T, true> { typedef typename std::make_unsigned<typename std::underlying_type<T>::type>::type type; };
+
+    // Identity mask: W is unspecified, not narrower than T, or T is not an integral or enum type.
+    template <typename T, int W, bool = ((std::is_integral<T>::value || std::is_enum<T>::value) &&
+        !std::is_same<T, bool>::value && (W > 0) && (W < (int) (sizeof(T) << 3)))>
+    struct width_mask {
+        static inline const T& apply(const T& v) { return v; }
+    };
+
+    // Truncating mask.
+    template <typename T, int W>
+    struct width_mask<T, W, true> {
+        typedef typename mask_type<T>::type U;
+        static constexpr U mask = (U(1) << W) - 1;
+        static inline T apply(const T& v) { return (T) ((U) v & mask); }
+    };
+
+} // end namespace pv
+
  #endif //  _PV_BITWIDTH_H_
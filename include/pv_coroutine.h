@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2023 Michael C Shebanow
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#if __cplusplus >= 202002L && defined(__cpp_impl_coroutine)
+#include <coroutine>
+#include <exception>
+#endif
+
+#ifndef _PV_COROUTINE_H_
+#define _PV_COROUTINE_H_
+
+/*
+ * Coroutine stimulus (C++20).
+ *
+ * Rather than encoding stimulus as a state machine spread over eval(),
+ * pre_clock(), and post_clock(), a testbench compiled as C++20 can write it as
+ * sequential code in a coroutine returning pv::Stimulus:
+ *
+ *      pv::Stimulus drive() {
+ *          dut.start = true;
+ *          co_await pv::clocks(1);
+ *          dut.start = false;
+ *          co_await pv::until(dut.ready);
+ *          if (dut.result != 42) end_simulation(1, "bad result");
+ *      }
+ *
+ * A pv::StimulusScheduler is a pv::ClockAgent of the testbench that runs the
+ * coroutines given to spawn(), in the testbench's thread (resuming a coroutine
+ * is a function call, not a thread switch). Coroutine code runs in one of two
+ * clock phases:
+ *  - pre-clock (right after Testbench::pre_clock()): where coroutines start,
+ *    and where co_await pv::clocks(n) and co_await pv::until(c) resume. This
+ *    is the phase to drive inputs, which take effect at the clock's edge.
+ *    Signals still hold the values they settled to in the previous clock;
+ *  - post-clock (right after Testbench::post_clock()): where co_await
+ *    pv::settled() resumes, once the wires of the current clock have settled.
+ *    This is the phase to sample and check outputs.
+ *
+ * pv::clocks(n) resumes n clocks later (pv::clocks(0) does not suspend).
+ * pv::until(c) resumes at the first pre-clock phase at which c is true, where
+ * c is a signal (or another lvalue convertible to bool, which is referenced) or
+ * a callable returning bool (which is copied); it does not suspend if c is
+ * already true. A temporary value, e.g. pv::until(x == 1), would never change
+ * and is rejected at compile time: write pv::until([&] { return x == 1; }).
+ * A coroutine can also co_await another pv::Stimulus, running it as a
+ * subroutine. Coroutines resume in the order they were spawned (or started
+ * waiting), and an exception escaping a spawned coroutine propagates out of
+ * simulation().
+ *
+ * The pre_clock()/post_clock() path of C++11 testbenches is unchanged; without
+ * C++20 coroutine support, this header defines nothing. Coroutine state is not
+ * part of checkpoints or snapshots.
+ */
+
+#if __cplusplus >= 202002L && defined(__cpp_impl_coroutine)
+
+namespace pv {
+
+    class StimulusScheduler;
+
+    // Coroutine of stimulus code (see above).
+    class Stimulus {
+    public:
+        struct promise_type {
+            StimulusScheduler* scheduler = nullptr;     // scheduler running the coroutine
+            std::coroutine_handle<> continuation;       // coroutine awaiting this one, if any
+            std::exception_ptr exception;               // exception escaping the coroutine
+
+            Stimulus get_return_object() { return Stimulus(std::coroutine_handle<promise_type>::from_promise(*this)); }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            auto final_suspend() noexcept {
+                // Resume the awaiting coroutine, if any (symmetric transfer).
+                struct awaiter {
+                    bool await_ready() noexcept { return false; }
+                    std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                        std::coroutine_handle<> c = h.promise().continuation;
+                        return c ? c : std::noop_coroutine();
+                    }
+                    void await_resume() noexcept {}
+                };
+                return awaiter{};
+            }
+            void return_void() {}
+            void unhandled_exception() { exception = std::current_exception(); }
+        };
+        typedef std::coroutine_handle<promise_type> handle_type;
+
+        Stimulus(Stimulus&& s) noexcept : handle(s.handle) { s.handle = nullptr; }
+        Stimulus(const Stimulus& s) = delete;
+        Stimulus& operator=(const Stimulus& s) = delete;
+        ~Stimulus() { if (handle) handle.destroy(); }
+
+        // Await another stimulus coroutine: run it to completion, then continue.
+        auto operator co_await() && noexcept {
+            struct awaiter {
+                handle_type child;
+                bool await_ready() noexcept { return !child || child.done(); }
+                std::coroutine_handle<> await_suspend(const handle_type parent) noexcept {
+                    child.promise().scheduler = parent.promise().scheduler;
+                    child.promise().continuation = parent;
+                    return child;
+                }
+                void await_resume() {
+                    if (child && child.promise().exception)
+                        std::rethrow_exception(child.promise().exception);
+                }
+            };
+            return awaiter{ handle };
+        }
+
+    private:
+        friend class StimulusScheduler;
+        explicit Stimulus(const handle_type h) : handle(h) {}
+        handle_type handle;
+    };
+
+    // Scheduler of the stimulus coroutines of a testbench.
+    class StimulusScheduler : public ClockAgent {
+    public:
+        // Clock phases in which coroutines resume.
+        enum class Phase { pre_clock, post_clock };
+
+        // Constructor/destructor: adds itself to (removes itself from) the clock agents of tb.
+        StimulusScheduler(Testbench* tb) : tb(tb), phase(Phase::pre_clock) { tb->add_clock_agent(this); }
+        StimulusScheduler(const StimulusScheduler& s) = delete;
+        virtual ~StimulusScheduler() {
+            tb->remove_clock_agent(this);
+            for (size_t i = 0; i < roots.size(); i++)
+                roots[i].destroy();
+        }
+
+        // Start a coroutine at the next pre-clock phase (the scheduler takes ownership of it).
+        void spawn(Stimulus&& s) {
+            Stimulus::handle_type h = s.handle;
+            s.handle = nullptr;
+            if (!h) return;
+            h.promise().scheduler = this;
+            roots.push_back(h);
+            wait(h, Phase::pre_clock, 0, nullptr);
+        }
+
+        // Number of spawned coroutines that have not completed.
+        inline size_t active() const { return roots.size(); }
+
+        // Testbench (for awaiters) and the phase being run.
+        inline Testbench* get_testbench() const { return tb; }
+        inline Phase get_phase() const { return phase; }
+
+        // Suspend h until clock "clock" (in the given phase) and, if given, until cond() is true.
+        void wait(const std::coroutine_handle<> h, const Phase p, const uint32_t clock, std::function<bool()> cond)
+            { waiters.push_back(Waiter{ h, p, clock, std::move(cond) }); }
+
+        // Clock agent calls.
+        void pre_clock(const uint32_t cycle_num) override { run(Phase::pre_clock, cycle_num); }
+        void post_clock(const uint32_t cycle_num) override { run(Phase::post_clock, cycle_num); }
+
+    private:
+        // A suspended coroutine.
+        struct Waiter {
+            std::coroutine_handle<> handle;
+            Phase phase;
+            uint32_t clock;
+            std::function<bool()> cond;
+        };
+
+        // Testbench, phase being run, suspended coroutines, and spawned coroutines.
+        Testbench* tb;
+        Phase phase;
+        std::vector<Waiter> waiters;
+        std::vector<Stimulus::handle_type> roots;
+
+        // Resume the coroutines due in this phase, then reap completed coroutines.
+        void run(const Phase p, const uint32_t cycle_num) {
+            if (waiters.empty()) return;
+            phase = p;
+            std::vector<Waiter> due;
+            due.swap(waiters);
+            std::vector<Waiter> kept;
+            for (size_t i = 0; i < due.size(); i++) {
+                const Waiter& w = due[i];
+                if (w.phase == p && w.clock <= cycle_num && (!w.cond || w.cond()))
+                    w.handle.resume();
+                else
+                    kept.push_back(std::move(due[i]));
+            }
+            waiters.insert(waiters.begin(), std::make_move_iterator(kept.begin()), std::make_move_iterator(kept.end()));
+            reap();
+        }
+
+        // Destroy completed coroutines, rethrowing the first exception that escaped one.
+        void reap() {
+            std::exception_ptr e;
+            size_t n = 0;
+            for (size_t i = 0; i < roots.size(); i++) {
+                if (roots[i].done()) {
+                    if (!e) e = roots[i].promise().exception;
+                    roots[i].destroy();
+                } else
+                    roots[n++] = roots[i];
+            }
+            roots.resize(n);
+            if (e) std::rethrow_exception(e);
+        }
+    };
+
+    // Awaitable of pv::clocks(), pv::settled(), and pv::until().
+    struct StimulusWait {
+        uint32_t clocks;                            // clocks to wait (clocks())
+        bool settle;                                // wait for the post-clock phase (settled())
+        std::function<bool()> cond;                 // condition to wait for (until())
+
+        bool await_ready() { return cond ? cond() : (!settle && clocks == 0); }
+        template <typename P>
+        void await_suspend(std::coroutine_handle<P> h) {
+            StimulusScheduler* s = h.promise().scheduler;
+            const uint32_t now = s->get_testbench()->get_clock();
+            if (settle)
+                s->wait(h, StimulusScheduler::Phase::post_clock,
+                    s->get_phase() == StimulusScheduler::Phase::post_clock ? now + 1 : now, nullptr);
+            else
+                s->wait(h, StimulusScheduler::Phase::pre_clock, now + (cond ? 1 : clocks), cond);
+        }
+        void await_resume() {}
+    };
+
+    // Wait n clocks (resumes in the pre-clock phase).
+    inline StimulusWait clocks(const uint32_t n) { return StimulusWait{ n, false, nullptr }; }
+
+    // Wait for the wires of the current clock to settle (resumes in the post-clock phase).
+    inline StimulusWait settled() { return StimulusWait{ 0, true, nullptr }; }
+
+    // Wait until a signal (or other lvalue) is true or a callable returns true (resumes in the pre-clock
+    // phase). Signals are referenced; callables are copied; temporary values are rejected.
+    template <typename C>
+    inline StimulusWait until(C&& c) {
+        typedef std::decay_t<C> D;
+        if constexpr (std::is_invocable_r_v<bool, const D&>)
+            return StimulusWait{ 0, false, [f = D(std::forward<C>(c))]() { return (bool) f(); } };
+        else {
+            static_assert(std::is_lvalue_reference_v<C>, "pv::until(): the condition must be a signal (or other "
+                "lvalue) or a callable; a temporary value never changes (use a lambda)");
+            return StimulusWait{ 0, false, [&c]() { return (bool) c; } };
+        }
+    }
+
+} // end namespace pv
+
+#endif // C++20 coroutines
+
+#endif // _PV_COROUTINE_H_
@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) 2023 Michael C Shebanow
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <memory>
+
+#ifndef _PV_FIFO_H_
+#define _PV_FIFO_H_
+
+/*
+ * Synchronous FIFO primitive.
+ *
+ * This header defines the Fifo<T, Depth, W> template class, a clocked
+ * first-in first-out queue of up to Depth entries of type T, implemented as a
+ * ring buffer. Like Memory, a Fifo is a single RegisterBase subclass: one
+ * pos_edge() call per clock and O(1) work per push or pop, instead of a
+ * Register per entry plus pointer registers.
+ *
+ * Template arguments:
+ * T - the type of an entry
+ * Depth - capacity (number of entries)
+ * W - optional bit width of an entry; integral and enum values pushed are
+ *     truncated to W bits (see pv::width_mask)
+ *
+ * Pushes and pops are staged like Register's "<=" and committed on the next
+ * positive clock edge: push(v) enqueues v and pop() dequeues the head entry.
+ * At most one push and one pop are staged per clock (staging again replaces
+ * the earlier request). On an edge, the pop is committed before the push, so a
+ * full FIFO can be pushed and popped in the same clock. A push to a full FIFO
+ * (without a pop) or a pop of an empty FIFO is dropped and counted (see
+ * get_overflows() and get_underflows()). As with registers, if the parent
+ * module is re-evaluated within a clock, its staged push and pop are discarded.
+ *
+ * The occupancy outputs empty(), full(), and count() and the head entry
+ * front() reflect the state committed at the last positive edge. The parent
+ * module is triggered only when a positive edge changes the count (and hence
+ * possibly empty/full) or the head entry; a clock that pushes and pops a FIFO
+ * holding several identical entries does not trigger evaluation.
+ *
+ * VCD dumps contain two signals per FIFO: "<name>_count", the occupancy, and
+ * "<name>_head", the head entry ('x' when empty). The second signal uses an
+ * additional VCD ID.
+ */
+
+namespace pv {
+
+    // Number of bits required to represent n.
+    constexpr int bits_to_represent(const uint64_t n) { return n ? 1 + bits_to_represent(n >> 1) : 0; }
+
+} // end namespace pv
+
+template <typename T, uint32_t Depth, int W = -1>
+class Fifo final : public RegisterBase {
+public:
+    // Geometry.
+    static constexpr uint32_t depth = Depth;
+    static constexpr int width = (W > 0) ? W : vcd::bitwidth<T>();
+    static constexpr int count_width = pv::bits_to_represent(Depth);
+    static_assert(Depth > 0, "Fifo depth must be at least 1");
+
+    // Constructors/Destructor.
+    // Disallow default constructor and copy constructor.
+    Fifo(const Module* p, const char* str) : RegisterBase(p, str), entries(new T[Depth])
+        { constructor_common(); }
+    Fifo(const Module* p, const std::string& str) : RegisterBase(p, str), entries(new T[Depth])
+        { constructor_common(); }
+    Fifo() = delete;
+    Fifo(const Fifo& f) = delete;
+    virtual ~Fifo() {}
+
+    // Staged (non-blocking) push and pop.
+    inline void push(const T& v) { push_pending = true; push_value = pv::width_mask<T, W>::apply(v); }
+    inline void pop() { pop_pending = true; }
+
+    // Occupancy and head entry (committed state).
+    inline uint32_t count() const { return num_entries; }
+    inline bool empty() const { return num_entries == 0; }
+    inline bool full() const { return num_entries == Depth; }
+    inline const T& front() const { return entries[head]; }
+    inline bool front_is_x() const { return num_entries == 0; }
+
+    // Entry at position i (0 = head) of the committed state.
+    inline const T& at(const uint32_t i) const {
+        if (i >= num_entries) {
+            std::stringstream ss;
+            ss << "Fifo " << instanceName() << ": entry " << i << " out of range";
+            throw std::out_of_range(ss.str());
+        }
+        return entries[(head + i) % Depth];
+    }
+
+    // Dropped pushes (when full) and pops (when empty).
+    inline uint64_t get_overflows() const { return overflows; }
+    inline uint64_t get_underflows() const { return underflows; }
+
+    // Memory footprint in bytes (including entries).
+    const size_t footprint() const { return sizeof(*this) + Depth * sizeof(T); }
+
+    // Disallow register-style assignment.
+    Fifo& operator=(const Fifo& f) = delete;
+
+private:
+    // Friend classes.
+    friend class Testbench;
+    friend class vcd::writer;
+
+    // Ring buffer: entries, index of the head entry, and number of entries.
+    std::unique_ptr<T[]> entries;
+    uint32_t head;
+    uint32_t num_entries;
+
+    // Staged push and pop.
+    bool push_pending;
+    bool pop_pending;
+    T push_value;
+
+    // Dropped accesses.
+    uint64_t overflows;
+    uint64_t underflows;
+
+    // VCD: signal ID of the head signal, what changed on the last positive edge, and (shared) printers.
+    uint32_t head_signal_id;
+    bool count_changed;
+    bool head_changed;
+    const vcd::value2string_t<uint64_t>* count_printer;
+    const vcd::value2string_t<T>* head_printer;
+
+    // Reset: back to empty, discarding staged accesses.
+    void reset_to_instance_state() {
+        restore_replica();
+        if (num_entries) {
+            count_changed = head_changed = true;
+            const_cast<Module*>(root_instance)->trigger_module(parent_module);
+            const_cast<Module*>(root_instance)->add_changed_register(this);
+        }
+        head = num_entries = 0;
+    }
+
+    // Restore replica: discard staged push and pop (parent is being re-evaluated).
+    inline void restore_replica() { push_pending = pop_pending = false; }
+
+    // Save/restore the state: entries (head first), staged push and pop, and dropped access counts.
+    void save_state(pv::StateWriter& w) const {
+        w.put(num_entries);
+        for (uint32_t i = 0; i < num_entries; i++)
+            w.put(entries[(head + i) % Depth]);
+        w.put((uint8_t) (push_pending | (pop_pending << 1)));
+        w.put(push_value);
+        w.put(overflows);
+        w.put(underflows);
+    }
+    void restore_state(pv::StateReader& r) {
+        uint8_t pending;
+        r.get(num_entries);
+        if (num_entries > Depth)
+            throw std::runtime_error("Fifo " + instanceName() + ": saved state does not match");
+        head = 0;
+        r.get_array(entries.get(), num_entries);
+        r.get(pending);
+        push_pending = pending & 1;
+        pop_pending = (pending >> 1) & 1;
+        r.get(push_value);
+        r.get(overflows);
+        r.get(underflows);
+    }
+    void check_state(pv::StateReader& r) const {
+        uint32_t n;
+        r.get(n);
+        if (n > Depth)
+            throw std::runtime_error("Fifo " + instanceName() + ": saved state does not match");
+        r.take(n * sizeof(T) + sizeof(uint8_t) + sizeof(T) + 2 * sizeof(uint64_t));
+    }
+
+    // Positive clock edge: commit pop, then push.
+    void pos_edge() {
+        if (!push_pending && !pop_pending) return;
+        const uint32_t old_count = num_entries;
+        bool popped = false;
+        T old_front;
+        if (pop_pending) {
+            if (num_entries) {
+                popped = true;
+                old_front = entries[head];
+                head = (head + 1 == Depth) ? 0 : head + 1;
+                num_entries--;
+            } else
+                underflows++;
+        }
+        if (push_pending) {
+            if (num_entries < Depth) {
+                const uint32_t tail = (head + num_entries) % Depth;
+                entries[tail] = push_value;
+                num_entries++;
+            } else
+                overflows++;
+        }
+        push_pending = pop_pending = false;
+
+        // Trigger only if the count or the head entry (or its 'x' state when empty) changed.
+        count_changed = num_entries != old_count;
+        if (old_count == 0 || num_entries == 0)
+            head_changed = (old_count == 0) != (num_entries == 0);
+        else
+            head_changed = popped && old_front != entries[head];
+        if (count_changed || head_changed) {
+            const_cast<Module*>(root_instance)->trigger_module(parent_module);
+            const_cast<Module*>(root_instance)->add_changed_register(this);
+        }
+    }
+
+    // VCD printer methods.
+    inline void emit_count(std::ostream* vcd_stream) const {
+        *vcd_stream << (*count_printer)((uint64_t) num_entries) << (count_width > 1 ? " " : "") 
+            << vcd_id() << std::endl;
+    }
+    inline void emit_head(std::ostream* vcd_stream) const {
+        *vcd_stream << (num_entries ? (*head_printer)(entries[head]) : head_printer->undefined())
+            << (width > 1 ? " " : "") << vcd::id2string(head_signal_id) << std::endl;
+    }
+    void emit_vcd_definition(std::ostream* vcd_stream) {
+        *vcd_stream << "$var reg " << count_width << " " << vcd_id() << " " << name() << "_count"
+            << vcd::width2index(count_width) << " $end" << std::endl;
+        *vcd_stream << "$var reg " << width << " " << vcd::id2string(head_signal_id) << " " << name() << "_head"
+            << vcd::width2index(width) << " $end" << std::endl;
+    }
+    void emit_vcd_dumpvars(std::ostream* vcd_stream) const
+        { emit_count(vcd_stream); emit_head(vcd_stream); }
+    void emit_vcd_dumpon(std::ostream* vcd_stream) const
+        { emit_vcd_dumpvars(vcd_stream); }
+    void emit_vcd_dumpoff(std::ostream* vcd_stream) const {
+        *vcd_stream << count_printer->undefined() << (count_width > 1 ? " " : "") << vcd_id() << std::endl;
+        *vcd_stream << head_printer->undefined() << (width > 1 ? " " : "") << vcd::id2string(head_signal_id) << std::endl;
+    }
+    void emit_register(std::ostream* vcd_stream) const {
+        if (count_changed) emit_count(vcd_stream);
+        if (head_changed) emit_head(vcd_stream);
+    }
+
+    // Common code for all constructors.
+    void constructor_common() {
+        head = num_entries = 0;
+        push_pending = pop_pending = false;
+        push_value = T();
+        overflows = underflows = 0;
+        count_changed = head_changed = false;
+        count_printer = vcd::shared_printer<uint64_t>(count_width);
+        head_printer = vcd::shared_printer<T>(width);
+
+        // Allocate the signal (VCD) ID of the head signal.
+        head_signal_id = const_cast<Module*>(root_instance)->vcd_id_count()++;
+    }
+};
+
+// Definitions of compile-time constants (required if odr-used).
+template <typename T, uint32_t Depth, int W>
+constexpr uint32_t Fifo<T, Depth, W>::depth;
+template <typename T, uint32_t Depth, int W>
+constexpr int Fifo<T, Depth, W>::width;
+template <typename T, uint32_t Depth, int W>
+constexpr int Fifo<T, Depth, W>::count_width;
+
+#endif // _PV_FIFO_H_
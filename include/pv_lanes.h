@@ -0,0 +1,246 @@
+/*
+ * Copyright (c) 2023 Michael C Shebanow
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <type_traits>
+
+#ifndef _PV_LANES_H_
+#define _PV_LANES_H_
+
+/*
+ * Lane-parallel signals.
+ *
+ * The pv::Lanes<T, K> template class holds K independent values ("lanes") of
+ * type T. Used as the type of the signals of a design, one eval() simulates K
+ * stimulus vectors in lock step, e.g., for exhaustive or randomized testing of
+ * a small block:
+ *
+ *      typedef pv::Lanes<uint16_t, 32> V;
+ *      Input<V> instance(a);
+ *      Register<V> instance(acc);
+ *
+ * Arithmetic, bitwise, and shift operators apply lane by lane, and a T value
+ * converts to a Lanes value holding it in every lane (so "acc + 1" works).
+ * The loops over the lanes have a constant trip count and vectorize (SSE, AVX2,
+ * AVX-512) when compiled for those instruction sets. Since the lanes diverge,
+ * control flow must not depend on lane values: lane_eq(), lane_lt(), etc.
+ * return per-lane pv::Lanes<bool, K> masks, and select(m, a, b) picks a or b
+ * per lane (the C++ equivalent of the Verilog "m ? a : b" on every lane).
+ *
+ * The C++ == and != operators compare all lanes: a signal changes if any of
+ * its lanes changes (change detection ORs across lanes). Individual lanes are
+ * read and written with lane() and set_lane(); any(), all(), first(), and
+ * count() summarize a mask, e.g., to report the failing lanes of a checker.
+ *
+ * VCD dumps print all K lanes as one vector (lane K-1 in the most significant
+ * bits), each lane at 1/K of the signal width. pv::set_vcd_lane(i) instead
+ * dumps only lane i (for the signals printed by the calling thread), e.g., to
+ * extract the waveform of one failing stimulus vector.
+ *
+ * Single bit signals can also be simulated 64 lanes at a time as a plain
+ * uint64_t, one lane per bit, using the bitwise operators.
+ */
+
+namespace pv {
+
+    // Lane-wise complement; logical for bool lanes.
+    template <typename T>
+    inline T lane_not(const T& v) { return ~v; }
+    inline bool lane_not(const bool& v) { return !v; }
+
+    // K lanes of type T.
+    template <typename T, int K>
+    class Lanes {
+        static_assert(K > 0, "pv::Lanes<T, K> requires K > 0");
+    public:
+        // Geometry.
+        typedef T lane_type;
+        static const int num_lanes = K;
+
+        // Constructors: all lanes zero (value initialized), or all lanes v.
+        Lanes() { for (int i = 0; i < K; i++) v[i] = T(); }
+        Lanes(const T& x) { for (int i = 0; i < K; i++) v[i] = x; }
+
+        // Lanes base, base + step, base + 2*step, ... (e.g., exhaustive stimulus).
+        static Lanes sequence(const T& base, const T& step = T(1)) {
+            Lanes r;
+            T x = base;
+            for (int i = 0; i < K; i++, x = x + step) r.v[i] = x;
+            return r;
+        }
+
+        // Lane access.
+        inline const T& lane(const int i) const { return v[i]; }
+        inline void set_lane(const int i, const T& x) { v[i] = x; }
+        inline T* lanes() { return v; }
+        inline const T* lanes() const { return v; }
+
+        // Mask summaries (lanes compared to zero).
+        inline bool any() const {
+            bool r = false;
+            for (int i = 0; i < K; i++) r |= (v[i] != T());
+            return r;
+        }
+        inline bool all() const {
+            bool r = true;
+            for (int i = 0; i < K; i++) r &= (v[i] != T());
+            return r;
+        }
+        inline bool none() const { return !any(); }
+        inline int count() const {
+            int n = 0;
+            for (int i = 0; i < K; i++) n += (v[i] != T());
+            return n;
+        }
+        // First non-zero lane, or -1.
+        inline int first() const {
+            for (int i = 0; i < K; i++)
+                if (v[i] != T()) return i;
+            return -1;
+        }
+
+        // Lane-wise unary operators.
+        friend inline Lanes operator~(const Lanes& a) { Lanes r; for (int i = 0; i < K; i++) r.v[i] = lane_not(a.v[i]); return r; }
+        friend inline Lanes operator-(const Lanes& a) { Lanes r; for (int i = 0; i < K; i++) r.v[i] = -a.v[i]; return r; }
+        friend inline Lanes<bool, K> operator!(const Lanes& a) {
+            Lanes<bool, K> r;
+            for (int i = 0; i < K; i++) r.set_lane(i, !a.v[i]);
+            return r;
+        }
+
+        // Lane-wise binary operators (either operand may be a T, broadcast to all lanes, or a signal).
+        friend inline Lanes operator&(const Lanes& a, const Lanes& b) { Lanes r; for (int i = 0; i < K; i++) r.v[i] = a.v[i] & b.v[i]; return r; }
+        friend inline Lanes operator|(const Lanes& a, const Lanes& b) { Lanes r; for (int i = 0; i < K; i++) r.v[i] = a.v[i] | b.v[i]; return r; }
+        friend inline Lanes operator^(const Lanes& a, const Lanes& b) { Lanes r; for (int i = 0; i < K; i++) r.v[i] = a.v[i] ^ b.v[i]; return r; }
+        friend inline Lanes operator+(const Lanes& a, const Lanes& b) { Lanes r; for (int i = 0; i < K; i++) r.v[i] = a.v[i] + b.v[i]; return r; }
+        friend inline Lanes operator-(const Lanes& a, const Lanes& b) { Lanes r; for (int i = 0; i < K; i++) r.v[i] = a.v[i] - b.v[i]; return r; }
+        friend inline Lanes operator*(const Lanes& a, const Lanes& b) { Lanes r; for (int i = 0; i < K; i++) r.v[i] = a.v[i] * b.v[i]; return r; }
+        friend inline Lanes operator/(const Lanes& a, const Lanes& b) { Lanes r; for (int i = 0; i < K; i++) r.v[i] = a.v[i] / b.v[i]; return r; }
+        friend inline Lanes operator%(const Lanes& a, const Lanes& b) { Lanes r; for (int i = 0; i < K; i++) r.v[i] = a.v[i] % b.v[i]; return r; }
+        inline Lanes& operator&=(const Lanes& b) { return *this = *this & b; }
+        inline Lanes& operator|=(const Lanes& b) { return *this = *this | b; }
+        inline Lanes& operator^=(const Lanes& b) { return *this = *this ^ b; }
+        inline Lanes& operator+=(const Lanes& b) { return *this = *this + b; }
+        inline Lanes& operator-=(const Lanes& b) { return *this = *this - b; }
+        inline Lanes& operator*=(const Lanes& b) { return *this = *this * b; }
+        inline Lanes& operator/=(const Lanes& b) { return *this = *this / b; }
+        inline Lanes& operator%=(const Lanes& b) { return *this = *this % b; }
+
+        // Shifts: all lanes by s, or each lane by its own amount.
+        friend inline Lanes operator<<(const Lanes& a, const int s) { Lanes r; for (int i = 0; i < K; i++) r.v[i] = a.v[i] << s; return r; }
+        friend inline Lanes operator>>(const Lanes& a, const int s) { Lanes r; for (int i = 0; i < K; i++) r.v[i] = a.v[i] >> s; return r; }
+        friend inline Lanes operator<<(const Lanes& a, const Lanes& s) { Lanes r; for (int i = 0; i < K; i++) r.v[i] = a.v[i] << s.v[i]; return r; }
+        friend inline Lanes operator>>(const Lanes& a, const Lanes& s) { Lanes r; for (int i = 0; i < K; i++) r.v[i] = a.v[i] >> s.v[i]; return r; }
+        inline Lanes& operator<<=(const int s) { return *this = *this << s; }
+        inline Lanes& operator>>=(const int s) { return *this = *this >> s; }
+
+        // Compare all lanes (used for change detection: any lane differing is a change).
+        friend inline bool operator==(const Lanes& a, const Lanes& b) { return !(a != b); }
+        friend inline bool operator!=(const Lanes& a, const Lanes& b) {
+            bool d = false;
+            for (int i = 0; i < K; i++) d |= (a.v[i] != b.v[i]);
+            return d;
+        }
+
+    private:
+        // Storage: lane 0 first.
+        T v[K];
+    };
+
+    // Lane-wise comparisons, returning a mask of the lanes for which the comparison holds.
+    template <typename T, int K>
+    inline Lanes<bool, K> lane_eq(const Lanes<T, K>& a, const Lanes<T, K>& b)
+        { Lanes<bool, K> r; for (int i = 0; i < K; i++) r.set_lane(i, a.lane(i) == b.lane(i)); return r; }
+    template <typename T, int K>
+    inline Lanes<bool, K> lane_ne(const Lanes<T, K>& a, const Lanes<T, K>& b)
+        { Lanes<bool, K> r; for (int i = 0; i < K; i++) r.set_lane(i, a.lane(i) != b.lane(i)); return r; }
+    template <typename T, int K>
+    inline Lanes<bool, K> lane_lt(const Lanes<T, K>& a, const Lanes<T, K>& b)
+        { Lanes<bool, K> r; for (int i = 0; i < K; i++) r.set_lane(i, a.lane(i) < b.lane(i)); return r; }
+    template <typename T, int K>
+    inline Lanes<bool, K> lane_le(const Lanes<T, K>& a, const Lanes<T, K>& b)
+        { Lanes<bool, K> r; for (int i = 0; i < K; i++) r.set_lane(i, a.lane(i) <= b.lane(i)); return r; }
+    template <typename T, int K>
+    inline Lanes<bool, K> lane_gt(const Lanes<T, K>& a, const Lanes<T, K>& b) { return lane_lt(b, a); }
+    template <typename T, int K>
+    inline Lanes<bool, K> lane_ge(const Lanes<T, K>& a, const Lanes<T, K>& b) { return lane_le(b, a); }
+
+    // Lane-wise multiplexer: a where the mask is set, b elsewhere.
+    template <typename T, int K>
+    inline Lanes<T, K> select(const Lanes<bool, K>& m, const Lanes<T, K>& a, const Lanes<T, K>& b) {
+        Lanes<T, K> r;
+        for (int i = 0; i < K; i++) r.set_lane(i, m.lane(i) ? a.lane(i) : b.lane(i));
+        return r;
+    }
+
+    // Lane dumped to VCD files by the calling thread (-1: all lanes).
+    inline int& vcd_lane() { static thread_local int lane = -1; return lane; }
+    inline void set_vcd_lane(const int lane) { vcd_lane() = lane; }
+
+    // Streaming: "{lane 0, lane 1, ...}" (integral lanes printed as numbers).
+    template <typename T>
+    inline typename std::enable_if<std::is_integral<T>::value>::type print_lane(std::ostream& os, const T& v) { os << +v; }
+    template <typename T>
+    inline typename std::enable_if<!std::is_integral<T>::value>::type print_lane(std::ostream& os, const T& v) { os << v; }
+    template <typename T, int K>
+    std::ostream& operator<<(std::ostream& os, const Lanes<T, K>& l) {
+        os << "{";
+        for (int i = 0; i < K; i++) {
+            if (i) os << ", ";
+            print_lane(os, l.lane(i));
+        }
+        return os << "}";
+    }
+
+} // end namespace pv
+
+namespace vcd {
+
+    // Bit width of pv::Lanes<T, K>: K lanes of the width of T.
+    template <typename T, int K>
+    struct _bitwidth<pv::Lanes<T, K> > {
+        static constexpr int width = K * _bitwidth<T>::width;
+    };
+
+    // Print one lane at "w" bits, without a "b" prefix.
+    template <typename T>
+    inline std::string lane2string(const T& v, const int w) {
+        value2string_t<T> p(v);
+        p.set_width(w);
+        return p(v, false);
+    }
+    inline std::string lane2string(const bool& v, const int w) { return std::string(w - 1, '0') + (v ? "1" : "0"); }
+
+    // VCD string printer of pv::Lanes<T, K>: prints all lanes (lane K-1 first) at w/K bits each,
+    // or only the lane selected by pv::set_vcd_lane() (zero extended to w bits).
+    template <typename T, int K>
+    struct value2string_t<pv::Lanes<T, K> > : public value2string_base_t {
+        value2string_t(const pv::Lanes<T, K>& v) : value2string_base_t(_bitwidth<pv::Lanes<T, K> >::width) {}
+        std::string operator()(const pv::Lanes<T, K>& v, const bool add_b_prefix = true) const {
+            const int lw = std::max(1, w / K);
+            const int lane = pv::vcd_lane();
+            std::string str;
+            if (add_b_prefix && w > 1) str += "b";
+            if (lane >= 0 && lane < K)
+                str += std::string(std::max(0, w - lw), '0') + lane2string(v.lane(lane), lw);
+            else
+                for (int i = K - 1; i >= 0; i--)
+                    str += lane2string(v.lane(i), lw);
+            return str;
+        }
+    };
+
+} // end namespace vcd
+
+#endif // _PV_LANES_H_
@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2023 Michael C Shebanow
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PV_LOGIC_H_
+#define _PV_LOGIC_H_
+
+/*
+ * Four-state logic vectors.
+ *
+ * Signals track 'x' with a single flag for the whole value, so one unknown bit
+ * makes an entire bus unknown. The pv::Logic<N> template class instead
+ * represents each of its N bits as one of 0, 1, x, or z using two bit planes
+ * (the same encoding as the Verilog VPI aval/bval pair):
+ *
+ *      val unk | state
+ *      --------+------
+ *       0   0  |  0
+ *       1   0  |  1
+ *       1   1  |  x
+ *       0   1  |  z
+ *
+ * Both planes are pv::Bits<N>, so bitwise operators propagate unknowns per bit
+ * with word-wide (and, when available, SIMD) operations, following Verilog
+ * semantics (z is treated as x on input to an operator):
+ *  - & yields 0 wherever either operand bit is a known 0, | yields 1 wherever
+ *    either operand bit is a known 1, ^ and ~ are unknown where any input is.
+ *  - Arithmetic (+, -, *, /, %) yields all x if any operand bit is unknown.
+ *  - Shifts shift both planes, shifting in known 0s.
+ *
+ * The C++ == and != operators are case equality (Verilog === and !==): they
+ * compare both planes exactly, which is what signal change detection needs.
+ * Logical equality with x results is available via eq() and ne().
+ *
+ * Logic<N> can be used as the type of any signal or register, e.g.,
+ * Wire<pv::Logic<64>>. Values can be built from integers (all bits known),
+ * from pv::Bits<N>, or from Verilog-like strings such as "8'b1010_xxzz". VCD
+ * dumps print each bit as 0, 1, x, or z.
+ */
+
+namespace pv {
+
+    template <int N>
+    class Logic {
+    public:
+        static const int width = N;
+
+        // Constructors: all 0, from an integer or Bits<N> (all bits known), and from a string.
+        Logic() {}
+        template <typename U, typename std::enable_if<std::is_integral<U>::value || std::is_enum<U>::value, int>::type = 0>
+        Logic(const U v) : val(v) {}
+        Logic(const Bits<N>& v) : val(v) {}
+        Logic(const Bits<N>& v, const Bits<N>& u) : val(v), unk(u) {}
+        explicit Logic(const char* str) { parse(str); }
+        template <int M>
+        explicit Logic(const Logic<M>& l) : val(l.value_plane()), unk(l.unknown_plane()) {}
+
+        // All x and all z values.
+        static inline Logic x() { Logic l; l.val = ~Bits<N>(); l.unk = ~Bits<N>(); return l; }
+        static inline Logic z() { Logic l; l.unk = ~Bits<N>(); return l; }
+
+        // Plane access.
+        inline const Bits<N>& value_plane() const { return val; }
+        inline const Bits<N>& unknown_plane() const { return unk; }
+
+        // Per-bit access: '0', '1', 'x', or 'z'.
+        inline char get(const int i) const
+            { return unk.bit(i) ? (val.bit(i) ? 'x' : 'z') : (val.bit(i) ? '1' : '0'); }
+        inline void set(const int i, const char c) {
+            switch (c) {
+            case '0':           val.set_bit(i, false); unk.set_bit(i, false); break;
+            case '1':           val.set_bit(i, true);  unk.set_bit(i, false); break;
+            case 'z': case 'Z': val.set_bit(i, false); unk.set_bit(i, true);  break;
+            default:            val.set_bit(i, true);  unk.set_bit(i, true);  break;
+            }
+        }
+
+        // State queries.
+        inline bool is_known() const { return !unk; }
+        inline bool has_unknown() const { return (bool) unk; }
+
+        // Conversions: known bits only. As in a Verilog "if", unknown bits do not count as true.
+        inline Bits<N> to_bits() const { return val & ~unk; }
+        inline uint64_t to_uint64() const { return to_bits().to_uint64(); }
+        explicit inline operator bool() const { return (bool) (val & ~unk); }
+
+        // Bitwise operators with per-bit x propagation.
+        inline Logic operator~() const { return Logic(~val | unk, unk); }
+        Logic operator&(const Logic& b) const {
+            Bits<N> zero = (~val & ~unk) | (~b.val & ~b.unk);
+            Bits<N> one = (val & ~unk) & (b.val & ~b.unk);
+            Bits<N> u = ~(zero | one);
+            return Logic(one | u, u);
+        }
+        Logic operator|(const Logic& b) const {
+            Bits<N> one = (val & ~unk) | (b.val & ~b.unk);
+            Bits<N> zero = (~val & ~unk) & (~b.val & ~b.unk);
+            Bits<N> u = ~(zero | one);
+            return Logic(one | u, u);
+        }
+        inline Logic operator^(const Logic& b) const
+            { Bits<N> u = unk | b.unk; return Logic((val ^ b.val) | u, u); }
+        inline Logic& operator&=(const Logic& b) { *this = *this & b; return *this; }
+        inline Logic& operator|=(const Logic& b) { *this = *this | b; return *this; }
+        inline Logic& operator^=(const Logic& b) { *this = *this ^ b; return *this; }
+
+        // Shifts.
+        inline Logic operator<<(const int s) const { return Logic(val << s, unk << s); }
+        inline Logic operator>>(const int s) const { return Logic(val >> s, unk >> s); }
+        inline Logic& operator<<=(const int s) { *this = *this << s; return *this; }
+        inline Logic& operator>>=(const int s) { *this = *this >> s; return *this; }
+
+        // Arithmetic: all x if any operand bit is unknown.
+        inline Logic operator+(const Logic& b) const { return arith(b, val + b.val); }
+        inline Logic operator-(const Logic& b) const { return arith(b, val - b.val); }
+        inline Logic operator*(const Logic& b) const { return arith(b, val * b.val); }
+        inline Logic operator/(const Logic& b) const { return arith(b, val / b.val); }
+        inline Logic operator%(const Logic& b) const { return arith(b, val % b.val); }
+        inline Logic& operator+=(const Logic& b) { *this = *this + b; return *this; }
+        inline Logic& operator-=(const Logic& b) { *this = *this - b; return *this; }
+        inline Logic& operator*=(const Logic& b) { *this = *this * b; return *this; }
+        inline Logic& operator/=(const Logic& b) { *this = *this / b; return *this; }
+        inline Logic& operator%=(const Logic& b) { *this = *this % b; return *this; }
+        inline Logic& operator++() { *this = *this + Logic(1); return *this; }
+        inline Logic& operator--() { *this = *this - Logic(1); return *this; }
+        inline Logic operator++(int) { Logic t = *this; ++*this; return t; }
+        inline Logic operator--(int) { Logic t = *this; --*this; return t; }
+
+        // Case equality (=== and !==).
+        inline bool operator==(const Logic& b) const { return val == b.val && unk == b.unk; }
+        inline bool operator!=(const Logic& b) const { return !(*this == b); }
+
+        // Logical equality (== and !=): 0 if any known bits differ, else x if any bit is unknown, else 1.
+        Logic<1> eq(const Logic& b) const {
+            Bits<N> u = unk | b.unk;
+            if ((bool) ((val ^ b.val) & ~u)) return Logic<1>(0);
+            return (bool) u ? Logic<1>::x() : Logic<1>(1);
+        }
+        inline Logic<1> ne(const Logic& b) const { return ~eq(b); }
+
+        // String of bits, most significant first (e.g., "10xz").
+        std::string to_string() const {
+            std::string str;
+            for (int i = N - 1; i >= 0; i--)
+                str += get(i);
+            return str;
+        }
+
+    private:
+        // Value and unknown planes.
+        Bits<N> val;
+        Bits<N> unk;
+
+        // Arithmetic helper.
+        inline Logic arith(const Logic& b, const Bits<N>& r) const
+            { return (has_unknown() || b.has_unknown()) ? x() : Logic(r); }
+
+        // Parse "[<width>]'b<digits>" or "<digits>" where digits are 0, 1, x, z, or '_' (ignored).
+        // Bits not covered by the string are 0.
+        void parse(const char* str) {
+            const char* p = strchr(str, '\'');
+            p = p ? p + 1 : str;
+            if (*p == 'b' || *p == 'B') p++;
+            int i = 0;
+            for (const char* e = p + strlen(p) - 1; e >= p && i < N; e--) {
+                if (*e == '_') continue;
+                if (!strchr("01xXzZ", *e))
+                    throw std::invalid_argument(std::string("Illegal logic value string: ") + str);
+                set(i++, *e);
+            }
+        }
+    };
+
+    // Streaming (bit string).
+    template <int N>
+    inline std::ostream& operator<<(std::ostream& os, const Logic<N>& l) { return os << l.to_string(); }
+
+} // end namespace pv
+
+namespace vcd {
+
+    // Bit width of pv::Logic<N>.
+    template <int N>
+    struct _bitwidth<pv::Logic<N> > {
+        static constexpr int width = N;
+    };
+
+    // VCD string printer of pv::Logic<N>: prints "w" bits (the signal width) as 0, 1, x, or z.
+    template <int N>
+    struct value2string_t<pv::Logic<N> > : public value2string_base_t {
+        value2string_t(const pv::Logic<N>& v) : value2string_base_t(N) {}
+        std::string operator()(const pv::Logic<N>& v, const bool add_b_prefix = true) const {
+            std::string str;
+            if (add_b_prefix && w > 1) str += "b";
+            for (int i = w - 1; i >= 0; i--)
+                str += (i < N) ? v.get(i) : '0';
+            return str;
+        }
+    };
+
+} // end namespace vcd
+
+#endif // _PV_LOGIC_H_
@@ -0,0 +1,612 @@
+/*
+ * Copyright (c) 2023 Michael C Shebanow
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <memory>
+#include <stdexcept>
+#include <cctype>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifndef _PV_MEMORY_H_
+#define _PV_MEMORY_H_
+
+/*
+ * Memory (RAM/ROM) primitive.
+ *
+ * This header defines the Memory<T, Depth, W, R> template class, a clocked
+ * array of Depth words of type T. A memory is a single RegisterBase subclass,
+ * so the whole array costs one register list entry, one sensitization of its
+ * parent module, and one pos_edge() call per clock, rather than one Register
+ * instance per word.
+ *
+ * Template arguments:
+ * T - the type of a memory word
+ * Depth - number of words (addresses 0 to Depth - 1)
+ * W - optional bit width of a word; integral and enum values written are
+ *     truncated to W bits (see pv::width_mask)
+ * R - number of registered read ports (default 1)
+ *
+ * Ports:
+ *  - Write: write(addr, v) is a non-blocking write, staged like Register's
+ *    "<=" and committed on the next positive clock edge. Any number of writes
+ *    may be staged per clock; they are committed in order (the last write to an
+ *    address wins).
+ *  - Combinational read: read(addr) (or operator[]) returns the committed
+ *    contents of an address immediately.
+ *  - Registered read: read_sync(addr, port) requests a read that completes on
+ *    the next positive clock edge; the data is then available from q(port).
+ *    Reads see the contents from before that edge's writes (read-first). Read
+ *    data is 'x' until the first registered read completes.
+ *
+ * When a positive edge changes any memory word or registered read data, the
+ * parent module is triggered for evaluation. As with registers, if the parent
+ * module is re-evaluated within a clock, its staged writes and read requests
+ * are discarded (it will stage them again).
+ *
+ * Storage is selected at compile time: memories of up to
+ * pv::memory_dense_limit bytes are stored as one dense array; larger memories
+ * (e.g., multi-GB modeled DRAM) are stored sparsely in pages of
+ * pv::memory_page_words words that are allocated on first write. Words never
+ * written read as the fill value (the optional constructor initializer, or
+ * T() by default). Memory contents are not reset by
+ * Testbench::reset_to_instance_state() (only the staged writes and read ports
+ * are) and are not dumped to VCD files.
+ *
+ * Memory images (typically loaded from main() before simulation) write the
+ * contents directly, bypassing the write ports:
+ *  - readmemh()/readmemb(): load a Verilog $readmemh/$readmemb style text file
+ *    of hex/binary words separated by white space, with optional "@<hex>"
+ *    address directives, '_' digit separators, and // and block comments.
+ *    'x' and 'z' digits load as 0.
+ *  - load_binary(): copy a raw binary image (native layout of T) into memory.
+ *  - map_image(): use a raw binary image as the initial contents without
+ *    copying it. For sparse memories the file is memory-mapped copy-on-write
+ *    (MAP_PRIVATE): startup is instant regardless of image size, pages are
+ *    read on demand, the file is never modified, and unmodified pages are
+ *    shared (via the page cache) between simulation processes mapping the same
+ *    image. Dense memories simply copy the image (as load_binary() does).
+ * Loaders return false (after printing an error) on failure. Binary images
+ * require a trivially copyable T and are not truncated to W bits.
+ */
+
+namespace pv {
+
+    // Memories up to this many bytes use dense storage; larger ones use sparse pages.
+    static const uint64_t memory_dense_limit = 16ull << 20;
+
+    // Words per page of sparse memory storage.
+    static const uint64_t memory_page_words = 4096;
+
+    // Dense memory storage: a single array.
+    template <typename T, uint64_t Depth, bool Dense>
+    class MemoryStorage {
+    public:
+        MemoryStorage(const T& fill) : data(new T[Depth])
+            { for (uint64_t i = 0; i < Depth; i++) data[i] = fill; }
+        MemoryStorage(const MemoryStorage& s) = delete;
+
+        // Read and write one word.
+        inline const T& get(const uint64_t addr) const { return data[addr]; }
+        inline T& ref(const uint64_t addr) { return data[addr]; }
+
+        // Bytes of allocated storage.
+        inline uint64_t allocated_bytes() const { return Depth * sizeof(T); }
+
+        // Dense storage does not map images (callers copy them instead).
+        inline bool map(const int fd, const uint64_t base, const uint64_t words) { return false; }
+
+        // Save/restore the contents.
+        void save_state(StateWriter& w) const { w.put_array(data.get(), Depth); }
+        void restore_state(StateReader& r) { r.get_array(data.get(), Depth); }
+        static void check_state(StateReader& r) { r.take(Depth * sizeof(T)); }
+
+    private:
+        std::unique_ptr<T[]> data;
+    };
+
+    // Sparse memory storage: pages allocated on first write.
+    template <typename T, uint64_t Depth>
+    class MemoryStorage<T, Depth, false> {
+    public:
+        MemoryStorage(const T& f) : fill(f), image(NULL), image_base(0), image_words(0), image_bytes(0),
+            last_page_num(~0ull), last_page(NULL) {}
+        MemoryStorage(const MemoryStorage& s) = delete;
+        ~MemoryStorage() { unmap(); }
+
+        // Read one word; words of a mapped image come from the image, and unallocated pages
+        // read as the fill value.
+        inline const T& get(const uint64_t addr) const {
+            if (addr - image_base < image_words) return image[addr - image_base];
+            const T* page = find_page(addr / memory_page_words);
+            return page ? page[addr % memory_page_words] : fill;
+        }
+
+        // Reference to one word (for writing); allocates its page if required.
+        inline T& ref(const uint64_t addr) {
+            if (addr - image_base < image_words) return image[addr - image_base];
+            const uint64_t page_num = addr / memory_page_words;
+            T* page = find_page(page_num);
+            if (page == NULL) {
+                std::unique_ptr<T[]>& p = pages[page_num];
+                p.reset(new T[memory_page_words]);
+                for (uint64_t i = 0; i < memory_page_words; i++)
+                    p[i] = fill;
+                page = last_page = p.get();
+                last_page_num = page_num;
+            }
+            return page[addr % memory_page_words];
+        }
+
+        // Bytes of allocated storage (excluding a mapped image).
+        inline uint64_t allocated_bytes() const { return pages.size() * memory_page_words * sizeof(T); }
+
+        // Map "words" words of an open file copy-on-write as the contents starting at address "base".
+        // Returns false if the mapping fails.
+        bool map(const int fd, const uint64_t base, const uint64_t words) {
+            unmap();
+            if (words == 0) return true;
+            void* p = mmap(NULL, words * sizeof(T), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) return false;
+            image = (T*) p;
+            image_base = base;
+            image_words = words;
+            image_bytes = words * sizeof(T);
+            return true;
+        }
+
+        // Save the contents: the words of a mapped image, then the allocated pages (in page number
+        // order). Restored contents are held in pages; only image words that differ from the fill
+        // value are copied into pages.
+        void save_state(StateWriter& w) const {
+            w.put(image_base);
+            w.put(image_words);
+            w.put_array(image, image_words);
+            std::vector<uint64_t> page_nums;
+            for (typename std::unordered_map<uint64_t, std::unique_ptr<T[]>>::const_iterator it = pages.begin();
+                it != pages.end(); it++)
+                page_nums.push_back(it->first);
+            std::sort(page_nums.begin(), page_nums.end());
+            w.put((uint64_t) page_nums.size());
+            for (size_t i = 0; i < page_nums.size(); i++) {
+                w.put(page_nums[i]);
+                w.put_array(pages.find(page_nums[i])->second.get(), memory_page_words);
+            }
+        }
+        void restore_state(StateReader& r) {
+            unmap();
+            pages.clear();
+            last_page_num = ~0ull;
+            last_page = NULL;
+            uint64_t base, words, num_pages;
+            r.get(base);
+            r.get(words);
+            for (uint64_t i = 0; i < words; i++) {
+                T v;
+                r.get(v);
+                if (v != fill) ref(base + i) = v;
+            }
+            r.get(num_pages);
+            for (uint64_t i = 0; i < num_pages; i++) {
+                uint64_t page_num;
+                r.get(page_num);
+                std::unique_ptr<T[]>& p = pages[page_num];
+                if (!p) p.reset(new T[memory_page_words]);
+                r.get_array(p.get(), memory_page_words);
+            }
+        }
+        static void check_state(StateReader& r) {
+            uint64_t base, words, num_pages;
+            r.get(base);
+            r.get(words);
+            if (base > Depth || words > Depth - base)
+                throw std::runtime_error("Saved memory image is out of range");
+            r.take(words * sizeof(T));
+            r.get(num_pages);
+            for (uint64_t i = 0; i < num_pages; i++) {
+                uint64_t page_num;
+                r.get(page_num);
+                if (page_num > (Depth - 1) / memory_page_words)
+                    throw std::runtime_error("Saved memory page is out of range");
+                r.take(memory_page_words * sizeof(T));
+            }
+        }
+
+    private:
+        // Fill value of unwritten words.
+        const T fill;
+
+        // Mapped image (copy-on-write) covering addresses [image_base, image_base + image_words).
+        T* image;
+        uint64_t image_base;
+        uint64_t image_words;
+        size_t image_bytes;
+
+        // Release a mapped image.
+        void unmap() {
+            if (image) munmap(image, image_bytes);
+            image = NULL;
+            image_base = image_words = image_bytes = 0;
+        }
+
+        // Allocated pages by page number, plus a one-entry lookup cache.
+        std::unordered_map<uint64_t, std::unique_ptr<T[]>> pages;
+        mutable uint64_t last_page_num;
+        mutable T* last_page;
+
+        // Find a page (NULL if not allocated).
+        inline T* find_page(const uint64_t page_num) const {
+            if (page_num == last_page_num) return last_page;
+            typename std::unordered_map<uint64_t, std::unique_ptr<T[]>>::const_iterator it = pages.find(page_num);
+            if (it == pages.end()) return NULL;
+            last_page_num = page_num;
+            return last_page = it->second.get();
+        }
+    };
+
+} // end namespace pv
+
+/*
+ * Memory template class.
+ *
+ * Public methods in this class:
+ *  Geometry:
+ *      - depth, width: compile-time constants
+ *      - is_dense(): true if storage is a single dense array
+ *      - allocated_bytes(): bytes of storage currently allocated
+ *  Ports:
+ *      - write(): non-blocking write (committed on the next positive edge)
+ *      - read(), operator[](): combinational read of committed contents
+ *      - read_sync(): request a registered read on a read port
+ *      - q(): registered read data of a read port
+ *      - q_is_x(): true if registered read data of a read port is 'x'
+ *  Image loaders:
+ *      - readmemh(), readmemb(): load a Verilog-style hex/binary memory file
+ *      - load_binary(): copy a raw binary image
+ *      - map_image(): map a raw binary image copy-on-write (sparse memories)
+ */
+
+template <typename T, uint64_t Depth, int W = -1, int R = 1>
+class Memory final : public RegisterBase {
+public:
+    // Geometry.
+    static constexpr uint64_t depth = Depth;
+    static constexpr int width = (W > 0) ? W : vcd::bitwidth<T>();
+    static constexpr bool dense = Depth <= pv::memory_dense_limit / sizeof(T);
+    static_assert(Depth > 0, "Memory depth must be at least 1");
+    static_assert(R > 0, "Memory must have at least one read port");
+
+    // Constructors/Destructor.
+    // Disallow default constructor and copy constructor.
+    Memory(const Module* p, const char* str) :
+        RegisterBase(p, str), storage(T())
+            { constructor_common(); }
+    Memory(const Module* p, const char* str, const T& fill) :
+        RegisterBase(p, str), storage(pv::width_mask<T, W>::apply(fill))
+            { constructor_common(); }
+    Memory(const Module* p, const std::string& str) :
+        RegisterBase(p, str), storage(T())
+            { constructor_common(); }
+    Memory(const Module* p, const std::string& str, const T& fill) :
+        RegisterBase(p, str), storage(pv::width_mask<T, W>::apply(fill))
+            { constructor_common(); }
+    Memory() = delete;
+    Memory(const Memory& m) = delete;
+    virtual ~Memory() {}
+
+    // Storage getters.
+    inline bool is_dense() const { return dense; }
+    inline uint64_t allocated_bytes() const { return storage.allocated_bytes(); }
+
+    // Memory footprint in bytes (including allocated storage).
+    const size_t footprint() const { return sizeof(*this) + allocated_bytes(); }
+
+    // Non-blocking write.
+    inline void write(const uint64_t addr, const T& v) {
+        check_address(addr);
+        pending_writes.push_back(std::make_pair(addr, pv::width_mask<T, W>::apply(v)));
+    }
+
+    // Combinational read.
+    inline const T& read(const uint64_t addr) const { check_address(addr); return storage.get(addr); }
+    inline const T& operator[](const uint64_t addr) const { return read(addr); }
+
+    // Registered read request and data.
+    inline void read_sync(const uint64_t addr, const int port = 0) {
+        check_address(addr); check_port(port);
+        read_addr[port] = addr;
+        read_pending[port] = true;
+    }
+    inline const T& q(const int port = 0) const { check_port(port); return read_data[port]; }
+    inline bool q_is_x(const int port = 0) const { check_port(port); return read_x[port]; }
+
+    // Disallow register-style assignment.
+    Memory& operator=(const Memory& m) = delete;
+
+    // Load a Verilog-style hex ($readmemh) or binary ($readmemb) memory file into addresses start to end.
+    bool readmemh(const std::string& file_name, const uint64_t start = 0, const uint64_t end = Depth - 1)
+        { return readmem(file_name, 4, start, end); }
+    bool readmemb(const std::string& file_name, const uint64_t start = 0, const uint64_t end = Depth - 1)
+        { return readmem(file_name, 1, start, end); }
+
+    // Copy a raw binary image into memory starting at address "start".
+    bool load_binary(const std::string& file_name, const uint64_t start = 0) {
+        static_assert(std::is_trivially_copyable<T>::value, "binary images require a trivially copyable type");
+        check_address(start);
+        std::ifstream is(file_name, std::ios::in | std::ios::binary);
+        if (!is.is_open()) {
+            std::cerr << "File " << file_name << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+        std::vector<T> buf(pv::memory_page_words);
+        uint64_t addr = start;
+        while (addr < Depth && is) {
+            is.read((char*) buf.data(), std::min(pv::memory_page_words, Depth - addr) * sizeof(T));
+            const uint64_t n = is.gcount() / sizeof(T);
+            for (uint64_t i = 0; i < n; i++)
+                storage.ref(addr++) = pv::width_mask<T, W>::apply(buf[i]);
+        }
+        image_loaded();
+        return true;
+    }
+
+    // Use a raw binary image as the contents starting at address "start" (copy-on-write mapping
+    // for sparse memories; a copy for dense memories).
+    bool map_image(const std::string& file_name, const uint64_t start = 0) {
+        static_assert(std::is_trivially_copyable<T>::value, "binary images require a trivially copyable type");
+        if (dense) return load_binary(file_name, start);
+        check_address(start);
+        const int fd = open(file_name.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) < 0) {
+            std::cerr << "File " << file_name << ": " << strerror(errno) << std::endl;
+            if (fd >= 0) close(fd);
+            return false;
+        }
+        const uint64_t words = std::min((uint64_t) st.st_size / sizeof(T), Depth - start);
+        const bool ok = storage.map(fd, start, words);
+        if (!ok) std::cerr << "File " << file_name << ": mmap: " << strerror(errno) << std::endl;
+        close(fd);
+        if (ok) image_loaded();
+        return ok;
+    }
+
+private:
+    // Friend classes.
+    friend class Testbench;
+    friend class vcd::writer;
+
+    // Memory contents.
+    pv::MemoryStorage<T, Depth, dense> storage;
+
+    // Staged writes.
+    std::vector<std::pair<uint64_t, T> > pending_writes;
+
+    // Registered read ports: requested address, pending flag, data, and 'x' state.
+    uint64_t read_addr[R];
+    bool read_pending[R];
+    T read_data[R];
+    bool read_x[R];
+
+    // Text image loader: "bits" is the number of bits per digit (4 for hex, 1 for binary).
+    bool readmem(const std::string& file_name, const int bits, const uint64_t start, const uint64_t end) {
+        check_address(start);
+        std::ifstream is(file_name);
+        if (!is.is_open()) {
+            std::cerr << "File " << file_name << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+        std::stringstream ss;
+        ss << is.rdbuf();
+        const std::string text = ss.str();
+        const uint64_t last = std::min(end, Depth - 1);
+        uint64_t addr = start;
+        int line = 1;
+        for (size_t i = 0; i < text.size(); ) {
+            // Skip white space and comments.
+            if (text[i] == '\n') { line++; i++; continue; }
+            if (isspace(text[i])) { i++; continue; }
+            if (text.compare(i, 2, "//") == 0) { while (i < text.size() && text[i] != '\n') i++; continue; }
+            if (text.compare(i, 2, "/*") == 0) {
+                for (i += 2; i < text.size() && text.compare(i, 2, "*/") != 0; i++)
+                    if (text[i] == '\n') line++;
+                i += 2;
+                continue;
+            }
+
+            // Address directive or data word.
+            const bool is_addr = text[i] == '@';
+            if (is_addr) i++;
+            const int digit_bits = is_addr ? 4 : bits;
+            T v = T();
+            uint64_t a = 0;
+            int num_digits = 0;
+            for (; i < text.size() && !isspace(text[i]) && text.compare(i, 2, "//") != 0 &&
+                text.compare(i, 2, "/*") != 0; i++) {
+                    const char c = tolower(text[i]);
+                    int d;
+                    if (c == '_') continue;
+                    else if (c == 'x' || c == 'z') d = 0;
+                    else if (c >= '0' && c <= '9') d = c - '0';
+                    else if (c >= 'a' && c <= 'f') d = c - 'a' + 10;
+                    else d = 1 << digit_bits;
+                    if (d >= (1 << digit_bits)) {
+                        std::cerr << "File " << file_name << ", line " << line << ": illegal digit '" 
+                            << text[i] << "'" << std::endl;
+                        return false;
+                    }
+                    if (is_addr) a = (a << 4) | d;
+                    else shift_in(v, digit_bits, d, std::integral_constant<bool, 
+                        std::is_integral<T>::value || std::is_enum<T>::value>());
+                    num_digits++;
+            }
+            if (num_digits == 0) {
+                std::cerr << "File " << file_name << ", line " << line << ": missing value" << std::endl;
+                return false;
+            }
+            if (is_addr) { addr = a; continue; }
+            if (addr < start || addr > last) {
+                std::cerr << "File " << file_name << ", line " << line << ": address " << addr 
+                    << " outside of memory " << instanceName() << " load range" << std::endl;
+                return false;
+            }
+            storage.ref(addr++) = pv::width_mask<T, W>::apply(v);
+        }
+        image_loaded();
+        return true;
+    }
+
+    // Append a digit to a word being parsed (integral and enum types, other types).
+    static inline void shift_in(T& v, const int bits, const int d, std::true_type)
+        { v = (T) (((uint64_t) v << bits) | (uint64_t) d); }
+    static inline void shift_in(T& v, const int bits, const int d, std::false_type)
+        { v = (v << bits) | T(d); }
+
+    // After loading an image, make sure the parent module sees the new contents.
+    inline void image_loaded() { const_cast<Module*>(root_instance)->trigger_module(parent_module); }
+
+    // Error checking.
+    inline void check_address(const uint64_t addr) const {
+        if (addr >= Depth) {
+            std::stringstream ss;
+            ss << "Memory " << instanceName() << ": address " << addr << " out of range";
+            throw std::out_of_range(ss.str());
+        }
+    }
+    inline void check_port(const int port) const {
+        if (port < 0 || port >= R) {
+            std::stringstream ss;
+            ss << "Memory " << instanceName() << ": read port " << port << " out of range";
+            throw std::out_of_range(ss.str());
+        }
+    }
+
+    // Reset: discard staged accesses and make read data 'x'. Contents are retained.
+    void reset_to_instance_state() {
+        restore_replica();
+        bool change = false;
+        for (int i = 0; i < R; i++) {
+            change |= !read_x[i];
+            read_x[i] = true;
+        }
+        if (change) {
+            const_cast<Module*>(root_instance)->trigger_module(parent_module);
+            const_cast<Module*>(root_instance)->add_changed_register(this);
+        }
+    }
+
+    // Restore replica: discard staged writes and read requests (parent is being re-evaluated).
+    inline void restore_replica() {
+        pending_writes.clear();
+        for (int i = 0; i < R; i++)
+            read_pending[i] = false;
+    }
+
+    // Save/restore the state: contents, staged writes, and read ports.
+    void save_state(pv::StateWriter& w) const {
+        storage.save_state(w);
+        w.put((uint64_t) pending_writes.size());
+        for (size_t i = 0; i < pending_writes.size(); i++) {
+            w.put(pending_writes[i].first);
+            w.put(pending_writes[i].second);
+        }
+        w.put_array(read_addr, R);
+        w.put_array(read_pending, R);
+        w.put_array(read_data, R);
+        w.put_array(read_x, R);
+    }
+    void restore_state(pv::StateReader& r) {
+        storage.restore_state(r);
+        uint64_t n;
+        r.get(n);
+        pending_writes.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            r.get(pending_writes[i].first);
+            r.get(pending_writes[i].second);
+        }
+        r.get_array(read_addr, R);
+        r.get_array(read_pending, R);
+        r.get_array(read_data, R);
+        r.get_array(read_x, R);
+    }
+    void check_state(pv::StateReader& r) const {
+        pv::MemoryStorage<T, Depth, dense>::check_state(r);
+        uint64_t n;
+        r.get(n);
+        for (uint64_t i = 0; i < n; i++) {
+            uint64_t addr;
+            r.get(addr);
+            if (addr >= Depth)
+                throw std::runtime_error("Memory " + instanceName() + ": saved state does not match");
+            r.take(sizeof(T));
+        }
+        r.take(sizeof(read_addr) + sizeof(read_pending) + sizeof(read_data) + sizeof(read_x));
+    }
+
+    // Positive clock edge: complete registered reads (read-first), then commit writes.
+    void pos_edge() {
+        bool change = false;
+        for (int i = 0; i < R; i++)
+            if (read_pending[i]) {
+                const T& v = storage.get(read_addr[i]);
+                if (read_x[i] || read_data[i] != v) {
+                    read_data[i] = v;
+                    read_x[i] = false;
+                    change = true;
+                }
+                read_pending[i] = false;
+            }
+        for (size_t i = 0; i < pending_writes.size(); i++) {
+            const uint64_t addr = pending_writes[i].first;
+            if (storage.get(addr) != pending_writes[i].second) {
+                storage.ref(addr) = pending_writes[i].second;
+                change = true;
+            }
+        }
+        pending_writes.clear();
+        if (change) {
+            const_cast<Module*>(root_instance)->trigger_module(parent_module);
+            const_cast<Module*>(root_instance)->add_changed_register(this);
+        }
+    }
+
+    // Memory contents are not dumped to VCD files.
+    void emit_vcd_definition(std::ostream* vcd_stream) {}
+    void emit_vcd_dumpvars(std::ostream* vcd_stream) const {}
+    void emit_vcd_dumpon(std::ostream* vcd_stream) const {}
+    void emit_vcd_dumpoff(std::ostream* vcd_stream) const {}
+    void emit_register(std::ostream* vcd_stream) const {}
+
+    // Common code for all constructors.
+    void constructor_common() {
+        for (int i = 0; i < R; i++) {
+            read_addr[i] = 0;
+            read_pending[i] = false;
+            read_data[i] = T();
+            read_x[i] = true;
+        }
+    }
+};
+
+// Definitions of compile-time constants (required if odr-used).
+template <typename T, uint64_t Depth, int W, int R>
+constexpr uint64_t Memory<T, Depth, W, R>::depth;
+template <typename T, uint64_t Depth, int W, int R>
+constexpr int Memory<T, Depth, W, R>::width;
+template <typename T, uint64_t Depth, int W, int R>
+constexpr bool Memory<T, Depth, W, R>::dense;
+
+#endif // _PV_MEMORY_H_
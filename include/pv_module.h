@@ -27,7 +27,77 @@
 // Forward declarations.
 class WireBase;
 class RegisterBase;
+class Testbench;
 namespace vcd { class writer; }
+namespace pv { 
+    class SignalPoolBase; 
+
+    // Negative edge handler for a batch of changed wires of a single wire type
+    // (see WireTemplateBase::neg_edge_batch()).
+    typedef void (*NegEdgeBatchFn)(const WireBase* const* wires, const size_t n);
+
+    // Wires changed this clock of a single wire type, with their negative edge handler.
+    struct ChangedWireBatch {
+        ChangedWireBatch(NegEdgeBatchFn f) : fn(f) {}
+        NegEdgeBatchFn fn;
+        std::vector<const WireBase*> wires;
+    };
+
+    // Result of resetting batches of signals to their initial state (see WireTemplateBase::reset_batch()
+    // and Register::reset_batch()): the number of wire writes, the wires that became changed wires
+    // (with the negative edge handler of their type), the changed registers, and the modules to trigger.
+    struct ResetBatchResult {
+        uint64_t wire_writes;
+        NegEdgeBatchFn neg_edge;
+        std::vector<const WireBase*> changed_wires;
+        std::vector<const RegisterBase*> changed_registers;
+        std::vector<const Module*> triggered;
+    };
+
+    // Reset handlers for a batch of wires or registers of a single type.
+    typedef void (*WireResetBatchFn)(const WireBase* const* wires, const size_t n, ResetBatchResult& result);
+    typedef void (*RegisterResetBatchFn)(const RegisterBase* const* regs, const size_t n, ResetBatchResult& result);
+
+    // Clock domain: a clock whose period is "divide" Testbench clocks, with positive edges at clocks
+    // phase + 1, phase + 1 + divide, phase + 1 + 2 * divide, ... Created by Testbench::add_clock_domain();
+    // modules and registers are assigned to it by set_clock_domain().
+    class ClockDomain {
+    public:
+        ClockDomain(const std::string& nm, const uint32_t d, const uint32_t p, const uint32_t i) :
+            domain_name(nm), divide(d), phase(p), index(i), edges(0) {}
+        ClockDomain(const ClockDomain& d) = delete;
+
+        // Name, period (in Testbench clocks), and phase (clock of the first edge - 1).
+        inline const std::string& name() const { return domain_name; }
+        inline uint32_t get_divide() const { return divide; }
+        inline uint32_t get_phase() const { return phase; }
+
+        // Does the domain have a positive edge at Testbench clock "clock"?
+        inline bool has_edge(const uint32_t clock) const 
+            { return clock > phase && (clock - 1 - phase) % divide == 0; }
+
+        // Clock level at half clock h (2c: positive edge of Testbench clock c; 2c + 1: its negative
+        // edge). The clock is high for the first half of its period.
+        inline bool level(const uint64_t h) const {
+            const uint64_t first = 2ull * (phase + 1);
+            return h >= first && (h - first) % (2ull * divide) < divide;
+        }
+
+        // Positive edges simulated so far.
+        inline uint64_t get_edges() const { return edges; }
+
+        // VCD identifier of the domain's clock.
+        inline std::string vcd_id() const { return "*@" + std::to_string(index + 1); }
+
+    private:
+        friend class ::Testbench;
+        const std::string domain_name;
+        const uint32_t divide;
+        const uint32_t phase;
+        const uint32_t index;                   // index of the domain in its Testbench
+        uint64_t edges;
+    };
+}
 
 // Declare the Module base class.
 class Module {
@@ -97,6 +167,32 @@ public:
     void force_eval_next_clock() 
         { needs_evaluation = true; }
 
+    // Clock domain of the registers of this module and of its submodules (unless they set their own).
+    // By default, a module inherits the domain of its parent; NULL at the top => the Testbench clock.
+    void set_clock_domain(const pv::ClockDomain* d) 
+        { clock_domain = d; root()->design_changed(); }
+    const pv::ClockDomain* get_clock_domain() const 
+        { return clock_domain ? clock_domain : (parent_module ? parent_module->get_clock_domain() : NULL); }
+
+    // Clock gate of this module's subtree. The first call declares the module a clock gate (a design
+    // change); while its enable is off, the registers of the subtree are not clocked and the subtree is
+    // skipped by the per-clock passes of the Testbench. Changes take effect at the next clock edge.
+    void set_clock_enable(const bool on) {
+        clock_enable = on;
+        if (!clock_gate) { clock_gate = true; root()->design_changed(); }
+    }
+    inline bool get_clock_enable() const 
+        { return clock_enable; }
+    inline bool has_clock_gate() const 
+        { return clock_gate; }
+
+    // Is the module clocked, i.e., are the clock gates of the module and of all its ancestors on?
+    bool is_clock_enabled() const {
+        for (const Module* m = this; m; m = m->parent_module)
+            if (!m->clock_enable) return false;
+        return true;
+    }
+
     // Getters/setters on needs_evaluation.
     inline bool get_needs_evaluation() const 
         { return needs_evaluation; }
@@ -108,44 +204,67 @@ protected:
     friend class WireBase;
     friend class RegisterBase;
     friend class vcd::writer;
-    template <typename T> friend class WireTemplateBase;
+    template <typename T, int W> friend class WireTemplateBase;
     template <typename T, int W> friend class Register;
+    template <typename T, uint64_t Depth, int W, int R> friend class Memory;
+    template <typename T, uint32_t Depth, int W> friend class Fifo;
+    template <typename T, uint32_t N, int W> friend class RegisterArray;
 
     // Virtual function to evaluate positive edge flops.
     virtual void pos_edge(const Module* m) {}
 
     // Methods to add submodules, wires, and register instances to the module
     void add_module_instance(const Module* m) 
-        { (void) module_list.insert(module_list.end(), m); }
+        { (void) module_list.insert(module_list.end(), m); root()->design_changed(); }
     void add_wire_instance(const WireBase* w) 
-        { (void) wire_list.insert(wire_list.end(), w); }
+        { (void) wire_list.insert(wire_list.end(), w); root()->design_changed(); }
     void add_register_instance(const RegisterBase* r) 
-        { (void) register_list.insert(register_list.end(), r); }
+        { (void) register_list.insert(register_list.end(), r); root()->design_changed(); }
 
     // Methods to remove submodules, wires, and register 
     // instances from the module.
     void remove_module_instance(const Module* m) 
-        { module_list.erase(m); }
+        { module_list.erase(m); root()->design_changed(); }
     void remove_wire_instance(const WireBase* w) 
-        { wire_list.erase(w); }
+        { wire_list.erase(w); root()->design_changed(); }
     void remove_register_instance(const RegisterBase* r) 
-        { register_list.erase(r); }
+        { register_list.erase(r); root()->design_changed(); }
+
+    // Virtual function overloaded in Testbench: called on the root instance whenever a module,
+    // wire, or register is added to or removed from the design.
+    virtual void design_changed() {}
 
     // Methods to keep track of changed/unchanged wires and changed registers.
     // Actual implementation in Testbench; calls in Wires/Registers should be to root_instance.
-    virtual void add_changed_wire(const WireBase* theWire) {}
+    virtual void add_changed_wire(const WireBase* theWire, pv::NegEdgeBatchFn batch) {}
     virtual void remove_changed_wire(const WireBase* theWire) {}
     virtual void add_changed_register(const RegisterBase* theRegister) {}
 
     // Virtual function overloaded in Testbench to trigger a module.
     virtual void trigger_module(const Module* theModule) {}
 
+    // Virtual function overloaded in Testbench to record which wire triggered a module
+    // (used for combinational oscillation diagnostics).
+    virtual void record_wire_trigger(const WireBase* theWire) {}
+
     // For value change tracing. Actual implementation in Testbench.
     virtual void trace_string_size(const std::string iname, const int width) {}
     virtual const pv::ValueChangeRecord get_trace_change(const std::string iname) 
         { pv::ValueChangeRecord dummy; return dummy; }
     virtual void set_trace_change(const std::string iname, const pv::ValueChangeRecord& vcr) {}
 
+    // For activity counting. Actual implementation in Testbench. Signals only call record_activity()
+    // when the root instance's counting_activity flag is set (see Testbench::set_activity_counting()).
+    virtual void record_activity(const uint32_t signal_id, const bool change) {}
+    bool counting_activity;
+
+#ifdef PV_SOA_SIGNALS
+    // Signal pool for a wire type, created on first use (see pv_signal_pool.h). Actual
+    // implementation in Testbench; other modules own no pools.
+    virtual pv::SignalPoolBase* signal_pool(const std::type_info& type, pv::SignalPoolBase* (*create)()) 
+        { return NULL; }
+#endif
+
 private:
     // Module parent; NULL => top level module. Keep track of root of Module instance tree.
     const Module* parent_module;
@@ -157,6 +276,13 @@ private:
     // Module instance name.
     const std::string instance_name;
 
+    // Clock domain set on this module; NULL => inherited.
+    const pv::ClockDomain* clock_domain;
+
+    // Clock gate: is the module a clock gate, and is its clock enabled?
+    bool clock_gate;
+    bool clock_enable;
+
     // Data structures to keep track of module instances.
     std::set<const Module*> module_list;
     std::set<const WireBase*> wire_list;
@@ -165,14 +291,24 @@ private:
     // Flag to keep track if module has been evaluated this clock cycle or not.
     bool eval_has_been_called;
 
-    // Keeping track of assigned VCD ID counts.
-    virtual uint32_t& vcd_id_count() { static uint32_t tmp = 0; return tmp; }
+    // Root instance (non-const).
+    inline Module* root() const { return const_cast<Module*>(root_instance); }
+
+    // Keeping track of assigned VCD ID counts (of a root module that is not a Testbench;
+    // overridden in Testbench).
+    uint32_t root_vcd_id_count;
+    virtual uint32_t& vcd_id_count() { return root_vcd_id_count; }
 
     // Constructor common code. Records root of module instance 
     // tree and adds this instance to parent if it exists.
     void constructor_common() {
         eval_has_been_called = false;
         needs_evaluation = false;
+        root_vcd_id_count = 0;
+        clock_domain = NULL;
+        clock_gate = false;
+        clock_enable = true;
+        counting_activity = false;
         if (parent_module) {
             root_instance = parent_module->root_instance;
             const_cast<Module*>(parent_module)->add_module_instance(this);
@@ -0,0 +1,307 @@
+/*
+ * Copyright (c) 2023 Michael C Shebanow
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <chrono>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#ifndef _PV_PROFILE_H_
+#define _PV_PROFILE_H_
+
+/*
+ * Simulation profiling support.
+ *
+ * This header defines three entities in the "pv" namespace:
+ *  - cycle_clock: a low overhead, cycle-accurate time source. On x86 it reads
+ *    the time stamp counter, on AArch64 the virtual counter; elsewhere it falls
+ *    back to std::chrono::steady_clock (in nanoseconds).
+ *  - Profiler: a per-Module eval() profiler. When a Profiler is installed in a
+ *    Testbench (see Testbench::set_profiler()), every eval() call is timed and
+ *    accounted to the evaluated Module: number of eval() calls, number of
+ *    re-evaluations within the same clock (those that forced a register replica
+ *    restore), and accumulated cycle_clock ticks. Ticks are converted to seconds
+ *    by calibrating cycle_clock against steady_clock over each simulation() run.
+ *    Results can be printed as a report sorted by cost, or exported as CSV/JSON.
+ *  - SimulationStats: throughput counters collected by every Testbench during
+ *    simulation() (see Testbench::get_statistics()): wall time, clocks, eval()
+ *    calls, a histogram of delta iterations per clock, peak run queue size, wire
+ *    writes and register updates. Counters accumulate across simulation() calls.
+ */
+
+namespace pv {
+
+    // Cycle-accurate time source.
+    struct cycle_clock {
+        static inline uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+            return __rdtsc();
+#elif defined(__aarch64__)
+            uint64_t v;
+            asm volatile("mrs %0, cntvct_el0" : "=r"(v));
+            return v;
+#else
+            return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+        }
+    };
+
+    // Simulation throughput counters.
+    struct SimulationStats {
+        double wall_seconds;                    // wall clock time spent in simulation()
+        uint64_t clocks;                        // # of clocks simulated
+        uint64_t evals;                         // # of eval() calls
+        uint64_t delta_iterations;              // # of delta (eval) iterations
+        std::vector<uint64_t> delta_depth;      // histogram: [n] = # of clocks with n delta iterations
+        uint64_t peak_triggered;                // peak size of the triggered module queue
+        uint64_t wire_writes;                   // # of wire writes
+        uint64_t register_updates;              // # of register state changes
+        uint64_t gated_subtrees;                // # of clocks x clock gated subtrees (gate off)
+        uint64_t gated_modules;                 // # of clocks x modules in gated subtrees
+        uint64_t gated_registers;               // # of register clock edges skipped by clock gates
+
+        // Constructor.
+        SimulationStats() { reset(); }
+
+        // Clear all counters.
+        void reset() {
+            wall_seconds = 0.0;
+            clocks = evals = delta_iterations = 0;
+            delta_depth.clear();
+            peak_triggered = wire_writes = register_updates = 0;
+            gated_subtrees = gated_modules = gated_registers = 0;
+        }
+
+        // Add the counters of another run (peak queue size is the maximum of both).
+        void accumulate(const SimulationStats& s) {
+            wall_seconds += s.wall_seconds;
+            clocks += s.clocks;
+            evals += s.evals;
+            delta_iterations += s.delta_iterations;
+            if (s.delta_depth.size() > delta_depth.size()) delta_depth.resize(s.delta_depth.size(), 0);
+            for (size_t i = 0; i < s.delta_depth.size(); i++)
+                delta_depth[i] += s.delta_depth[i];
+            peak_triggered = std::max(peak_triggered, s.peak_triggered);
+            wire_writes += s.wire_writes;
+            register_updates += s.register_updates;
+            gated_subtrees += s.gated_subtrees;
+            gated_modules += s.gated_modules;
+            gated_registers += s.gated_registers;
+        }
+
+        // Derived rates.
+        inline double clocks_per_second() const 
+            { return wall_seconds > 0.0 ? clocks / wall_seconds : 0.0; }
+        inline double evals_per_clock() const 
+            { return clocks ? (double) evals / clocks : 0.0; }
+        inline double deltas_per_clock() const 
+            { return clocks ? (double) delta_iterations / clocks : 0.0; }
+        inline double gated_modules_per_clock() const 
+            { return clocks ? (double) gated_modules / clocks : 0.0; }
+
+        // Record the delta depth of a clock.
+        inline void record_delta_depth(const uint32_t n) {
+            if (n >= delta_depth.size()) delta_depth.resize(n + 1, 0);
+            delta_depth[n]++;
+        }
+
+        // Print statistics to a stream.
+        void print(std::ostream& os) const {
+            char buf[128];
+            os << ">>> Simulation statistics" << std::endl;
+            snprintf(buf, sizeof(buf), "%.6f s", wall_seconds);
+            os << ">>>   wall time           : " << buf << std::endl;
+            os << ">>>   clocks              : " << clocks << std::endl;
+            snprintf(buf, sizeof(buf), "%.1f", clocks_per_second());
+            os << ">>>   clocks/second       : " << buf << std::endl;
+            snprintf(buf, sizeof(buf), "%.3f", evals_per_clock());
+            os << ">>>   eval() calls        : " << evals << " (" << buf << "/clock)" << std::endl;
+            snprintf(buf, sizeof(buf), "%.3f", deltas_per_clock());
+            os << ">>>   delta iterations    : " << delta_iterations << " (" << buf << "/clock)" << std::endl;
+            os << ">>>   peak triggered queue: " << peak_triggered << std::endl;
+            os << ">>>   wire writes         : " << wire_writes << std::endl;
+            os << ">>>   register updates    : " << register_updates << std::endl;
+            if (gated_subtrees) {
+                snprintf(buf, sizeof(buf), "%.3f", gated_modules_per_clock());
+                os << ">>>   gated subtrees      : " << gated_subtrees << std::endl;
+                os << ">>>   gated modules       : " << gated_modules << " (" << buf << "/clock)" << std::endl;
+                os << ">>>   gated registers     : " << gated_registers << std::endl;
+            }
+            os << ">>>   delta depth histogram:" << std::endl;
+            for (size_t i = 0; i < delta_depth.size(); i++)
+                if (delta_depth[i])
+                    os << ">>>     " << std::setw(4) << i << ": " << delta_depth[i] << std::endl;
+        }
+    };
+
+    // Quote a string as a JSON string literal (used for instance names in JSON exports).
+    inline std::string json_string(const std::string& s) {
+        std::string q("\"");
+        for (size_t i = 0; i < s.size(); i++) {
+            const unsigned char c = s[i];
+            if (c == '"' || c == '\\') {
+                q += '\\';
+                q += c;
+            } else if (c < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                q += buf;
+            } else
+                q += c;
+        }
+        return q + "\"";
+    }
+
+    // Profile of one Module instance.
+    struct ModuleProfileRecord {
+        std::string name;                       // hierarchical instance name
+        uint64_t evals;                         // # of eval() calls
+        uint64_t reevals;                       // # of eval() calls re-evaluating within the same clock
+        uint64_t ticks;                         // accumulated cycle_clock ticks spent in eval()
+    };
+
+    // Per-Module eval() profiler.
+    class Profiler {
+    public:
+        // Constructor/Destructor.
+        Profiler() { reset(); }
+        Profiler(const Profiler& p) = delete;
+        virtual ~Profiler() {}
+
+        // Clear all accumulated data.
+        void reset() {
+            records.clear();
+            total_ticks = 0;
+            calib_ticks = 0;
+            calib_ns = 0;
+        }
+
+        // Record one eval() call of module "m" lasting "ticks" cycle_clock ticks.
+        inline void record_eval(const Module* m, const bool reeval, const uint64_t ticks) {
+            std::map<const Module*, ModuleProfileRecord>::iterator it = records.find(m);
+            if (it == records.end()) {
+                ModuleProfileRecord r = { m->instanceName(), 0, 0, 0 };
+                it = records.insert(std::make_pair(m, r)).first;
+            }
+            it->second.evals++;
+            if (reeval) it->second.reevals++;
+            it->second.ticks += ticks;
+            total_ticks += ticks;
+        }
+
+        // Bracket a simulation run; used to calibrate cycle_clock ticks to seconds.
+        void start_run() {
+            run_start_ticks = cycle_clock::now();
+            run_start_time = std::chrono::steady_clock::now();
+        }
+        void stop_run() {
+            calib_ticks += cycle_clock::now() - run_start_ticks;
+            calib_ns += (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - run_start_time).count();
+        }
+
+        // Getters.
+        inline uint64_t get_total_ticks() const { return total_ticks; }
+        inline double ticks_per_second() const
+            { return (calib_ticks && calib_ns) ? (double) calib_ticks * 1e9 / (double) calib_ns : 1e9; }
+        inline double ticks2seconds(const uint64_t t) const { return (double) t / ticks_per_second(); }
+
+        // Return all records sorted by cost (most expensive first).
+        std::vector<ModuleProfileRecord> sorted_records() const {
+            std::vector<ModuleProfileRecord> v;
+            for (std::map<const Module*, ModuleProfileRecord>::const_iterator it = records.begin();
+                it != records.end(); it++)
+                    v.push_back(it->second);
+            std::sort(v.begin(), v.end(), [](const ModuleProfileRecord& a, const ModuleProfileRecord& b)
+                { return a.ticks > b.ticks || (a.ticks == b.ticks && a.name < b.name); });
+            return v;
+        }
+
+        // Print a report sorted by cost to a stream.
+        void report(std::ostream& os) const {
+            std::vector<ModuleProfileRecord> v = sorted_records();
+            size_t name_len = 6;
+            for (size_t i = 0; i < v.size(); i++)
+                name_len = std::max(name_len, v[i].name.length());
+            std::string divider(name_len + 62, '-');
+            char buf[64];
+
+            os << ">>> " << divider << std::endl;
+            os << ">>> Module eval() profile (" << ticks2seconds(total_ticks) << " s in eval())" << std::endl;
+            os << ">>> " << std::left << std::setw(name_len) << "Module" << std::right
+               << std::setw(12) << "evals" << std::setw(12) << "reevals"
+               << std::setw(14) << "seconds" << std::setw(12) << "ns/eval" << std::setw(8) << "%" << std::endl;
+            os << ">>> " << divider << std::endl;
+            for (size_t i = 0; i < v.size(); i++) {
+                os << ">>> " << std::left << std::setw(name_len) << v[i].name << std::right
+                   << std::setw(12) << v[i].evals << std::setw(12) << v[i].reevals;
+                snprintf(buf, sizeof(buf), "%14.6f%12.1f%8.2f", ticks2seconds(v[i].ticks),
+                    v[i].evals ? ticks2seconds(v[i].ticks) * 1e9 / v[i].evals : 0.0,
+                    total_ticks ? 100.0 * v[i].ticks / total_ticks : 0.0);
+                os << buf << std::endl;
+            }
+            os << ">>> " << divider << std::endl;
+        }
+
+        // Export as CSV. Returns false if the file cannot be written.
+        bool write_csv(const std::string& file_name) const {
+            std::ofstream os(file_name);
+            if (!os.is_open()) {
+                std::cerr << "File " << file_name << ": " << strerror(errno) << std::endl;
+                return false;
+            }
+            std::vector<ModuleProfileRecord> v = sorted_records();
+            os << "module,evals,reevals,ticks,seconds" << std::endl;
+            for (size_t i = 0; i < v.size(); i++)
+                os << v[i].name << "," << v[i].evals << "," << v[i].reevals << ","
+                   << v[i].ticks << "," << ticks2seconds(v[i].ticks) << std::endl;
+            return true;
+        }
+
+        // Export as JSON. Returns false if the file cannot be written.
+        bool write_json(const std::string& file_name) const {
+            std::ofstream os(file_name);
+            if (!os.is_open()) {
+                std::cerr << "File " << file_name << ": " << strerror(errno) << std::endl;
+                return false;
+            }
+            std::vector<ModuleProfileRecord> v = sorted_records();
+            os << "{\"ticks_per_second\": " << ticks_per_second() << ", \"modules\": [" << std::endl;
+            for (size_t i = 0; i < v.size(); i++)
+                os << "  {\"module\": " << json_string(v[i].name) << ", \"evals\": " << v[i].evals
+                   << ", \"reevals\": " << v[i].reevals << ", \"ticks\": " << v[i].ticks
+                   << ", \"seconds\": " << ticks2seconds(v[i].ticks) << "}"
+                   << (i + 1 < v.size() ? "," : "") << std::endl;
+            os << "]}" << std::endl;
+            return true;
+        }
+
+    private:
+        // Per-module records.
+        std::map<const Module*, ModuleProfileRecord> records;
+        uint64_t total_ticks;
+
+        // Calibration of cycle_clock against steady_clock.
+        uint64_t calib_ticks;
+        uint64_t calib_ns;
+        uint64_t run_start_ticks;
+        std::chrono::steady_clock::time_point run_start_time;
+    };
+
+} // end namespace pv
+
+#endif // _PV_PROFILE_H_
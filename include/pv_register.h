@@ -66,6 +66,11 @@ class Testbench;
  *  Module info:
  *      - parent(): return pointer to parent Module.
  *      - top(): returns pointer to topmost module instance (a Testbench).
+ *  Clocking:
+ *      - set_clock_domain(): clock the register by a pv::ClockDomain (NULL =>
+ *        the domain of its parent module).
+ *      - get_clock_domain(): returns the register's clock domain (NULL => the
+ *        Testbench clock).
  *  Related to VCD dumps:
  *      - {virtual, abstract} emit_vcd_definition() - print the definition of a
  *        register to a VCD stream.
@@ -81,14 +86,14 @@ class Testbench;
  *        register; pass stream pointer if dumping to a VCD.
  */
 
-class RegisterBase {
+class RegisterBase : public pv::StateHolder {
 protected:
     // Constructors/Destructor: protected so only subclass can use.
     RegisterBase(const Module* p, const char* str) : parent_module(p), 
-        root_instance(p ? p->root_instance : NULL), register_name(str)
+        root_instance(p ? p->root_instance : NULL), register_name(pv::NameTable::intern(str))
             { constructor_common(); }
     RegisterBase(const Module* p, const std::string& str) : parent_module(p), 
-        root_instance(p ? p->root_instance : NULL), register_name(str)
+        root_instance(p ? p->root_instance : NULL), register_name(pv::NameTable::intern(str))
             { constructor_common(); }
     virtual ~RegisterBase() 
         { const_cast<Module*>(parent_module)->remove_register_instance(this); }
@@ -99,9 +104,9 @@ public:
     RegisterBase(const RegisterBase& r) = delete;
 
     // General naming methods.
-    inline const std::string name() const { return register_name; }
+    inline const std::string name() const { return *register_name; }
     const std::string instanceName() const {
-        std::string tmp = const_cast<Module*>(parent_module)->instanceName() + "." + register_name;
+        std::string tmp = const_cast<Module*>(parent_module)->instanceName() + "." + *register_name;
         return tmp;
     }
 
@@ -113,26 +118,49 @@ public:
     virtual void assign_x() {}
     virtual void reset_to_x() {}
 
+    // Memory footprint of this register in bytes (including any storage it owns).
+    virtual const size_t footprint() const = 0;
+
+    // Clock domain clocking this register; by default, the domain of its parent module.
+    void set_clock_domain(const pv::ClockDomain* d) 
+        { clock_domain = d; const_cast<Module*>(parent_module)->root()->design_changed(); }
+    const pv::ClockDomain* get_clock_domain() const 
+        { return clock_domain ? clock_domain : parent_module->get_clock_domain(); }
+
 protected:
-    // Parent modules and name.
+    // Parent modules and name (interned; see pv::NameTable).
     const Module* parent_module;
     const Module* root_instance;
-    const std::string register_name;
+    const std::string* register_name;
 
     // How to clock this register, to be overridden by subclass
     virtual void pos_edge() = 0;
 
-    // VCD related.
-    std::string vcd_id_str;
+    // VCD related. The VCD ID is derived from the signal ID.
+    inline std::string vcd_id() const { return vcd::id2string(signal_id); }
     virtual void emit_vcd_definition(std::ostream* vcd_stream) = 0;
     virtual void emit_vcd_dumpvars(std::ostream* vcd_stream) const = 0;
     virtual void emit_vcd_dumpon(std::ostream* vcd_stream) const = 0;
     virtual void emit_vcd_dumpoff(std::ostream* vcd_stream) const = 0;
     virtual void emit_register(std::ostream* vcd_stream) const = 0;
 
+    // Activity counting: number of signal IDs of the register (consecutive from signal_id; see
+    // RegisterArray), and whether signal signal_id + i changed at the last positive edge.
+    virtual uint32_t signal_count() const { return 1; }
+    virtual bool signal_changed(const uint32_t i) const { return true; }
+
+    // Called once the changes of a changed register have been reported (VCD, activity counters).
+    virtual void clear_changes() {}
+
     // Optional tracing.
     bool tracing;
 
+    // Signal ID (unique per Testbench); used for VCD IDs and activity counters.
+    uint32_t signal_id;
+
+    // Clock domain set on this register; NULL => the domain of the parent module.
+    const pv::ClockDomain* clock_domain;
+
 private:
     // Friend classes.
     friend class Testbench; 
@@ -146,6 +174,10 @@ private:
     // Actual implementation in Register<T>.
     virtual void restore_replica() {}
 
+    // Virtual method returning the handler that resets a batch of registers of this type,
+    // NULL if registers of this type are reset individually. Actual implementation in Register<T>.
+    virtual pv::RegisterResetBatchFn reset_batch_fn() const { return NULL; }
+
     // Common constuctor code.
     void constructor_common() {
         // Parent cannot be NULL.
@@ -155,13 +187,12 @@ private:
         // Associate to parent module.
         const_cast<Module*>(parent_module)->add_register_instance(this);
 
-        // Initialize VCD ID.
-        std::stringstream ss;
-        ss << "@" << std::hex << const_cast<Module*>(root_instance)->vcd_id_count()++;
-        vcd_id_str = ss.str();
+        // Initialize signal ID.
+        signal_id = const_cast<Module*>(root_instance)->vcd_id_count()++;
 
         // Initialize trace stream off.
         tracing = false;
+        clock_domain = NULL;
     }
 };
 
@@ -175,7 +206,10 @@ private:
  *
  * Template arguments:
  * T - the type of wire
- * W - optional bit width; if unspecified, width will be inferred from type
+ * W - optional bit width; if unspecified, width will be inferred from type. The width is
+ *     a compile-time constant. For integral and enum types narrower than T, values
+ *     assigned with <= (and the initializer) are truncated to W bits (see pv::width_mask);
+ *     for other types W only sets the VCD width. Writes through d() are not truncated.
  *
  * Public methods in this class:
  *  Value getter/setter:
@@ -183,15 +217,15 @@ private:
  *      - d(): returns reference to input flop stage; be careful with assignments
  *      - q(): returns reference to output flop stage; be careful with assignments
  *      - operator<=(): non-blocking assignment to input stage
- *  Width setter/getter:
- *      - set_width(): set the width of the register (overriding template)
+ *  Width getter:
+ *      - width: compile-time constant width of the register
  *      - get_width(): return the width of the register
  *  "X" state getters:
  *      - value_is_x(): returns true if replica value is "x"
  *      - value_will_be_x(): returns true if source value is "x"
  *  VCD related:
- *      - set_vcd_string_printer(): override default string printer; 
- *        caller responsible for any object delete
+ *      - set_vcd_string_printer(): override default string printer (only its
+ *        width is used)
  *      - emit_vcd_definition(): emit VCD definition of reg
  *      - emit_vcd_dumpvars(): dump initial values of reg
  *      - emit_vcd_dumpon(): synonym to dumpvars
@@ -205,16 +239,16 @@ public:
     // Constructors/Destructor.
     // Disallow default constructor and copy constructor.
     Register(const Module* p, const char* str) : 
-        RegisterBase(p, str), v2s(def_printer)
+        RegisterBase(p, str)
             { constructor_common(p, str, NULL); }
     Register(const Module* p, const char* str, const T& init) : 
-        RegisterBase(p, str), v2s(def_printer)
+        RegisterBase(p, str)
             { constructor_common(p, str, &init); }
     Register(const Module* p, const std::string& str) : 
-        RegisterBase(p, str), v2s(def_printer)
+        RegisterBase(p, str)
             { constructor_common(p, str.c_str(), NULL); }
     Register(const Module* p, const std::string& str, const T& init) : 
-        RegisterBase(p, str), v2s(def_printer)
+        RegisterBase(p, str)
             { constructor_common(p, str.c_str(), &init); }
     Register() = delete;
     Register(const Register& r) = delete;
@@ -232,14 +266,16 @@ public:
     Register& operator<=(const Register& v) {
         source_x = v.replica_x;
         source = v.replica;
+        record_static_write();
         return *this;
     }
 
-    // General non-register->register non-blocking assignment (<=).
-    template <typename U>
-    Register& operator<=(const Register<U>& v) {
-        source_x = v.source_x;
-        source = v.source;
+    // General register->register non-blocking assignment (<=).
+    template <typename U, int UW>
+    Register& operator<=(const Register<U, UW>& v) {
+        source_x = v.replica_x;
+        source = pv::width_mask<T, W>::apply((T) v.replica);
+        record_static_write();
         return *this;
     }
 
@@ -247,12 +283,13 @@ public:
     template <typename U>
     Register& operator<=(const U& v) {
         source_x = false;
-        source = v;
+        source = pv::width_mask<T, W>::apply(v);
+        record_static_write();
         return *this;
     }
 
-    // Width setter/getter.
-    void set_width(const int wv) { width = wv; v2s.set_width(width); }
+    // Bit width (compile-time constant) and its getter.
+    static constexpr int width = (W > 0) ? W : vcd::bitwidth<T>();
     const int get_width() const { return width; }
 
     // X state getters.
@@ -269,8 +306,13 @@ public:
         replica_x = source_x = true;
     }
 
-    // VCD string printer setter.
-    void set_vcd_string_printer(const vcd::value2string_t<T>& printer) { v2s = printer; }
+    // VCD string printer setter. Printers of a type differ only in width, so the
+    // register switches to the shared printer of the printer's width.
+    void set_vcd_string_printer(const vcd::value2string_t<T>& printer) 
+        { v2s = vcd::shared_printer<T>(printer.get_width()); }
+
+    // Memory footprint of this register in bytes.
+    const size_t footprint() const { return sizeof(*this); }
 
     // Disallow op-assignments.
     Register& operator+=(const T& v) = delete;
@@ -289,7 +331,7 @@ public:
     Register& operator--(int) = delete;
 
     // Method to return std::string for value of this wire type.
-    const std::string value_string() const { return replica_x ? v2s.undefined() : (v2s)(replica); }
+    const std::string value_string() const { return replica_x ? v2s->undefined() : (*v2s)(replica); }
 
     // Set up a trace or tear it down.
     inline void enable_trace(const bool en) {
@@ -303,9 +345,7 @@ private:
     // Friend classes.
     friend class Testbench; 
     friend class vcd::writer;
-
-    // Bit width of this register.
-    int width;
+    template <typename U, int UW> friend class Register;
 
     // In order to follow more PC conventions, the term master/slave is replaced with the
     // MYSQL terminology (see https://en.wikipedia.org/wiki/Master/slave_(technology)).
@@ -334,9 +374,9 @@ private:
             pv::ValueChangeRecord vcr = const_cast<Module*>(root_instance)->get_trace_change(instanceName());
             if (vcr.type == 'U') {
                 vcr.type = 'R';
-                vcr.start_value = replica_x ? v2s.undefined() : (v2s)(replica);
+                vcr.start_value = replica_x ? v2s->undefined() : (*v2s)(replica);
             }
-            vcr.end_value = init_x ? v2s.undefined() : (v2s)(init_state);
+            vcr.end_value = init_x ? v2s->undefined() : (*v2s)(init_state);
             vcr.is_changed = true;
             vcr.NTR++;
             const_cast<Module*>(root_instance)->set_trace_change(instanceName(), vcr);
@@ -347,6 +387,33 @@ private:
         source_x = init_x;
     }
 
+    // Reset a batch of registers of this type to their initial state: the effect of calling
+    // reset_to_instance_state() on each, with the changed registers and modules to trigger
+    // collected into "result". Traced registers are reset individually.
+    static void reset_batch(const RegisterBase* const* regs, const size_t n, pv::ResetBatchResult& result) {
+        for (size_t i = 0; i < n; i++) {
+            Register* r = static_cast<Register*>(const_cast<RegisterBase*>(regs[i]));
+            if (r->tracing) {
+                r->Register::reset_to_instance_state();
+                continue;
+            }
+            if (r->replica_x ? !r->init_x : (r->init_x || r->replica != r->init_state)) {
+                result.triggered.push_back(r->parent_module);
+                result.changed_registers.push_back(r);
+            }
+            r->source = r->init_state;
+            r->source_x = r->init_x;
+        }
+    }
+    pv::RegisterResetBatchFn reset_batch_fn() const { return &reset_batch; }
+
+    // Activity counting: a non-blocking write that will not change the register is static.
+    // (Transitions are counted by the Testbench when the register changes on a positive edge.)
+    inline void record_static_write() {
+        if (root_instance->counting_activity && (replica_x ? source_x : (!source_x && !(replica != source))))
+            const_cast<Module*>(root_instance)->record_activity(signal_id, false);
+    }
+
     // Restore replica: copy replica value back to source.
     // This is considered an "undo" so is not considered a change (=> no tracing nor VCD update).
     inline void restore_replica() {
@@ -354,6 +421,21 @@ private:
         source_x = replica_x;
     }
 
+    // Save/restore the state of the register: source and replica values and 'x' states.
+    void save_state(pv::StateWriter& w) const {
+        w.put(source);
+        w.put(replica);
+        w.put((uint8_t) (source_x | (replica_x << 1)));
+    }
+    void restore_state(pv::StateReader& r) {
+        uint8_t x;
+        r.get(source);
+        r.get(replica);
+        r.get(x);
+        source_x = x & 1;
+        replica_x = (x >> 1) & 1;
+    }
+
     // Implement a positive clock edge on this register.
     inline void pos_edge() {
         bool change = false;
@@ -370,9 +452,9 @@ private:
             pv::ValueChangeRecord vcr = const_cast<Module*>(root_instance)->get_trace_change(instanceName());
             if (vcr.type == 'U') {
                 vcr.type = 'R';
-                vcr.start_value = replica_x ? v2s.undefined() : (v2s)(replica);
+                vcr.start_value = replica_x ? v2s->undefined() : (*v2s)(replica);
             }
-            vcr.end_value = source_x ? v2s.undefined() : (v2s)(source);
+            vcr.end_value = source_x ? v2s->undefined() : (*v2s)(source);
             vcr.is_changed = true;
             vcr.NTR++;
             const_cast<Module*>(root_instance)->set_trace_change(instanceName(), vcr);
@@ -383,22 +465,21 @@ private:
         replica_x = source_x;
     }
 
-    // VCD string printer.
-    vcd::value2string_t<T> def_printer = { replica }; 
-    vcd::value2string_t<T>& v2s;
+    // VCD string printer: shared by all registers of the same type and width (see vcd::shared_printer).
+    const vcd::value2string_t<T>* v2s;
 
     // VCD printer methods.
     // Should NOT be called if vcd_stream is NULL (i.e., we are not dumping a VCD).
     inline void emit_vcd_definition(std::ostream* vcd_stream)
-        { *vcd_stream << "$var reg " << width << " " << vcd_id_str << " " << name() << vcd::width2index(width) << " $end" << std::endl; }
+        { *vcd_stream << "$var reg " << width << " " << vcd_id() << " " << name() << vcd::width2index(width) << " $end" << std::endl; }
     inline void emit_vcd_dumpvars(std::ostream* vcd_stream) const
-        { *vcd_stream << (replica_x ? v2s.undefined() : (v2s)(replica)) << (width > 1 ? " " : "") << vcd_id_str << std::endl; }
+        { *vcd_stream << (replica_x ? v2s->undefined() : (*v2s)(replica)) << (width > 1 ? " " : "") << vcd_id() << std::endl; }
     inline void emit_vcd_dumpon(std::ostream* vcd_stream) const
-        { *vcd_stream << (replica_x ? v2s.undefined() : (v2s)(replica)) << (width > 1 ? " " : "") << vcd_id_str << std::endl; }
+        { *vcd_stream << (replica_x ? v2s->undefined() : (*v2s)(replica)) << (width > 1 ? " " : "") << vcd_id() << std::endl; }
     inline void emit_vcd_dumpoff(std::ostream* vcd_stream) const
-        { *vcd_stream << v2s.undefined() << (width > 1 ? " " : "") << vcd_id_str << std::endl; }
+        { *vcd_stream << v2s->undefined() << (width > 1 ? " " : "") << vcd_id() << std::endl; }
     inline void emit_register(std::ostream* vcd_stream) const
-        { *vcd_stream << (replica_x ? v2s.undefined() : (v2s)(replica)) << (width > 1 ? " " : "") << vcd_id_str << std::endl; }
+        { *vcd_stream << (replica_x ? v2s->undefined() : (*v2s)(replica)) << (width > 1 ? " " : "") << vcd_id() << std::endl; }
 
     // Common code for all constructors.
     void constructor_common(const Module* p, const char* str, const T* init) {
@@ -406,19 +487,21 @@ private:
         if (!p)
             throw std::invalid_argument("Register must be declared inside a module");
 
-        // Save bit width.
-        width = (W > 0) ? W : vcd::bitwidth<T>();
-
-        // Set default printer bit width.
-        v2s.set_width(width);
+        // Set default printer.
+        static const vcd::value2string_t<T>* const def_printer = vcd::shared_printer<T>(width);
+        v2s = def_printer;
 
-        // Connect to parent and optionally initialize.
+        // Connect to parent and optionally initialize (truncated to the register width).
         if (init) {
-            init_state = replica = source = *init;
+            init_state = replica = source = pv::width_mask<T, W>::apply(*init);
             init_x = source_x = replica_x = false;
         } else
             init_x = source_x = replica_x = true;
     }
 };
 
+// Definition of the bit width constant (required if odr-used).
+template <typename T, int W>
+constexpr int Register<T, W>::width;
+
  #endif //  _PV_REGISTER_H_
@@ -0,0 +1,302 @@
+/*
+ * Copyright (c) 2023 Michael C Shebanow
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <memory>
+#include <cstring>
+
+#ifndef _PV_REGISTER_ARRAY_H_
+#define _PV_REGISTER_ARRAY_H_
+
+/*
+ * Register banks.
+ *
+ * This header defines the RegisterArray<T, N, W> template class, a bank of N
+ * registers of type T (e.g., a register file) that behaves like N Register<T, W>
+ * instances but is a single RegisterBase subclass. The source, replica, and 'x'
+ * states of all elements are stored as contiguous planes, so a positive edge
+ * is one pass that compares the source and replica planes into a change mask
+ * (a loop the compiler vectorizes for integral types) followed, if anything
+ * changed, by a bulk copy (memcpy for trivially copyable types) of the source
+ * planes into the replica planes. The parent module is triggered once if any
+ * element changed.
+ *
+ * Elements are accessed through operator[], which returns a lightweight
+ * Element handle supporting the same reads and non-blocking writes as a
+ * Register:
+ *
+ *      RegisterArray<uint64_t, 64> instance(regs);
+ *      ...
+ *      regs[rd] <= (uint64_t) regs[rs1] + (uint64_t) regs[rs2];
+ *
+ * An optional initializer sets every element; otherwise elements start as 'x'.
+ * VCD dumps contain one signal per element ("<name>[i]", each with its own VCD
+ * ID); on a positive edge only the elements set in the change mask are
+ * emitted. Activity counters likewise count each element as a signal.
+ */
+
+template <typename T, uint32_t N, int W = -1>
+class RegisterArray final : public RegisterBase {
+public:
+    // Geometry.
+    static constexpr uint32_t size = N;
+    static constexpr int width = (W > 0) ? W : vcd::bitwidth<T>();
+    static_assert(N > 0, "RegisterArray size must be at least 1");
+
+    // Element handle.
+    class Element {
+    public:
+        // Read (replica) value and 'x' states.
+        inline operator T() const { return array.replica[index]; }
+        inline bool value_is_x() const { return array.replica_x[index]; }
+        inline bool value_will_be_x() const { return array.source_x[index]; }
+
+        // Non-blocking assignments. As for a Register, a template (rather than const T&) so a
+        // value of another type is not ambiguous with the built-in <= through operator T().
+        template <typename U>
+        inline Element& operator<=(const U& v) { array.set(index, v); return *this; }
+        inline Element& operator<=(const Element& e) {
+            if (e.array.replica_x[e.index]) array.assign_x(index);
+            else array.set(index, e.array.replica[e.index]);
+            return *this;
+        }
+
+        // Disallow direct assignment (blocking).
+        Element& operator=(const T& v) = delete;
+
+    private:
+        friend class RegisterArray;
+        Element(RegisterArray& a, const uint32_t i) : array(a), index(i) {}
+        RegisterArray& array;
+        const uint32_t index;
+    };
+
+    // Constructors/Destructor.
+    // Disallow default constructor and copy constructor.
+    RegisterArray(const Module* p, const char* str) : RegisterBase(p, str)
+        { constructor_common(NULL); }
+    RegisterArray(const Module* p, const char* str, const T& init) : RegisterBase(p, str)
+        { constructor_common(&init); }
+    RegisterArray(const Module* p, const std::string& str) : RegisterBase(p, str)
+        { constructor_common(NULL); }
+    RegisterArray(const Module* p, const std::string& str, const T& init) : RegisterBase(p, str)
+        { constructor_common(&init); }
+    RegisterArray() = delete;
+    RegisterArray(const RegisterArray& r) = delete;
+    virtual ~RegisterArray() {}
+
+    // Element access.
+    inline Element operator[](const uint32_t i) { check_index(i); return Element(*this, i); }
+    inline const T& q(const uint32_t i) const { check_index(i); return replica[i]; }
+    inline bool value_is_x(const uint32_t i) const { check_index(i); return replica_x[i]; }
+
+    // Non-blocking writes of one element.
+    inline void set(const uint32_t i, const T& v) {
+        check_index(i);
+        source[i] = pv::width_mask<T, W>::apply(v);
+        source_x[i] = 0;
+        if (root_instance->counting_activity && !replica_x[i] && !(replica[i] != source[i]))
+            const_cast<Module*>(root_instance)->record_activity(signal_id + i, false);
+    }
+    inline void assign_x(const uint32_t i) { 
+        check_index(i); 
+        source_x[i] = 1; 
+        if (root_instance->counting_activity && replica_x[i])
+            const_cast<Module*>(root_instance)->record_activity(signal_id + i, false);
+    }
+
+    // X state setters (all elements).
+    void assign_x() { memset(source_x.get(), 1, N); }
+    void reset_to_x() {
+        bool change = false;
+        for (uint32_t i = 0; i < N; i++)
+            change |= !replica_x[i];
+        memset(source_x.get(), 1, N);
+        memset(replica_x.get(), 1, N);
+        if (change) {
+            for (uint32_t w = 0; w < num_mask_words; w++)
+                change_mask[w] = (w * 64 + 64 <= N) ? ~0ull : (1ull << (N % 64)) - 1;
+            const_cast<Module*>(root_instance)->trigger_module(parent_module);
+            const_cast<Module*>(root_instance)->add_changed_register(this);
+        }
+    }
+
+    // Memory footprint in bytes (including the planes and change mask).
+    const size_t footprint() const
+        { return sizeof(*this) + N * (2 * sizeof(T) + 2) + num_mask_words * sizeof(uint64_t); }
+
+    // Disallow register-style assignment.
+    RegisterArray& operator=(const RegisterArray& r) = delete;
+
+private:
+    // Friend classes.
+    friend class Testbench;
+    friend class vcd::writer;
+
+    // Planes: source, replica, and initial values, and their 'x' states (one byte per element).
+    static const uint32_t num_mask_words = (N + 63) / 64;
+    std::unique_ptr<T[]> source;
+    std::unique_ptr<T[]> replica;
+    T init_state;
+    std::unique_ptr<uint8_t[]> source_x;
+    std::unique_ptr<uint8_t[]> replica_x;
+    bool init_x;
+
+    // Elements changed since the changes were last reported (bit i of word i / 64 for element i):
+    // set by a positive edge or reset_to_x(), cleared by clear_changes().
+    std::unique_ptr<uint64_t[]> change_mask;
+
+    // VCD string printer (shared; see vcd::shared_printer).
+    const vcd::value2string_t<T>* v2s;
+
+    // Error checking.
+    inline void check_index(const uint32_t i) const {
+        if (i >= N) {
+            std::stringstream ss;
+            ss << "RegisterArray " << instanceName() << ": index " << i << " out of range";
+            throw std::out_of_range(ss.str());
+        }
+    }
+
+    // Bulk copy of a plane.
+    static inline void copy_plane(T* dst, const T* src) {
+        if (std::is_trivially_copyable<T>::value) memcpy((void*) dst, (const void*) src, N * sizeof(T));
+        else std::copy(src, src + N, dst);
+    }
+
+    // Add the elements that differ between the source and replica planes to the change mask.
+    // Returns true if any element differs.
+    bool compute_change_mask() {
+        uint64_t any = 0;
+        for (uint32_t w = 0; w < num_mask_words; w++) {
+            const uint32_t lo = w * 64;
+            const uint32_t hi = (lo + 64 < N) ? lo + 64 : N;
+            uint64_t m = 0;
+            for (uint32_t i = lo; i < hi; i++) {
+                const uint8_t sx = source_x[i], rx = replica_x[i];
+                const uint64_t c = (sx ^ rx) | (((sx | rx) ^ 1) & (uint8_t) (source[i] != replica[i]));
+                m |= c << (i - lo);
+            }
+            change_mask[w] |= m;
+            any |= m;
+        }
+        return any != 0;
+    }
+
+    // Save/restore the state: the source and replica planes.
+    void save_state(pv::StateWriter& w) const {
+        w.put_array(source.get(), N);
+        w.put_array(replica.get(), N);
+        w.put_array(source_x.get(), N);
+        w.put_array(replica_x.get(), N);
+    }
+    void restore_state(pv::StateReader& r) {
+        r.get_array(source.get(), N);
+        r.get_array(replica.get(), N);
+        r.get_array(source_x.get(), N);
+        r.get_array(replica_x.get(), N);
+        clear_changes();
+    }
+
+    // Positive clock edge: change mask, then bulk copy.
+    void pos_edge() {
+        if (!compute_change_mask()) return;
+        copy_plane(replica.get(), source.get());
+        memcpy(replica_x.get(), source_x.get(), N);
+        const_cast<Module*>(root_instance)->trigger_module(parent_module);
+        const_cast<Module*>(root_instance)->add_changed_register(this);
+    }
+
+    // Restore replica: copy replica planes back to source planes (parent is being re-evaluated).
+    inline void restore_replica() {
+        copy_plane(source.get(), replica.get());
+        memcpy(source_x.get(), replica_x.get(), N);
+    }
+
+    // Reset all elements to the state they had when instanced. As for a Register, if any element
+    // differs from its initial state, the parent is triggered and the array becomes a changed register.
+    void reset_to_instance_state() {
+        bool change = false;
+        for (uint32_t i = 0; i < N; i++) {
+            change |= replica_x[i] ? !init_x : (init_x || replica[i] != init_state);
+            source[i] = init_state;
+            source_x[i] = init_x;
+        }
+        if (change) {
+            const_cast<Module*>(root_instance)->trigger_module(parent_module);
+            const_cast<Module*>(root_instance)->add_changed_register(this);
+        }
+    }
+
+    // Activity counting: one signal per element.
+    uint32_t signal_count() const { return N; }
+    bool signal_changed(const uint32_t i) const { return (change_mask[i / 64] >> (i % 64)) & 1; }
+    void clear_changes() { memset(change_mask.get(), 0, num_mask_words * sizeof(uint64_t)); }
+
+    // VCD ID of element i: the IDs of a register array are consecutive.
+    inline std::string element_vcd_id(const uint32_t i) const { return vcd::id2string(signal_id + i); }
+
+    // VCD printer methods.
+    inline void emit_element(std::ostream* vcd_stream, const uint32_t i) const {
+        *vcd_stream << (replica_x[i] ? v2s->undefined() : (*v2s)(replica[i])) << (width > 1 ? " " : "")
+            << element_vcd_id(i) << std::endl;
+    }
+    void emit_vcd_definition(std::ostream* vcd_stream) {
+        for (uint32_t i = 0; i < N; i++)
+            *vcd_stream << "$var reg " << width << " " << element_vcd_id(i) << " " << name() << "[" << i << "]"
+                << vcd::width2index(width) << " $end" << std::endl;
+    }
+    void emit_vcd_dumpvars(std::ostream* vcd_stream) const {
+        for (uint32_t i = 0; i < N; i++)
+            emit_element(vcd_stream, i);
+    }
+    void emit_vcd_dumpon(std::ostream* vcd_stream) const { emit_vcd_dumpvars(vcd_stream); }
+    void emit_vcd_dumpoff(std::ostream* vcd_stream) const {
+        for (uint32_t i = 0; i < N; i++)
+            *vcd_stream << v2s->undefined() << (width > 1 ? " " : "") << element_vcd_id(i) << std::endl;
+    }
+    void emit_register(std::ostream* vcd_stream) const {
+        for (uint32_t w = 0; w < num_mask_words; w++)
+            for (uint64_t m = change_mask[w]; m; m &= m - 1)
+                emit_element(vcd_stream, w * 64 + __builtin_ctzll(m));
+    }
+
+    // Common code for all constructors.
+    void constructor_common(const T* init) {
+        source.reset(new T[N]);
+        replica.reset(new T[N]);
+        source_x.reset(new uint8_t[N]);
+        replica_x.reset(new uint8_t[N]);
+        change_mask.reset(new uint64_t[num_mask_words]());
+        v2s = vcd::shared_printer<T>(width);
+        init_x = init == NULL;
+        init_state = init ? pv::width_mask<T, W>::apply(*init) : T();
+        for (uint32_t i = 0; i < N; i++) {
+            source[i] = replica[i] = init_state;
+            source_x[i] = replica_x[i] = init_x;
+        }
+
+        // Allocate VCD IDs for elements 1 to N - 1 (element 0 uses the register's signal ID).
+        for (uint32_t i = 1; i < N; i++)
+            const_cast<Module*>(root_instance)->vcd_id_count()++;
+    }
+};
+
+// Definitions of compile-time constants (required if odr-used).
+template <typename T, uint32_t N, int W>
+constexpr uint32_t RegisterArray<T, N, W>::size;
+template <typename T, uint32_t N, int W>
+constexpr int RegisterArray<T, N, W>::width;
+
+#endif // _PV_REGISTER_ARRAY_H_
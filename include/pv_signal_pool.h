@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2023 Michael C Shebanow
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <memory>
+#include <cstring>
+
+#ifndef _PV_SIGNAL_POOL_H_
+#define _PV_SIGNAL_POOL_H_
+
+/*
+ * Struct-of-arrays signal storage.
+ *
+ * By default, the state of a wire (its current, old, and initial value and
+ * its 'x' states) lives inside the wire object, i.e., scattered across the
+ * user's Module objects. When the library is compiled with PV_SOA_SIGNALS
+ * defined, wires instead become thin handles (a chunk pointer and a slot
+ * index) into pools owned by the Testbench, one pool per wire type
+ * WireTemplateBase<T, W>. A pool stores the state of its wires as contiguous
+ * planes, in fixed-size chunks so that slots never move:
+ *
+ *      value[]  old_value[]  init_value[]  x[]  was_x[]  owner[]
+ *
+ * The negative clock edge then works on whole planes: change detection (for
+ * VCD dumps and activity counting) is a branch-free compare of the value and
+ * old_value planes into 64-bit change masks, and the update of the old state
+ * (old_value = value, was_x = x) is a bulk copy (memcpy for trivially
+ * copyable types). The Testbench no longer tracks individual changed wires.
+ *
+ * The trade-off: the negative edge touches every wire of the design instead of
+ * only the wires written during the clock, and every access to a wire's state
+ * goes through its chunk pointer. The backend pays off for designs where a
+ * large fraction of the wires change every clock. It requires every wire to
+ * be instanced under a Testbench, and it changes the order (but not the
+ * content) of the wire value changes in a VCD dump of each clock. Registers
+ * are not affected; RegisterArray<T, N> already stores banks of registers as
+ * planes.
+ */
+
+// Forward declarations.
+class WireBase;
+
+namespace pv {
+
+    // Type-independent interface of a signal pool, used by the Testbench.
+    class SignalPoolBase {
+    public:
+        virtual ~SignalPoolBase() {}
+
+        // Append the wires whose state differs from their state at the start of the clock.
+        virtual void collect_changes(std::vector<WireBase*>& changed) const = 0;
+
+        // Negative clock edge: the current state becomes the state at the start of the next clock.
+        virtual void neg_edge_update() = 0;
+    };
+
+    // Pool of the state of all wires of one type (T) and width (W).
+    template <typename T, int W>
+    class SignalPool final : public SignalPoolBase {
+    public:
+        // Slots per chunk and bytes of storage per slot.
+        static const uint32_t chunk_slots = (sizeof(T) <= 64) ? 1024 : 64;
+        static const size_t slot_bytes = 3 * sizeof(T) + 2 * sizeof(uint8_t) + sizeof(WireBase*);
+
+        // A chunk of slots: state planes plus the wire owning each slot (NULL if free).
+        struct Chunk {
+            Chunk(SignalPool* p) : pool(p), used(0) {}
+            SignalPool* pool;
+            uint32_t used;
+            T value[chunk_slots];
+            T old_value[chunk_slots];
+            T init_value[chunk_slots];
+            uint8_t x[chunk_slots];
+            uint8_t was_x[chunk_slots];
+            WireBase* owner[chunk_slots];
+        };
+
+        // Factory (see Testbench::signal_pool()).
+        static SignalPoolBase* create() { return new SignalPool(); }
+
+        // Allocate a slot for wire w, reusing slots of destroyed wires first.
+        void allocate(WireBase* w, Chunk*& c, uint16_t& slot) {
+            if (!free_slots.empty()) {
+                c = free_slots.back().first;
+                slot = free_slots.back().second;
+                free_slots.pop_back();
+            } else {
+                if (chunks.empty() || chunks.back()->used == chunk_slots)
+                    chunks.emplace_back(new Chunk(this));
+                c = chunks.back().get();
+                slot = c->used++;
+            }
+            c->owner[slot] = w;
+        }
+
+        // Release the slot of a destroyed wire. The slot is left in a state that never reads as changed.
+        void release(Chunk* c, const uint16_t slot) {
+            c->owner[slot] = NULL;
+            c->x[slot] = c->was_x[slot] = 1;
+            free_slots.push_back(std::make_pair(c, slot));
+        }
+
+        // Change detection: compare the planes 64 slots at a time into a change mask, then
+        // collect the owners of the slots set in the mask.
+        void collect_changes(std::vector<WireBase*>& changed) const {
+            for (typename std::vector<std::unique_ptr<Chunk> >::const_iterator it = chunks.begin();
+                it != chunks.end(); it++) {
+                const Chunk& c = **it;
+                for (uint32_t lo = 0; lo < c.used; lo += 64) {
+                    const uint32_t hi = (lo + 64 < c.used) ? lo + 64 : c.used;
+                    uint64_t m = 0;
+                    for (uint32_t i = lo; i < hi; i++) {
+                        const uint8_t x = c.x[i], wx = c.was_x[i];
+                        const uint64_t d = (x ^ wx) | (((x | wx) ^ 1) & (uint8_t) (c.value[i] != c.old_value[i]));
+                        m |= d << (i - lo);
+                    }
+                    for (; m; m &= m - 1)
+                        changed.push_back(c.owner[lo + __builtin_ctzll(m)]);
+                }
+            }
+        }
+
+        // Negative clock edge: bulk copy of the current planes into the old planes.
+        void neg_edge_update() {
+            for (typename std::vector<std::unique_ptr<Chunk> >::iterator it = chunks.begin();
+                it != chunks.end(); it++) {
+                Chunk& c = **it;
+                if (std::is_trivially_copyable<T>::value)
+                    memcpy((void*) c.old_value, (const void*) c.value, c.used * sizeof(T));
+                else
+                    std::copy(c.value, c.value + c.used, c.old_value);
+                memcpy(c.was_x, c.x, c.used);
+            }
+        }
+
+    private:
+        // Chunks and free slots.
+        std::vector<std::unique_ptr<Chunk> > chunks;
+        std::vector<std::pair<Chunk*, uint16_t> > free_slots;
+    };
+
+} // end namespace pv
+
+#endif // _PV_SIGNAL_POOL_H_
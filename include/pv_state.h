@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2023 Michael C Shebanow
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdexcept>
+#include <type_traits>
+#include <cstring>
+
+#ifndef _PV_STATE_H_
+#define _PV_STATE_H_
+
+/*
+ * Signal state serialization.
+ *
+ * Every wire and register is a pv::StateHolder: it can save its state (values,
+ * 'x' states, and any staged updates) to a pv::StateWriter and restore it from
+ * a pv::StateReader. State is saved as raw bytes, so values must be of a
+ * trivially copyable type; saving a signal of any other type throws
+ * std::runtime_error. Elaboration-time constants (initial values, widths,
+ * names) are not part of the state.
+ *
+ * The Testbench uses this interface for checkpoint files (see
+ * Testbench::save_checkpoint()) and in-memory snapshots (see
+ * Testbench::snapshot()).
+ */
+
+namespace pv {
+
+    // Growable byte buffer that state is saved to.
+    class StateWriter {
+    public:
+        // Append raw bytes, a value, or an array of values.
+        inline void put_bytes(const void* p, const size_t n) {
+            const size_t at = buf.size();
+            buf.resize(at + n);
+            if (n) memcpy(&buf[at], p, n);
+        }
+        template <typename T> inline void put(const T& v) { put_array(&v, 1); }
+        template <typename T> inline void put_array(const T* v, const size_t n) {
+            check_copyable<T>();
+            put_bytes((const void*) v, n * sizeof(T));
+        }
+
+        // Saved bytes.
+        inline const uint8_t* data() const { return buf.data(); }
+        inline size_t size() const { return buf.size(); }
+        inline void clear() { buf.clear(); }
+
+        // Throw if T cannot be saved as raw bytes.
+        template <typename T> static void check_copyable() {
+            if (!std::is_trivially_copyable<T>::value)
+                throw std::runtime_error(std::string("State of type ") + typeid(T).name() +
+                    " cannot be saved (not trivially copyable)");
+        }
+
+    private:
+        std::vector<uint8_t> buf;
+    };
+
+    // Reader of saved state. Reading past the end of the state throws std::runtime_error.
+    class StateReader {
+    public:
+        StateReader(const uint8_t* p, const size_t n) : ptr(p), end(p + n) {}
+
+        // Read raw bytes, a value, or an array of values.
+        inline void get_bytes(void* p, const size_t n) {
+            if (n) memcpy(p, take(n), n);
+        }
+        template <typename T> inline void get(T& v) { get_array(&v, 1); }
+        template <typename T> inline void get_array(T* v, const size_t n) {
+            StateWriter::check_copyable<T>();
+            get_bytes((void*) v, n * sizeof(T));
+        }
+
+        // Consume n bytes, returning a pointer to them.
+        inline const uint8_t* take(const size_t n) {
+            if (n > (size_t) (end - ptr))
+                throw std::runtime_error("Saved state is truncated");
+            const uint8_t* p = ptr;
+            ptr += n;
+            return p;
+        }
+
+        // Bytes left to read.
+        inline size_t remaining() const { return end - ptr; }
+
+    private:
+        const uint8_t* ptr;
+        const uint8_t* end;
+    };
+
+    // Interface of objects whose state can be saved and restored.
+    class StateHolder {
+    public:
+        virtual ~StateHolder() {}
+
+        // Save state; restore state saved by the same type of object.
+        virtual void save_state(StateWriter& w) const = 0;
+        virtual void restore_state(StateReader& r) = 0;
+
+        // Consume saved state as restore_state() would, without changing any state; throws
+        // std::runtime_error if the state could not be restored. By default, the state must have
+        // the size of the current state (overridden by objects whose state size varies).
+        virtual void check_state(StateReader& r) const {
+            StateWriter w;
+            save_state(w);
+            r.take(w.size());
+        }
+    };
+
+    // Handle of an in-memory snapshot (see Testbench::snapshot()).
+    typedef uint32_t SnapshotHandle;
+
+    // 64-bit FNV-1a hash, used for checkpoint schema hashes.
+    inline uint64_t fnv1a(const void* p, const size_t n, uint64_t h = 0xcbf29ce484222325ull) {
+        const uint8_t* b = (const uint8_t*) p;
+        for (size_t i = 0; i < n; i++)
+            h = (h ^ b[i]) * 0x100000001b3ull;
+        return h;
+    }
+    inline uint64_t fnv1a(const std::string& s, const uint64_t h = 0xcbf29ce484222325ull)
+        { return fnv1a(s.data(), s.size() + 1, h); }
+
+    // Checkpoint file header. The state of the design follows the header: one byte of
+    // flags per module, then, per signal, its state size (uint64_t) and its state.
+    struct CheckpointHeader {
+        char magic[8];                          // "PVCKPT" followed by two 0 bytes
+        uint32_t version;                       // file format version
+        uint32_t header_size;                   // sizeof(CheckpointHeader)
+        uint64_t schema_hash;                   // hash of the design hierarchy and signal types
+        uint64_t payload_size;                  // bytes following the header
+        uint32_t clock_num;                     // clock number
+        uint32_t run_time;                      // clocks in the last simulation() run
+        uint32_t cummulative_run_time;          // clocks in all simulation() runs
+        uint32_t num_modules;                   // number of modules
+        uint64_t num_signals;                   // number of signals (wires and registers)
+    };
+
+} // end namespace pv
+
+#endif // _PV_STATE_H_
@@ -42,6 +42,39 @@
  * clocks as required or allowed, driving the eval functions as needed.
  */
 
+namespace pv {
+
+    /*
+     * A clock agent is an object called by a Testbench at the start and at the end of each clock,
+     * right after the Testbench's own pre_clock() and post_clock(). Agents let reusable stimulus
+     * and checking components (e.g., the coroutine scheduler of pv_coroutine.h) hook into the
+     * clock without the testbench forwarding its pre_clock() and post_clock() calls. Agents are
+     * called in the order they were added.
+     */
+
+    class ClockAgent {
+    public:
+        virtual ~ClockAgent() {}
+        virtual void pre_clock(const uint32_t cycle_num) {}
+        virtual void post_clock(const uint32_t cycle_num) {}
+
+        // Does the agent depend on threads other than the simulation thread (e.g., the checker
+        // thread of a pv::TransactionMonitor)? Such threads do not exist in forked branches.
+        virtual bool has_threads() const { return false; }
+    };
+
+    // Result of one simulation branch forked from a common state (see Testbench::fork_branches()).
+    struct BranchResult {
+        uint32_t branch;                        // branch number (0 to N - 1)
+        int pid;                                // process ID of the branch (-1 if it could not be forked)
+        bool completed;                         // true if the branch returned (i.e., exit_code is valid)
+        int exit_code;                          // value returned by the branch
+        int status;                             // process status (see waitpid())
+        std::string output;                     // results written by the branch
+    };
+
+} // end namespace pv
+
 class Testbench : public Module {
 public:
     // Constructors, std::string and char* variants.
@@ -58,12 +91,41 @@ public:
     virtual void pre_clock(const uint32_t cycle_num) {}
     virtual void post_clock(const uint32_t cycle_num) {}
 
+    // Add/remove a clock agent (not owned by the testbench).
+    void add_clock_agent(pv::ClockAgent* a) { clock_agents.push_back(a); }
+    void remove_clock_agent(pv::ClockAgent* a) 
+        { clock_agents.erase(std::remove(clock_agents.begin(), clock_agents.end(), a), clock_agents.end()); }
+
+    // Add a clock domain (owned by the testbench) whose clock divides the Testbench clock by "divide",
+    // with its first positive edge at clock phase + 1. The registers assigned to a domain (see
+    // Module::set_clock_domain() and RegisterBase::set_clock_domain()) are clocked only at its edges.
+    pv::ClockDomain* add_clock_domain(const std::string& name, const uint32_t divide, const uint32_t phase = 0) {
+        if (divide == 0 || phase >= divide)
+            throw std::invalid_argument("Clock domain " + name + ": divide must be > 0 and phase < divide");
+        if (name.empty() || name.find_first_of(" \t\r\n") != std::string::npos)
+            throw std::invalid_argument("Clock domain name \"" + name + "\" is empty or has white space");
+        for (size_t i = 0; i < clock_domains.size(); i++)
+            if (clock_domains[i]->name() == name)
+                throw std::invalid_argument("Clock domain " + name + " already exists");
+        clock_domains.emplace_back(new pv::ClockDomain(name, divide, phase, (uint32_t) clock_domains.size()));
+        design_changed();
+        return clock_domains.back().get();
+    }
+    inline size_t clock_domain_count() const { return clock_domains.size(); }
+    inline const pv::ClockDomain* clock_domain(const size_t i) const { return clock_domains.at(i).get(); }
+
     /* 
      * Running a simulation. Code below runs all test cases. 
      *
      * Parameters controlling a simulation:
      * - set_vcd_writer(): point to a VCD writer class (by default 
      *     NULL => no VCD dump)
+     * - set_profiler(): point to a pv::Profiler to profile eval() calls per
+     *   module (by default NULL => no profiling)
+     * - set_trace_event_writer(): point to a pv::TraceEventWriter to record
+     *   simulation phases as Chrome trace events (by default NULL => none)
+     * - set_activity_counting(): accumulate per-signal transition, static write,
+     *   and toggle counts over the whole run (by default off)
      *      - writer->set_vcd_start_clock(): when to start dumping to a VCD
      *      - writer->set_vcd_stop_clock(): when to stop dumping to a VCD;
      *        vcd_stop_clock > vcd_start_clock
@@ -73,6 +135,8 @@ public:
      *      -1 => no limit
      * - set_iteration_limit(): set a limit on the number of eval() iterations
      *   per clock; -1 => no limit
+     * - set_oscillation_history(): set the number of delta iterations recorded
+     *   to diagnose an exceeded iteration limit; 0 => no recording (default 8)
      * - end_simulation(): call when you want to end a simulation now.
      */
 
@@ -83,18 +147,34 @@ public:
         { return opt_iteration_limit; }
     inline const int32_t get_idle_limit() const 
         { return opt_idle_limit; }
+    inline const uint32_t get_oscillation_history() const 
+        { return opt_oscillation_history; }
     inline const vcd::writer* get_vcd_writer() const 
         { return writer; }
+    inline const pv::Profiler* get_profiler() const 
+        { return profiler; }
+    inline const pv::TraceEventWriter* get_trace_event_writer() const 
+        { return trace_events; }
+    inline const bool get_activity_counting() const 
+        { return activity_counting; }
 
     // Simulation parameter setters.
     inline void set_vcd_writer(const vcd::writer* w) 
         { writer = const_cast<vcd::writer*>(w); }
+    inline void set_profiler(const pv::Profiler* p) 
+        { profiler = const_cast<pv::Profiler*>(p); }
+    inline void set_trace_event_writer(const pv::TraceEventWriter* w) 
+        { trace_events = const_cast<pv::TraceEventWriter*>(w); }
+    inline void set_activity_counting(const bool en) 
+        { activity_counting = counting_activity = en; if (en) activity.resize(vcd_id_counter); }
     inline void set_idle_limit(const int32_t idle_limit) 
         { opt_idle_limit = idle_limit; }
     inline void set_cycle_limit(const int32_t cycle_limit) 
         { opt_cycle_limit = cycle_limit; }
     inline void set_iteration_limit(const int32_t iteration_limit) 
         { opt_iteration_limit = iteration_limit; }
+    inline void set_oscillation_history(const uint32_t n) 
+        { opt_oscillation_history = n; delta_history.clear(); delta_history.resize(n); }
 
     // Simulation runtime getter.
     inline const uint32_t get_clock() const { return clock_num; }
@@ -107,6 +187,7 @@ public:
         uint32_t start_clock_num = clock_num;
         exit_simulation = false;
         exit_code = SIM_NORMAL_EXIT;
+        RunScope run_scope(*this);
 
         // If we are writing a VCD, generate header and definitions, initial state.
         // If dump start clock is positive non-zero, also execute a VCD dumpoff() command.
@@ -116,6 +197,7 @@ public:
             if (writer->get_vcd_start_clock() > 0) {
                 writer->emit_dumpoff();
                 writer->emit_x_clock();
+                vcd_domain_clocks_x();
                 writer->vcd_dumpoff(this);
                 writer->emit_dumpend();
                 writer->set_emitting_change(false);
@@ -134,6 +216,11 @@ public:
             // Increment clock number to the next numbered cycle.
             clock_num++;
 
+            // If recording trace events and this clock is sampled, time the whole clock.
+            pv::TraceEventWriter* tew = (trace_events && trace_events->is_sampled(clock_num)) ? 
+                trace_events : NULL;
+            pv::TraceScope clock_scope(tew, "clock", "clock", clock_num);
+
             // Mark all modules as having not had an eval() call yet.
             mark_no_eval(this);
 
@@ -141,7 +228,12 @@ public:
             trigger_on_force_eval_next_clock(this);
 
             // run pre-clock edge against the loaded test bench
-            this->pre_clock(clock_num);
+            {
+                pv::TraceScope scope(tew, "pre_clock", "phase", clock_num);
+                this->pre_clock(clock_num);
+                for (size_t i = 0; i < clock_agents.size(); i++)
+                    clock_agents[i]->pre_clock(clock_num);
+            }
 
             // If VCD dumps are active, handle start/stop clock events
             if (writer != NULL && writer->is_open()) {
@@ -160,15 +252,33 @@ public:
                 } else {
                     writer->emit_pos_edge_tick(clock_num);
                     writer->emit_pos_edge_clock();
+                    vcd_domain_clocks(2ull * clock_num);
                 }
             }
 
             // Clock all flops.
-            this->pos_edge(this);
-            if (writer && writer->is_open() && writer->get_emitting_change())
+            {
+                pv::TraceScope scope(tew, "pos_edge", "phase", clock_num);
+                if (clock_domains.empty())
+                    this->pos_edge(this);
+                else
+                    pos_edge_domains(clock_num);
+            }
+            if (writer && writer->is_open() && writer->get_emitting_change()) {
+                pv::TraceScope scope(tew, "vcd", "phase", clock_num);
                 for (std::set<const RegisterBase*>::const_iterator it = 
                     changed_registers.begin(); it != changed_registers.end(); it++)
                         const_cast<RegisterBase*>(*it)->emit_register(writer->get_stream());
+            }
+            if (activity_counting)
+                for (std::set<const RegisterBase*>::const_iterator it = 
+                    changed_registers.begin(); it != changed_registers.end(); it++)
+                        for (uint32_t i = 0; i < (*it)->signal_count(); i++)
+                            if ((*it)->signal_changed(i))
+                                record_toggle((*it)->signal_id + i, true);
+            for (std::set<const RegisterBase*>::const_iterator it = 
+                changed_registers.begin(); it != changed_registers.end(); it++)
+                    const_cast<RegisterBase*>(*it)->clear_changes();
             changed_registers.clear();
 
             // Guard the following code with a try-catch block as it can throw exceptions.
@@ -183,14 +293,33 @@ public:
                 while (!triggered.empty()) {
                     // We were non-idle, so set idles cycles to 0.
                     idle_cycles = 0;
+                    if (triggered.size() > stats.peak_triggered)
+                        stats.peak_triggered = triggered.size();
 
                     // If iteration limit in a clock exceeded, fail simulator.
-                    if (opt_iteration_limit > 0 && iteration_count++ == opt_iteration_limit) {
+                    if (opt_iteration_limit > 0 && iteration_count == opt_iteration_limit) {
                         std::stringstream err_str;
                         err_str << "iteration limit exceeded at clock cycle " << clock_num;
+                        oscillation_report = diagnose_oscillation(iteration_count);
+                        if (!oscillation_report.empty())
+                            err_str << "; " << oscillation_report.substr(0, oscillation_report.find('\n'));
                         exit_code = SIM_ERR_ITERATION_LIMIT;
                         throw std::runtime_error(err_str.str());
                     }
+                    iteration_count++;
+
+                    // Record this delta iteration in the oscillation history ring buffer.
+                    if (opt_oscillation_history) {
+                        delta_slot = &delta_history[iteration_count % opt_oscillation_history];
+                        delta_slot->clock = clock_num;
+                        delta_slot->iteration = iteration_count;
+                        delta_slot->evaluated.clear();
+                        delta_slot->triggers.clear();
+                    }
+
+                    // Time this delta iteration if recording trace events.
+                    pv::TraceScope delta_scope(tew, tew ? "delta " + std::to_string(iteration_count) : 
+                        std::string(), "delta", clock_num);
 
                     // Make a copy of run queue, then clear it.
                     std::set<const Module*> to_do_list(triggered);
@@ -199,13 +328,28 @@ public:
                     // Iterate through to do list, updating each module
                     for (std::set<const Module*>::const_iterator it = to_do_list.begin(); 
                         it != to_do_list.end(); it++) {
-                            if ((*it)->get_eval_has_been_called())
+                            const bool reeval = (*it)->get_eval_has_been_called();
+                            if (reeval)
                                 restore_register_replica_state(*it);
                             const_cast<Module*>(*it)->set_eval_has_been_called(true);
-                            const_cast<Module*>(*it)->eval();
+                            stats.evals++;
+                            if (delta_slot) delta_slot->evaluated.push_back(*it);
+                            current_eval_module = *it;
+                            pv::TraceScope eval_scope(tew, tew ? (*it)->instanceName() : std::string(), 
+                                "eval", clock_num);
+                            if (profiler) {
+                                uint64_t start_ticks = pv::cycle_clock::now();
+                                const_cast<Module*>(*it)->eval();
+                                profiler->record_eval(*it, reeval, pv::cycle_clock::now() - start_ticks);
+                            } else
+                                const_cast<Module*>(*it)->eval();
+                            current_eval_module = NULL;
                     }
                 }
+                delta_slot = NULL;
             } catch (const std::exception& e) {
+                delta_slot = NULL;
+                current_eval_module = NULL;
                 std::stringstream sstr;
                 sstr << "Simulation error: " << e.what();
                 exit_string = sstr.str();
@@ -213,23 +357,78 @@ public:
             }
             
             // Negative edge clock calls.
-            if (writer != NULL && writer->is_open() && writer->get_emitting_change()) {
-                for (std::set<const WireBase*>::const_iterator it = changed_wires.begin(); 
-                    it != changed_wires.end(); it++)
-                        const_cast<WireBase *>(*it)->emit_vcd_neg_edge_update(writer->get_stream());
+            const bool vcd_emitting = writer != NULL && writer->is_open() && writer->get_emitting_change();
+#ifdef PV_SOA_SIGNALS
+            // Struct-of-arrays signals: changed wires are found by comparing the pool planes.
+            pool_changes.clear();
+            if (vcd_emitting || activity_counting)
+                for (std::map<std::type_index, std::unique_ptr<pv::SignalPoolBase> >::const_iterator it = 
+                    signal_pools.begin(); it != signal_pools.end(); it++)
+                        it->second->collect_changes(pool_changes);
+            if (vcd_emitting) {
+                pv::TraceScope scope(tew, "vcd", "phase", clock_num);
+                for (size_t i = 0; i < pool_changes.size(); i++)
+                    pool_changes[i]->emit_vcd_neg_edge_update(writer->get_stream());
                 vcd_generate_falling_edge(clock_num);
             }
-            for (std::set<const WireBase*>::const_iterator it = changed_wires.begin(); 
-                it != changed_wires.end(); it++)
-                    const_cast<WireBase *>(*it)->neg_edge_update();
+            {
+                pv::TraceScope scope(tew, "neg_edge", "phase", clock_num);
+                for (std::map<std::type_index, std::unique_ptr<pv::SignalPoolBase> >::const_iterator it = 
+                    signal_pools.begin(); it != signal_pools.end(); it++)
+                        it->second->neg_edge_update();
+                if (activity_counting)
+                    for (size_t i = 0; i < pool_changes.size(); i++)
+                        record_toggle(pool_changes[i]->signal_id, false);
+            }
+#else
+            // Changed wires are batched by wire type. VCD dumps and activity counting need the
+            // distinct changed wires, listed in address order (for a deterministic dump order).
             changed_wires.clear();
-            dump_trace();
+            if (vcd_emitting || activity_counting) {
+                for (size_t i = 0; i < changed_wire_batches.size(); i++)
+                    for (size_t j = 0; j < changed_wire_batches[i].wires.size(); j++)
+                        if (changed_wire_batches[i].wires[j]->dirty)
+                            changed_wires.push_back(changed_wire_batches[i].wires[j]);
+                std::sort(changed_wires.begin(), changed_wires.end());
+                changed_wires.erase(std::unique(changed_wires.begin(), changed_wires.end()), changed_wires.end());
+            }
+            if (vcd_emitting) {
+                pv::TraceScope scope(tew, "vcd", "phase", clock_num);
+                for (size_t i = 0; i < changed_wires.size(); i++)
+                    const_cast<WireBase *>(changed_wires[i])->emit_vcd_neg_edge_update(writer->get_stream());
+                vcd_generate_falling_edge(clock_num);
+            }
+            {
+                pv::TraceScope scope(tew, "neg_edge", "phase", clock_num);
+                for (size_t i = 0; i < changed_wire_batches.size(); i++) {
+                    pv::ChangedWireBatch& b = changed_wire_batches[i];
+                    if (b.wires.empty()) continue;
+                    b.fn(b.wires.data(), b.wires.size());
+                    b.wires.clear();
+                }
+                if (activity_counting)
+                    for (size_t i = 0; i < changed_wires.size(); i++)
+                        record_toggle(changed_wires[i]->signal_id, false);
+            }
+#endif
+            {
+                pv::TraceScope scope(tew, "dump_trace", "phase", clock_num);
+                dump_trace();
+            }
 
-            // End of clock: clear iteration limit.
+            // End of clock: record delta depth, clear iteration limit.
+            stats.clocks++;
+            stats.delta_iterations += iteration_count;
+            stats.record_delta_depth(iteration_count);
             iteration_count = 0;
 
             // Run post-clock edge against the loaded test bench.
-            this->post_clock(clock_num);
+            {
+                pv::TraceScope scope(tew, "post_clock", "phase", clock_num);
+                this->post_clock(clock_num);
+                for (size_t i = 0; i < clock_agents.size(); i++)
+                    clock_agents[i]->post_clock(clock_num);
+            }
 
             // If we will hit the clock limit, record exit condition.
             if (opt_cycle_limit > 0 && clock_num == opt_cycle_limit) {
@@ -246,6 +445,7 @@ public:
             writer->set_emitting_change(true);
             writer->emit_pos_edge_tick(clock_num);
             writer->emit_x_clock();
+            vcd_domain_clocks_x();
             writer->vcd_dumpoff(this);
         }
 
@@ -261,7 +461,7 @@ public:
     // Marks end of simulation, sets exit code to code, and formats an optional error string.
     // (Leave fmt string NULL if no string desired). 
     template<typename ... Args> void end_simulation(const int code, const char* fmt, Args ... args) {
-        static char buffer[256]; 
+        char buffer[256];
         exit_simulation = true;
         exit_code = code;
         if (fmt) {
@@ -274,24 +474,524 @@ public:
     // Return error string.
     const std::string& error_string() const { return exit_string; }
 
+    // Return the diagnosis of the last exceeded iteration limit: the first line names the
+    // detected loop of modules and wires, followed by the recorded delta iterations.
+    const std::string& get_oscillation_report() const { return oscillation_report; }
+
     // Run time length getters.
     const uint32_t run_time() const { return run_time_delta; }
     const uint32_t cummulative_run_time() const { return cummulative_run_time_delta; }
 
     /*
-     * Method to reset all modules to their initial state when instanced.
+     * Simulation statistics: collected during every simulation() run and accumulated
+     * across runs. May be queried at any time, including from within a run.
+     */
+    const pv::SimulationStats get_statistics() const {
+        pv::SimulationStats s = stats;
+        if (stats_running)
+            s.wall_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - 
+                stats_run_start).count();
+        return s;
+    }
+    inline void print_statistics(std::ostream& os) const { get_statistics().print(os); }
+    inline void reset_statistics() { stats.reset(); }
+
+    /*
+     * Activity counters: per-signal counts indexed by signal ID, accumulated while
+     * activity counting is on. activity_report() prints the hottest signals
+     * (most writes) along with the toggle coverage of the design.
+     */
+    inline const std::vector<pv::ActivityRecord>& get_activity_counters() const 
+        { return activity; }
+    inline void reset_activity_counters() 
+        { activity.assign(vcd_id_counter, pv::ActivityRecord()); }
+    void activity_report(std::ostream& os, const size_t max_signals = 20) const {
+        // Recover signal names from the instance hierarchy.
+        std::vector<std::pair<std::string, char> > names(vcd_id_counter);
+        collect_signal_names(this, names);
+
+        // Sort signal IDs by total write count, hottest first; compute toggle coverage.
+        std::vector<uint32_t> ids;
+        uint32_t toggled = 0;
+        for (uint32_t i = 0; i < activity.size(); i++) {
+            if (activity[i].NTG) toggled++;
+            if (activity[i].NTR || activity[i].NST) ids.push_back(i);
+        }
+        std::sort(ids.begin(), ids.end(), [this](const uint32_t a, const uint32_t b) { 
+            uint64_t wa = activity[a].NTR + activity[a].NST, wb = activity[b].NTR + activity[b].NST;
+            return wa > wb || (wa == wb && a < b); });
+        if (ids.size() > max_signals)
+            ids.resize(max_signals);
+
+        // Print report.
+        size_t name_len = 4;
+        for (size_t i = 0; i < ids.size(); i++)
+            name_len = std::max(name_len, names[ids[i]].first.length());
+        std::string divider(name_len + 44, '-');
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.1f", activity.size() ? 100.0 * toggled / activity.size() : 0.0);
+        os << ">>> " << divider << std::endl;
+        os << ">>> Signal activity: " << toggled << " of " << activity.size() << " signals toggled ("
+           << buf << "% toggle coverage)" << std::endl;
+        os << ">>> T " << std::left << std::setw(name_len) << "Name" << std::right 
+           << std::setw(12) << "NTR" << std::setw(12) << "NST" << std::setw(12) << "NTG" << std::endl;
+        os << ">>> " << divider << std::endl;
+        for (size_t i = 0; i < ids.size(); i++)
+            os << ">>> " << names[ids[i]].second << " " << std::left << std::setw(name_len) 
+               << names[ids[i]].first << std::right << std::setw(12) << activity[ids[i]].NTR 
+               << std::setw(12) << activity[ids[i]].NST << std::setw(12) << activity[ids[i]].NTG << std::endl;
+        os << ">>> " << divider << std::endl;
+    }
+
+    /*
+     * Memory footprint: footprint_report() prints, per signal class (e.g., "Wire<bool, -1>"),
+     * the number of instances and the bytes they occupy (including storage owned by memories,
+     * FIFOs, and register arrays), followed by the size of the shared name table.
+     */
+    void footprint_report(std::ostream& os) const {
+        // Count instances and bytes per signal class.
+        std::map<std::string, std::pair<uint64_t, uint64_t> > classes;
+        collect_footprints(this, classes);
+
+        // Print report.
+        size_t name_len = 5;
+        uint64_t total_count = 0, total_bytes = 0;
+        for (std::map<std::string, std::pair<uint64_t, uint64_t> >::const_iterator it = classes.begin(); 
+            it != classes.end(); it++) {
+            name_len = std::max(name_len, it->first.length());
+            total_count += it->second.first;
+            total_bytes += it->second.second;
+        }
+        std::string divider(name_len + 36, '-');
+        os << ">>> " << divider << std::endl;
+        os << ">>> Signal memory footprint" << std::endl;
+        os << ">>> " << std::left << std::setw(name_len) << "Class" << std::right << std::setw(12) << "Count" 
+           << std::setw(12) << "Bytes" << std::setw(12) << "Bytes/inst" << std::endl;
+        os << ">>> " << divider << std::endl;
+        for (std::map<std::string, std::pair<uint64_t, uint64_t> >::const_iterator it = classes.begin(); 
+            it != classes.end(); it++)
+            os << ">>> " << std::left << std::setw(name_len) << it->first << std::right 
+               << std::setw(12) << it->second.first << std::setw(12) << it->second.second 
+               << std::setw(12) << it->second.second / it->second.first << std::endl;
+        os << ">>> " << divider << std::endl;
+        os << ">>> " << std::left << std::setw(name_len) << "Total" << std::right 
+           << std::setw(12) << total_count << std::setw(12) << total_bytes << std::endl;
+        os << ">>> Name table: " << pv::NameTable::size() << " names, " << pv::NameTable::bytes() 
+           << " bytes" << std::endl;
+        os << ">>> " << divider << std::endl;
+    }
+
+    /*
+     * Checkpoints: save_checkpoint() writes the complete simulation state to a binary file:
+     * the clock number and run time counters, the modules pending evaluation (triggered
+     * or marked by force_eval_next_clock()), and the state of every wire, register,
+     * memory, FIFO, and register array. restore_checkpoint() loads it back into the same
+     * design (same binary, same elaboration), after which simulation(true) continues from
+     * the checkpointed clock. Call either between simulation() runs (save_checkpoint() may
+     * also be called from post_clock()). The file (see pv::CheckpointHeader) holds a
+     * schema hash of the design hierarchy and signal types. The whole file, including the
+     * saved state of every signal, is validated before any state changes: restoring a file
+     * that does not match the design, or is not a valid checkpoint (e.g., truncated or with
+     * a corrupt signal state), prints an error and returns false without changing any
+     * state. Simulation parameters, statistics, activity counters, and
+     * traces are not part of a checkpoint. Signal values must be trivially copyable.
+     */
+    bool save_checkpoint(const std::string& file_name) const {
+        std::vector<const Module*> modules;
+        std::vector<CheckpointSignal> signals;
+        const uint64_t schema_hash = checkpoint_layout(modules, signals);
+
+        // Header (rewritten with the payload size at the end), module flags, then signal state.
+        std::ofstream os(file_name, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!os.is_open()) {
+            std::cerr << "File " << file_name << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+        pv::CheckpointHeader hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        memcpy(hdr.magic, "PVCKPT", 6);
+        hdr.version = checkpoint_version;
+        hdr.header_size = sizeof(hdr);
+        hdr.schema_hash = schema_hash;
+        hdr.clock_num = clock_num;
+        hdr.run_time = run_time_delta;
+        hdr.cummulative_run_time = cummulative_run_time_delta;
+        hdr.num_modules = modules.size();
+        hdr.num_signals = signals.size();
+        os.write((const char*) &hdr, sizeof(hdr));
+        std::vector<uint8_t> flags(modules.size());
+        for (size_t i = 0; i < modules.size(); i++)
+            flags[i] = module_state_flags(modules[i]);
+        os.write((const char*) flags.data(), flags.size());
+        hdr.payload_size = flags.size();
+        pv::StateWriter w;
+        for (size_t i = 0; i < signals.size(); i++) {
+            w.clear();
+            signals[i].holder->save_state(w);
+            const uint64_t n = w.size();
+            os.write((const char*) &n, sizeof(n));
+            os.write((const char*) w.data(), n);
+            hdr.payload_size += sizeof(n) + n;
+        }
+        os.seekp(0);
+        os.write((const char*) &hdr, sizeof(hdr));
+        os.close();
+        if (os.fail()) {
+            std::cerr << "File " << file_name << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+        return true;
+    }
+    bool restore_checkpoint(const std::string& file_name) {
+        // Map the file.
+        const int fd = open(file_name.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) < 0) {
+            std::cerr << "File " << file_name << ": " << strerror(errno) << std::endl;
+            if (fd >= 0) close(fd);
+            return false;
+        }
+        const size_t size = st.st_size;
+        if (size < sizeof(pv::CheckpointHeader)) {
+            std::cerr << "File " << file_name << ": not a checkpoint file" << std::endl;
+            close(fd);
+            return false;
+        }
+        void* p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED) {
+            std::cerr << "File " << file_name << ": mmap: " << strerror(errno) << std::endl;
+            return false;
+        }
+        const bool ok = restore_checkpoint(file_name, (const uint8_t*) p, size);
+        munmap(p, size);
+        return ok;
+    }
+
+    /*
+     * Snapshots: snapshot() saves the simulation state (as saved by save_checkpoint()) in
+     * memory and returns a handle to it; rewind() restores the state of a snapshot, e.g., to
+     * rerun the clocks leading to a failure with tracing or a VCD dump turned on. Snapshots
+     * are incremental: a snapshot only stores the state that changed since the previous
+     * snapshot (per signal, and per 4 KB chunk of the state of memories and other large
+     * signals), so taking one every few thousand clocks stays cheap in memory.
+     * Rewinding to a snapshot discards all later snapshots (the rewound simulation may take
+     * another course); the snapshot itself is kept and may be rewound to again. Take and
+     * rewind snapshots between simulation() runs; snapshot() may also be called from
+     * post_clock(), e.g., to take one every N clocks of a long run. The design must not
+     * change (no signals added or removed) while snapshots exist; clear_snapshots() releases
+     * all snapshots. VCD files, traces, and statistics are not rewound.
+     */
+    pv::SnapshotHandle snapshot() {
+        // The first snapshot fixes the signal layout.
+        if (snapshots.empty()) {
+            snapshot_modules.clear();
+            snapshot_signals.clear();
+            checkpoint_layout(snapshot_modules, snapshot_signals);
+            snapshot_generation = design_generation;
+            snapshot_latest.assign(snapshot_signals.size(), (size_t) no_snapshot_entry);
+            snapshot_latest_chunks.clear();
+        } else if (snapshot_generation != design_generation)
+            throw std::runtime_error("Testbench::snapshot(): design changed since the first snapshot");
+
+        // Module flags, then the chunks of signal state that differ from their latest saved state.
+        // Chunk 0 is also saved whenever the size of the state changes, as its entry holds the size.
+        SnapshotRecord rec = { clock_num, run_time_delta, cummulative_run_time_delta, 
+            snapshot_arena.size(), snapshot_entries.size() };
+        for (size_t i = 0; i < snapshot_modules.size(); i++)
+            snapshot_arena.push_back(module_state_flags(snapshot_modules[i]));
+        for (size_t i = 0; i < snapshot_signals.size(); i++) {
+            snapshot_writer.clear();
+            snapshot_signals[i].holder->save_state(snapshot_writer);
+            const uint64_t total = snapshot_writer.size();
+            const uint32_t num_chunks = snapshot_num_chunks(total);
+            const bool resized = snapshot_latest[i] == no_snapshot_entry || 
+                snapshot_entries[snapshot_latest[i]].total != total;
+            if (num_chunks > 1) snapshot_latest_chunks[i].resize(num_chunks - 1, (size_t) no_snapshot_entry);
+            else if (resized) snapshot_latest_chunks.erase(i);
+            for (uint32_t c = 0; c < num_chunks; c++) {
+                size_t& latest = c ? snapshot_latest_chunks[i][c - 1] : snapshot_latest[i];
+                const uint64_t at = (uint64_t) c * snapshot_chunk_bytes;
+                const uint32_t n = std::min((uint64_t) snapshot_chunk_bytes, total - at);
+                if (latest != no_snapshot_entry && !(resized && c == 0) && snapshot_entries[latest].size == n &&
+                    memcmp(&snapshot_arena[snapshot_entries[latest].offset], snapshot_writer.data() + at, n) == 0)
+                    continue;
+                SnapshotEntry e = { (uint32_t) i, c, n, total, snapshot_arena.size() };
+                snapshot_arena.insert(snapshot_arena.end(), snapshot_writer.data() + at, 
+                    snapshot_writer.data() + at + n);
+                latest = snapshot_entries.size();
+                snapshot_entries.push_back(e);
+            }
+        }
+        snapshots.push_back(rec);
+        return snapshots.size() - 1;
+    }
+    void rewind(const pv::SnapshotHandle h) {
+        if (h >= snapshots.size()) {
+            std::stringstream ss;
+            ss << "Testbench::rewind(): snapshot " << h << " does not exist";
+            throw std::out_of_range(ss.str());
+        }
+
+        // Discard later snapshots; the latest entries then hold the state of snapshot h.
+        if (h + 1 < snapshots.size()) {
+            snapshot_arena.resize(snapshots[h + 1].flags);
+            snapshot_entries.resize(snapshots[h + 1].first_entry);
+            snapshots.resize(h + 1);
+            snapshot_latest.assign(snapshot_signals.size(), (size_t) no_snapshot_entry);
+            snapshot_latest_chunks.clear();
+            for (size_t i = 0; i < snapshot_entries.size(); i++) {
+                const SnapshotEntry& e = snapshot_entries[i];
+                if (e.chunk == 0) snapshot_latest[e.signal] = i;
+                else {
+                    std::vector<size_t>& chunks = snapshot_latest_chunks[e.signal];
+                    if (chunks.size() < e.chunk) chunks.resize(e.chunk, (size_t) no_snapshot_entry);
+                    chunks[e.chunk - 1] = i;
+                }
+            }
+            for (std::unordered_map<uint32_t, std::vector<size_t> >::iterator it = snapshot_latest_chunks.begin();
+                it != snapshot_latest_chunks.end(); it++)
+                it->second.resize(snapshot_num_chunks(snapshot_entries[snapshot_latest[it->first]].total) - 1);
+        }
+
+        // Locate the state of each signal; state saved in several chunks is reassembled.
+        std::vector<std::pair<const uint8_t*, uint64_t> > blobs(snapshot_signals.size());
+        std::vector<uint8_t> assembled;
+        for (std::unordered_map<uint32_t, std::vector<size_t> >::const_iterator it = snapshot_latest_chunks.begin();
+            it != snapshot_latest_chunks.end(); it++)
+            assembled.resize(assembled.size() + snapshot_entries[snapshot_latest[it->first]].total);
+        size_t at = 0;
+        for (size_t i = 0; i < snapshot_signals.size(); i++) {
+            const SnapshotEntry& e = snapshot_entries[snapshot_latest[i]];
+            if (e.total == e.size) {
+                blobs[i] = std::make_pair(&snapshot_arena[0] + e.offset, e.total);
+                continue;
+            }
+            const std::vector<size_t>& chunks = snapshot_latest_chunks[i];
+            memcpy(&assembled[at], &snapshot_arena[e.offset], e.size);
+            for (size_t c = 0; c < chunks.size(); c++) {
+                const SnapshotEntry& ce = snapshot_entries[chunks[c]];
+                memcpy(&assembled[at + (c + 1) * snapshot_chunk_bytes], &snapshot_arena[ce.offset], ce.size);
+            }
+            blobs[i] = std::make_pair(&assembled[at], e.total);
+            at += e.total;
+        }
+        const SnapshotRecord& rec = snapshots[h];
+        restore_simulation_state(rec.clock_num, rec.run_time, rec.cummulative_run_time, snapshot_modules,
+            &snapshot_arena[rec.flags], snapshot_signals, blobs);
+    }
+    inline size_t snapshot_count() const { return snapshots.size(); }
+    inline uint32_t snapshot_clock(const pv::SnapshotHandle h) const { return snapshots.at(h).clock_num; }
+    inline size_t snapshot_bytes() const 
+        { return snapshot_arena.capacity() + snapshot_entries.capacity() * sizeof(SnapshotEntry); }
+    void clear_snapshots() {
+        snapshots.clear();
+        snapshot_entries.clear();
+        snapshot_latest.clear();
+        snapshot_latest_chunks.clear();
+        snapshot_arena.clear();
+        snapshot_arena.shrink_to_fit();
+    }
+
+    /*
+     * Simulation branches: fork_branches() forks n child processes from the current state of
+     * the simulation, e.g., after a long boot sequence has been simulated once. Each child calls
+     * body(branch, results) with its branch number (0 to n - 1); the body typically reseeds the
+     * stimulus, continues with simulation(true), writes its results to the results stream, and
+     * returns an exit code. The results and exit code are sent back through a pipe, and
+     * fork_branches() returns when all branches have ended, with one pv::BranchResult per branch.
+     * Children share the memory of the model copy-on-write. At most max_parallel branches run at
+     * a time (0 => no limit). In a child, the VCD and trace-event writers are unset (a branch may
+     * set its own); an exception thrown by the body ends the child with status 1 (completed is
+     * false). Call between simulation() runs. Only the calling thread exists in a child: forking
+     * while a clock agent depends on other threads (e.g., a pv::TransactionMonitor with a running
+     * pv::TransactionChecker, which would wait forever for its consumer) throws std::logic_error,
+     * and model code must not rely on other threads either.
      */
-    inline void reset_to_instance_state() { reset_module_to_init_state(this); }
+    std::vector<pv::BranchResult> fork_branches(const uint32_t n, 
+        const std::function<int(const uint32_t branch, std::ostream& results)>& body, const uint32_t max_parallel = 0) {
+        for (size_t i = 0; i < clock_agents.size(); i++)
+            if (clock_agents[i]->has_threads())
+                throw std::logic_error("Testbench::fork_branches(): a clock agent depends on threads "
+                    "that would not exist in the branches");
+        std::vector<pv::BranchResult> results(n);
+        std::vector<int> fds(n, -1);
+
+        // Flush buffered output so that children do not repeat it.
+        std::cout.flush();
+        std::cerr.flush();
+        fflush(NULL);
+        if (writer && writer->get_stream()) writer->get_stream()->flush();
+
+        uint32_t next = 0, running = 0;
+        std::vector<struct pollfd> pfds;
+        std::vector<uint32_t> polled;
+        char buf[65536];
+        while (next < n || running) {
+            // Start branches.
+            while (next < n && (max_parallel == 0 || running < max_parallel)) {
+                pv::BranchResult& r = results[next];
+                r.branch = next;
+                r.pid = -1;
+                r.completed = false;
+                r.exit_code = r.status = 0;
+                int fd[2];
+                if (pipe(fd) < 0) {
+                    r.output = std::string("pipe: ") + strerror(errno);
+                    next++;
+                    continue;
+                }
+                const pid_t pid = fork();
+                if (pid == 0) {
+                    close(fd[0]);
+                    for (uint32_t i = 0; i < next; i++)
+                        if (fds[i] >= 0) close(fds[i]);
+                    run_branch(next, fd[1], body);
+                }
+                close(fd[1]);
+                if (pid < 0) {
+                    close(fd[0]);
+                    r.output = std::string("fork: ") + strerror(errno);
+                } else {
+                    r.pid = pid;
+                    fds[next] = fd[0];
+                    running++;
+                }
+                next++;
+            }
+
+            // Collect output of running branches; a branch has ended when its pipe is closed.
+            pfds.clear();
+            polled.clear();
+            for (uint32_t i = 0; i < next; i++)
+                if (fds[i] >= 0) {
+                    pfds.push_back(pollfd{ fds[i], POLLIN, 0 });
+                    polled.push_back(i);
+                }
+            if (pfds.empty()) continue;
+            if (poll(pfds.data(), pfds.size(), -1) < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error(std::string("Testbench::fork_branches(): poll: ") + strerror(errno));
+            }
+            for (size_t k = 0; k < pfds.size(); k++) {
+                if (!pfds[k].revents) continue;
+                pv::BranchResult& r = results[polled[k]];
+                const ssize_t got = read(pfds[k].fd, buf, sizeof(buf));
+                if (got > 0) {
+                    r.output.append(buf, got);
+                    continue;
+                }
+                if (got < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+                close(pfds[k].fd);
+                fds[polled[k]] = -1;
+                running--;
+                while (waitpid(r.pid, &r.status, 0) < 0 && errno == EINTR) {}
+
+                // A branch that completed appended its exit code and a marker to its results.
+                if (WIFEXITED(r.status) && WEXITSTATUS(r.status) == 0 && r.output.size() >= 8 && 
+                    memcmp(&r.output[r.output.size() - 4], "PVBR", 4) == 0) {
+                    int32_t code;
+                    memcpy(&code, &r.output[r.output.size() - 8], 4);
+                    r.exit_code = code;
+                    r.completed = true;
+                    r.output.resize(r.output.size() - 8);
+                }
+            }
+        }
+        return results;
+    }
+
+    /*
+     * Method to reset all modules to their initial state when instanced. Wires and registers
+     * are reset in batches by type using a reset plan computed on first use (and recomputed
+     * whenever the design changes); the modules to trigger and the changed signals found by
+     * the batches are then applied in bulk. With activity counting on, the design is instead
+     * walked recursively so that every reset is recorded as a write.
+     */
+    void reset_to_instance_state() {
+        if (activity_counting) {
+            reset_module_to_init_state(this);
+            return;
+        }
+        if (reset_plan_generation != design_generation)
+            build_reset_plan();
+
+        // Run the batches, then apply their results.
+        pv::ResetBatchResult& r = reset_result;
+        r.wire_writes = 0;
+        for (size_t i = 0; i < wire_reset_plan.size(); i++) {
+            const WireResetBatch& b = wire_reset_plan[i];
+            b.fn(b.signals.data(), b.signals.size(), r);
+#ifndef PV_SOA_SIGNALS
+            for (size_t j = 0; j < r.changed_wires.size(); j++)
+                mark_changed_wire(r.changed_wires[j], r.neg_edge);
+#endif
+            r.changed_wires.clear();
+        }
+        stats.wire_writes += r.wire_writes;
+        for (size_t i = 0; i < register_reset_plan.size(); i++) {
+            const RegisterResetBatch& b = register_reset_plan[i];
+            b.fn(b.signals.data(), b.signals.size(), r);
+        }
+        for (size_t i = 0; i < r.changed_registers.size(); i++)
+            add_changed_register(r.changed_registers[i]);
+        r.changed_registers.clear();
+        const Module* last = NULL;
+        for (size_t i = 0; i < r.triggered.size(); i++)
+            if (r.triggered[i] != last) trigger_module(last = r.triggered[i]);
+        r.triggered.clear();
+
+        // Registers of other classes (memories, FIFOs, register arrays) reset individually.
+        for (size_t i = 0; i < register_reset_list.size(); i++)
+            register_reset_list[i]->reset_to_instance_state();
+    }
 
 protected:
     // VCD writer if enabled.
     vcd::writer* writer;
 
+    // eval() profiler if enabled.
+    pv::Profiler* profiler;
+
+    // Trace-event writer if enabled.
+    pv::TraceEventWriter* trace_events;
+
+    // Simulation statistics.
+    pv::SimulationStats stats;
+    bool stats_running;
+    std::chrono::steady_clock::time_point stats_run_start;
+
 private:
+    // Statistics and profiler run of one simulation() call, stopped when the call returns or
+    // an exception (from pre_clock(), post_clock(), a clock agent, ...) leaves it.
+    class RunScope {
+    public:
+        RunScope(Testbench& t) : tb(t), profiler(t.profiler) {
+            if (profiler) profiler->start_run();
+            tb.stats_run_start = std::chrono::steady_clock::now();
+            tb.stats_running = true;
+        }
+        RunScope(const RunScope& rs) = delete;
+        ~RunScope() {
+            if (profiler) profiler->stop_run();
+            tb.stats.wall_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - 
+                tb.stats_run_start).count();
+            tb.stats_running = false;
+        }
+
+    private:
+        Testbench& tb;
+        pv::Profiler* const profiler;
+    };
+
+    // Clock agents, called after pre_clock() and post_clock().
+    std::vector<pv::ClockAgent*> clock_agents;
+
     // Simulation parameters.
     int32_t opt_cycle_limit;
     int32_t opt_iteration_limit;
     int32_t opt_idle_limit;
+    uint32_t opt_oscillation_history;
 
     // Simulation control parameters.
     bool exit_simulation;
@@ -308,13 +1008,297 @@ private:
     // Module "run queue" (list of triggered modules)
     std::set<const Module*> triggered;
 
-    // Tracking changed wires and registers
-    std::set<const WireBase*> changed_wires;
+    // Oscillation diagnostics: ring buffer of the last delta iterations, the slot
+    // of the current iteration (NULL if not recording), the module being evaluated,
+    // and the report of the last exceeded iteration limit.
+    std::vector<pv::DeltaRecord> delta_history;
+    pv::DeltaRecord* delta_slot;
+    const Module* current_eval_module;
+    std::string oscillation_report;
+
+    // Tracking changed wires and registers. Changed wires are kept in batches by wire type
+    // (each batch with its negative edge handler), plus the index of the batch of each handler
+    // and the last batch used. changed_wires holds the distinct changed wires at a negative edge.
+    std::vector<pv::ChangedWireBatch> changed_wire_batches;
+    std::unordered_map<pv::NegEdgeBatchFn, size_t> changed_wire_batch_index;
+    size_t last_changed_wire_batch;
+    std::vector<const WireBase*> changed_wires;
     std::set<const RegisterBase*> changed_registers;
 
+#ifdef PV_SOA_SIGNALS
+    // Struct-of-arrays signal pools by wire type, and the wires found changed at a negative edge.
+    std::map<std::type_index, std::unique_ptr<pv::SignalPoolBase> > signal_pools;
+    std::vector<WireBase*> pool_changes;
+
+    // Return the pool for a wire type, creating it on first use.
+    pv::SignalPoolBase* signal_pool(const std::type_info& type, pv::SignalPoolBase* (*create)()) {
+        std::unique_ptr<pv::SignalPoolBase>& pool = signal_pools[std::type_index(type)];
+        if (!pool) pool.reset(create());
+        return pool.get();
+    }
+#endif
+
     // Counter tio record how many VCDs have been issued.
     uint32_t vcd_id_counter;
 
+    // Activity counting: flag and flat counter array indexed by signal ID.
+    bool activity_counting;
+    std::vector<pv::ActivityRecord> activity;
+
+    // Record a write to a signal: transition (change) or static write.
+    void record_activity(const uint32_t signal_id, const bool change) {
+        if (!activity_counting) return;
+        if (signal_id >= activity.size()) activity.resize(vcd_id_counter);
+        if (change) activity[signal_id].NTR++;
+        else activity[signal_id].NST++;
+    }
+
+    // Record a signal that changed value over a clock. Register changes also count as transitions.
+    void record_toggle(const uint32_t signal_id, const bool is_register) {
+        if (signal_id >= activity.size()) activity.resize(vcd_id_counter);
+        activity[signal_id].NTG++;
+        if (is_register) activity[signal_id].NTR++;
+    }
+
+    // Walk the instance hierarchy recording hierarchical names and type codes by signal ID.
+    void collect_signal_names(const Module* m, std::vector<std::pair<std::string, char> >& names) const {
+        for (std::set<const WireBase*>::const_iterator it = m->w_begin(); it != m->w_end(); it++)
+            if ((*it)->signal_id < names.size())
+                names[(*it)->signal_id] = std::make_pair((*it)->instanceName(), (*it)->type2char());
+        for (std::set<const RegisterBase*>::const_iterator it = m->r_begin(); it != m->r_end(); it++) {
+            const uint32_t n = (*it)->signal_count();
+            for (uint32_t i = 0; i < n && (*it)->signal_id + i < names.size(); i++)
+                names[(*it)->signal_id + i] = std::make_pair(n == 1 ? (*it)->instanceName() : 
+                    (*it)->instanceName() + "[" + std::to_string(i) + "]", 'R');
+        }
+        for (std::set<const Module*>::const_iterator it = m->m_begin(); it != m->m_end(); it++)
+            collect_signal_names(*it, names);
+    }
+
+    // Walk the instance hierarchy accumulating instance counts and bytes by (demangled) signal class.
+    void collect_footprints(const Module* m, std::map<std::string, std::pair<uint64_t, uint64_t> >& classes) const {
+        for (std::set<const WireBase*>::const_iterator it = m->w_begin(); it != m->w_end(); it++) {
+            std::pair<uint64_t, uint64_t>& c = classes[demangle(typeid(**it).name())];
+            c.first++;
+            c.second += (*it)->footprint();
+        }
+        for (std::set<const RegisterBase*>::const_iterator it = m->r_begin(); it != m->r_end(); it++) {
+            std::pair<uint64_t, uint64_t>& c = classes[demangle(typeid(**it).name())];
+            c.first++;
+            c.second += (*it)->footprint();
+        }
+        for (std::set<const Module*>::const_iterator it = m->m_begin(); it != m->m_end(); it++)
+            collect_footprints(*it, classes);
+    }
+
+    /*
+     * Checkpoint support (see save_checkpoint()).
+     */
+
+    // Checkpoint file format version.
+    static const uint32_t checkpoint_version = 1;
+
+    // A signal in checkpoint order.
+    struct CheckpointSignal {
+        uint32_t id;
+        pv::StateHolder* holder;
+        std::string name;
+        bool operator<(const CheckpointSignal& s) const { return id < s.id; }
+    };
+
+    // Collect modules in hierarchy order (depth first, children by name) and signals in signal
+    // ID order. Returns the schema hash of the design: module names, signal names and types.
+    uint64_t checkpoint_layout(std::vector<const Module*>& modules, std::vector<CheckpointSignal>& signals) const {
+        collect_checkpoint_modules(this, modules);
+        const uint32_t version = checkpoint_version;
+        uint64_t h = pv::fnv1a(&version, sizeof(version));
+        for (size_t i = 0; i < modules.size(); i++) {
+            const Module* m = modules[i];
+            h = pv::fnv1a(m->instanceName(), h);
+            for (std::set<const WireBase*>::const_iterator it = m->w_begin(); it != m->w_end(); it++)
+                signals.push_back(CheckpointSignal{ (*it)->signal_id, const_cast<WireBase*>(*it), 
+                    (*it)->instanceName() + " " + typeid(**it).name() });
+            for (std::set<const RegisterBase*>::const_iterator it = m->r_begin(); it != m->r_end(); it++)
+                signals.push_back(CheckpointSignal{ (*it)->signal_id, const_cast<RegisterBase*>(*it), 
+                    (*it)->instanceName() + " " + typeid(**it).name() });
+        }
+        std::sort(signals.begin(), signals.end());
+        for (size_t i = 0; i < signals.size(); i++)
+            h = pv::fnv1a(signals[i].name, h);
+        return h;
+    }
+    void collect_checkpoint_modules(const Module* m, std::vector<const Module*>& modules) const {
+        modules.push_back(m);
+        std::vector<const Module*> children(m->m_begin(), m->m_end());
+        std::stable_sort(children.begin(), children.end(), 
+            [](const Module* a, const Module* b) { return a->name() < b->name(); });
+        for (size_t i = 0; i < children.size(); i++)
+            collect_checkpoint_modules(children[i], modules);
+    }
+
+    // Restore a checkpoint from a mapped file. The file (framing, and the state of every signal, see
+    // pv::StateHolder::check_state()) is fully validated before any state changes.
+    bool restore_checkpoint(const std::string& file_name, const uint8_t* data, const size_t size) {
+        pv::CheckpointHeader hdr;
+        memcpy(&hdr, data, sizeof(hdr));
+        if (memcmp(hdr.magic, "PVCKPT\0\0", 8) != 0 || hdr.header_size != sizeof(hdr)) {
+            std::cerr << "File " << file_name << ": not a checkpoint file" << std::endl;
+            return false;
+        }
+        if (hdr.version != checkpoint_version) {
+            std::cerr << "File " << file_name << ": unsupported checkpoint version " << hdr.version << std::endl;
+            return false;
+        }
+        std::vector<const Module*> modules;
+        std::vector<CheckpointSignal> signals;
+        if (hdr.schema_hash != checkpoint_layout(modules, signals) || hdr.num_modules != modules.size() || 
+            hdr.num_signals != signals.size()) {
+            std::cerr << "File " << file_name << ": checkpoint does not match the design" << std::endl;
+            return false;
+        }
+
+        // Locate the module flags and the state of each signal.
+        pv::StateReader payload(data + sizeof(hdr), size - sizeof(hdr));
+        std::vector<std::pair<const uint8_t*, uint64_t> > blobs(signals.size());
+        try {
+            if (hdr.payload_size != payload.remaining())
+                throw std::runtime_error("size mismatch");
+            payload.take(modules.size());
+            for (size_t i = 0; i < signals.size(); i++) {
+                payload.get(blobs[i].second);
+                blobs[i].first = payload.take(blobs[i].second);
+                pv::StateReader r(blobs[i].first, blobs[i].second);
+                signals[i].holder->check_state(r);
+                if (r.remaining())
+                    throw std::runtime_error("Saved state of " + signals[i].name + " does not match");
+            }
+        } catch (const std::runtime_error& e) {
+            std::cerr << "File " << file_name << ": checkpoint is truncated or corrupt: " << e.what() << std::endl;
+            return false;
+        }
+
+        const uint8_t* flags = data + sizeof(hdr);
+        try {
+            restore_simulation_state(hdr.clock_num, hdr.run_time, hdr.cummulative_run_time, modules, flags, 
+                signals, blobs);
+        } catch (const std::exception& e) {
+            std::cerr << "File " << file_name << ": " << e.what() << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Restore the clock, the pending evaluations (one flag byte per module), and the signals (one state
+    // blob per signal). Signal restores re-register changed wires, which are not counted as wire writes.
+    void restore_simulation_state(const uint32_t clock, const uint32_t run_time, const uint32_t cummulative_run_time,
+        const std::vector<const Module*>& modules, const uint8_t* flags, const std::vector<CheckpointSignal>& signals,
+        const std::vector<std::pair<const uint8_t*, uint64_t> >& blobs) {
+        clock_num = clock;
+        run_time_delta = run_time;
+        cummulative_run_time_delta = cummulative_run_time;
+        triggered.clear();
+        for (size_t i = 0; i < modules.size(); i++) {
+            const_cast<Module*>(modules[i])->set_needs_evaluation(flags[i] & 1);
+            if (flags[i] & 2) triggered.insert(modules[i]);
+            if ((flags[i] & 4) || modules[i]->has_clock_gate())
+                const_cast<Module*>(modules[i])->set_clock_enable(!(flags[i] & 4));
+        }
+        changed_registers.clear();
+        for (size_t i = 0; i < changed_wire_batches.size(); i++)
+            changed_wire_batches[i].wires.clear();
+        const uint64_t wire_writes = stats.wire_writes;
+        for (size_t i = 0; i < signals.size(); i++) {
+            pv::StateReader r(blobs[i].first, blobs[i].second);
+            signals[i].holder->restore_state(r);
+            if (r.remaining())
+                throw std::runtime_error("Saved state of " + signals[i].name + " does not match");
+        }
+        stats.wire_writes = wire_writes;
+    }
+
+    // Module flags saved by checkpoints and snapshots: needs evaluation (1), triggered (2), and clock
+    // gate off (4).
+    inline uint8_t module_state_flags(const Module* m) const
+        { return (m->get_needs_evaluation() ? 1 : 0) | (triggered.count(m) ? 2 : 0) | (m->get_clock_enable() ? 0 : 4); }
+
+    // Body of a simulation branch (child process of fork_branches()): run the branch, send its
+    // results, exit code, and a marker through the pipe, then exit without running destructors.
+    void run_branch(const uint32_t branch, const int fd, 
+        const std::function<int(const uint32_t branch, std::ostream& results)>& body) {
+        writer = NULL;
+        trace_events = NULL;
+        std::ostringstream os;
+        int status = 0;
+        try {
+            const int32_t code = body(branch, os);
+            os.write((const char*) &code, sizeof(code));
+            os.write("PVBR", 4);
+        } catch (const std::exception& e) {
+            std::cerr << "Branch " << branch << ": " << e.what() << std::endl;
+            status = 1;
+        }
+        const std::string str = os.str();
+        for (size_t done = 0; done < str.size(); ) {
+            const ssize_t n = write(fd, str.data() + done, str.size() - done);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) { status = 1; break; }
+            done += n;
+        }
+        close(fd);
+        std::cout.flush();
+        std::cerr.flush();
+        fflush(NULL);
+        _exit(status);
+    }
+
+    /*
+     * Snapshot support (see snapshot()). The state of a signal is saved in chunks of
+     * snapshot_chunk_bytes, so a snapshot of a large memory only stores the chunks that
+     * changed. The arena holds, per snapshot, the module flags and the changed chunks;
+     * snapshot_entries locates the chunks, snapshot_latest is the index of the latest entry
+     * of chunk 0 of each signal, and snapshot_latest_chunks that of the other chunks of
+     * signals saved in more than one chunk. Snapshots use the signal layout computed by the
+     * first snapshot.
+     */
+    static const uint32_t snapshot_chunk_bytes = 4096;
+    static const size_t no_snapshot_entry = ~(size_t) 0;
+    struct SnapshotRecord {
+        uint32_t clock_num;
+        uint32_t run_time;
+        uint32_t cummulative_run_time;
+        size_t flags;               // arena offset of the module flags
+        size_t first_entry;         // index of the first entry of this snapshot
+    };
+    struct SnapshotEntry {
+        uint32_t signal;            // index in snapshot_signals
+        uint32_t chunk;             // chunk number
+        uint32_t size;              // bytes in this chunk
+        uint64_t total;             // bytes of state of the signal
+        size_t offset;              // arena offset of the chunk
+    };
+    std::vector<const Module*> snapshot_modules;
+    std::vector<CheckpointSignal> snapshot_signals;
+    uint64_t snapshot_generation;
+    std::vector<SnapshotRecord> snapshots;
+    std::vector<SnapshotEntry> snapshot_entries;
+    std::vector<size_t> snapshot_latest;
+    std::unordered_map<uint32_t, std::vector<size_t> > snapshot_latest_chunks;
+    std::vector<uint8_t> snapshot_arena;
+    pv::StateWriter snapshot_writer;
+
+    // Number of chunks of a signal with "total" bytes of state (at least one).
+    static inline uint32_t snapshot_num_chunks(const uint64_t total)
+        { return total > snapshot_chunk_bytes ? (total + snapshot_chunk_bytes - 1) / snapshot_chunk_bytes : 1; }
+
+    // Demangle a type name (returned unchanged if it cannot be demangled).
+    static std::string demangle(const char* mangled) {
+        int status = 0;
+        char* p = abi::__cxa_demangle(mangled, NULL, NULL, &status);
+        std::string str = (status == 0 && p) ? p : mangled;
+        free(p);
+        return str;
+    }
+
     /*
      * Calls related to tracing
      */
@@ -400,6 +1384,102 @@ private:
         value_change_map.clear();
     }
 
+    /*
+     * Oscillation diagnostics.
+     */
+
+    // Record a wire change that triggered a module, along with the module that wrote it.
+    void record_wire_trigger(const WireBase* theWire) 
+        { if (delta_slot) delta_slot->triggers.push_back(std::make_pair(current_eval_module, theWire)); }
+
+    // Analyze the recorded delta iterations: build the graph of modules connected by
+    // triggering wires (writer -> sensitized module), then find its strongly connected
+    // components. Components with a cycle are the oscillating loops.
+    std::string diagnose_oscillation(const uint32_t last_iteration) {
+        if (!opt_oscillation_history) return "";
+
+        // Gather edges from the recorded iterations, oldest first.
+        std::map<const Module*, std::set<const Module*> > graph;
+        std::map<std::pair<const Module*, const Module*>, std::set<const WireBase*> > edge_wires;
+        std::stringstream detail;
+        uint32_t first = last_iteration >= opt_oscillation_history ? last_iteration - opt_oscillation_history + 1 : 1;
+        for (uint32_t i = first; i <= last_iteration; i++) {
+            const pv::DeltaRecord& r = delta_history[i % opt_oscillation_history];
+            if (r.clock != clock_num || r.iteration != i) continue;
+            detail << "  iteration " << i << ": evaluated";
+            for (size_t j = 0; j < r.evaluated.size(); j++)
+                detail << " " << r.evaluated[j]->instanceName();
+            detail << "; changed";
+            for (size_t j = 0; j < r.triggers.size(); j++) {
+                const WireBase* w = r.triggers[j].second;
+                detail << " " << w->instanceName();
+                const Module* sensitized = w->sensitized_module();
+                if (r.triggers[j].first && sensitized) {
+                    graph[r.triggers[j].first].insert(sensitized);
+                    graph[sensitized];
+                    edge_wires[std::make_pair(r.triggers[j].first, sensitized)].insert(w);
+                }
+            }
+            detail << "\n";
+        }
+
+        // Tarjan's strongly connected components.
+        std::map<const Module*, int> index, lowlink;
+        std::set<const Module*> on_stack;
+        std::vector<const Module*> stack;
+        std::vector<std::set<const Module*> > loops;
+        int next_index = 0;
+        std::function<void(const Module*)> strongconnect = [&](const Module* v) {
+            index[v] = lowlink[v] = next_index++;
+            stack.push_back(v);
+            on_stack.insert(v);
+            for (std::set<const Module*>::const_iterator it = graph[v].begin(); it != graph[v].end(); it++) {
+                if (index.find(*it) == index.end()) {
+                    strongconnect(*it);
+                    lowlink[v] = std::min(lowlink[v], lowlink[*it]);
+                } else if (on_stack.count(*it))
+                    lowlink[v] = std::min(lowlink[v], index[*it]);
+            }
+            if (lowlink[v] == index[v]) {
+                std::set<const Module*> scc;
+                const Module* w;
+                do {
+                    w = stack.back();
+                    stack.pop_back();
+                    on_stack.erase(w);
+                    scc.insert(w);
+                } while (w != v);
+                if (scc.size() > 1 || graph[v].count(v))
+                    loops.push_back(scc);
+            }
+        };
+        for (std::map<const Module*, std::set<const Module*> >::const_iterator it = graph.begin(); 
+            it != graph.end(); it++)
+                if (index.find(it->first) == index.end())
+                    strongconnect(it->first);
+
+        // Format: one summary line naming each loop, then the iteration detail.
+        std::stringstream report;
+        if (loops.empty())
+            report << "no combinational loop found in the last " << (last_iteration - first + 1) << " iterations";
+        for (size_t i = 0; i < loops.size(); i++) {
+            std::set<const WireBase*> wires;
+            for (std::map<std::pair<const Module*, const Module*>, std::set<const WireBase*> >::const_iterator 
+                it = edge_wires.begin(); it != edge_wires.end(); it++)
+                    if (loops[i].count(it->first.first) && loops[i].count(it->first.second))
+                        wires.insert(it->second.begin(), it->second.end());
+            report << (i ? "; " : "") << "combinational loop through modules {";
+            for (std::set<const Module*>::const_iterator it = loops[i].begin(); it != loops[i].end(); it++)
+                report << (it == loops[i].begin() ? "" : ", ") << (*it)->instanceName();
+            report << "} via wires {";
+            for (std::set<const WireBase*>::const_iterator it = wires.begin(); it != wires.end(); it++)
+                report << (it == wires.begin() ? "" : ", ") << (*it)->instanceName();
+            report << "}";
+        }
+        report << "\n" << detail.str();
+        return report.str();
+    }
+
     /* 
      * vcd_id_count(): return current count of VCD IDs assigned.
      */
@@ -417,7 +1497,9 @@ private:
 
     // Method to search all instanced modules looking for those that need 
     // triggering due to force_eval_next_clock() call.
+    // Gated subtrees are skipped: their requests are kept until their clock is enabled.
     void trigger_on_force_eval_next_clock(const Module* m) {
+        if (!m->get_clock_enable()) return;
         if (m->get_needs_evaluation()) {
             trigger_module(m);
             const_cast<Module*>(m)->set_needs_evaluation(false);
@@ -426,8 +1508,14 @@ private:
             trigger_on_force_eval_next_clock(*it);
     }
 
-    // Method to mark all modules has not haveing had eval() called yet.
+    // Method to mark all modules has not haveing had eval() called yet. Gated subtrees are
+    // skipped (and counted in the gating statistics).
     void mark_no_eval(const Module* m) {
+        if (!m->get_clock_enable()) {
+            stats.gated_subtrees++;
+            stats.gated_modules += get_gate_counts(m).modules;
+            return;
+        }
         const_cast<Module*>(m)->set_eval_has_been_called(false);
         for (std::set<const Module*>::const_iterator it = m->m_begin(); it != m->m_end(); it++)
             mark_no_eval(*it);
@@ -439,6 +1527,66 @@ private:
             const_cast<RegisterBase*>(*it)->restore_replica();
     }
 
+    /*
+     * Reset plan (see reset_to_instance_state()): wires and registers grouped by reset
+     * handler (i.e., by type), plus the registers without a batch handler. The plan is valid
+     * while reset_plan_generation equals design_generation, which counts design changes.
+     */
+    template <typename S, typename F> struct ResetBatch {
+        ResetBatch(F f) : fn(f) {}
+        F fn;
+        std::vector<const S*> signals;
+    };
+    typedef ResetBatch<WireBase, pv::WireResetBatchFn> WireResetBatch;
+    typedef ResetBatch<RegisterBase, pv::RegisterResetBatchFn> RegisterResetBatch;
+    std::vector<WireResetBatch> wire_reset_plan;
+    std::vector<RegisterResetBatch> register_reset_plan;
+    std::vector<RegisterBase*> register_reset_list;
+    pv::ResetBatchResult reset_result;
+    uint64_t reset_plan_generation;
+    uint64_t design_generation;
+
+    // Count a change of the design.
+    void design_changed() { design_generation++; }
+
+    // Build the reset plan.
+    void build_reset_plan() {
+        wire_reset_plan.clear();
+        register_reset_plan.clear();
+        register_reset_list.clear();
+        std::unordered_map<pv::WireResetBatchFn, size_t> wire_index;
+        std::unordered_map<pv::RegisterResetBatchFn, size_t> register_index;
+        collect_reset_plan(this, wire_index, register_index);
+        reset_plan_generation = design_generation;
+    }
+    void collect_reset_plan(const Module* m, std::unordered_map<pv::WireResetBatchFn, size_t>& wire_index,
+        std::unordered_map<pv::RegisterResetBatchFn, size_t>& register_index) {
+        for (std::set<const WireBase*>::const_iterator it = m->w_begin(); it != m->w_end(); it++) {
+            const pv::WireResetBatchFn fn = (*it)->reset_batch_fn();
+            std::unordered_map<pv::WireResetBatchFn, size_t>::const_iterator b = wire_index.find(fn);
+            if (b == wire_index.end()) {
+                b = wire_index.insert(std::make_pair(fn, wire_reset_plan.size())).first;
+                wire_reset_plan.push_back(WireResetBatch(fn));
+            }
+            wire_reset_plan[b->second].signals.push_back(*it);
+        }
+        for (std::set<const RegisterBase*>::const_iterator it = m->r_begin(); it != m->r_end(); it++) {
+            const pv::RegisterResetBatchFn fn = (*it)->reset_batch_fn();
+            if (fn == NULL) {
+                register_reset_list.push_back(const_cast<RegisterBase*>(*it));
+                continue;
+            }
+            std::unordered_map<pv::RegisterResetBatchFn, size_t>::const_iterator b = register_index.find(fn);
+            if (b == register_index.end()) {
+                b = register_index.insert(std::make_pair(fn, register_reset_plan.size())).first;
+                register_reset_plan.push_back(RegisterResetBatch(fn));
+            }
+            register_reset_plan[b->second].signals.push_back(*it);
+        }
+        for (std::set<const Module*>::const_iterator it = m->m_begin(); it != m->m_end(); it++)
+            collect_reset_plan(*it, wire_index, register_index);
+    }
+
     // Method to reset a module and all it instances to its instance state.
     void reset_module_to_init_state(const Module* m) {
         for (std::set<const WireBase*>::const_iterator it = m->w_begin(); it != m->w_end(); it++)
@@ -449,13 +1597,52 @@ private:
             reset_module_to_init_state(*it);
     }
 
-    // Methods to add/remove changed wires and registers
-    void add_changed_wire(const WireBase* theWire) { changed_wires.insert(theWire); }
-    void remove_changed_wire(const WireBase* theWire) { changed_wires.erase(theWire); }
-    void add_changed_register(const RegisterBase* theRegister) { changed_registers.insert(theRegister); }
+    // Methods to add/remove changed wires and registers.
+    // Every wire write calls exactly one of add/remove_changed_wire(), so writes are counted here.
+    // A wire's dirty flag records whether it changed this clock; a wire is appended to the batch
+    // of its type when it becomes dirty, and a wire changed back is merely marked clean (its
+    // batch entry is skipped at the negative edge). With PV_SOA_SIGNALS, changed wires are found
+    // at the negative edge instead (see signal_pools).
+#ifdef PV_SOA_SIGNALS
+    void add_changed_wire(const WireBase* theWire, pv::NegEdgeBatchFn batch) { stats.wire_writes++; }
+    void remove_changed_wire(const WireBase* theWire) { stats.wire_writes++; }
+#else
+    void add_changed_wire(const WireBase* theWire, pv::NegEdgeBatchFn batch) {
+        stats.wire_writes++;
+        mark_changed_wire(theWire, batch);
+    }
+    void remove_changed_wire(const WireBase* theWire) {
+        stats.wire_writes++;
+        const_cast<WireBase*>(theWire)->dirty = false;
+    }
+
+    // Mark a wire dirty and append it to the batch of its type, unless it is already dirty.
+    void mark_changed_wire(const WireBase* theWire, pv::NegEdgeBatchFn batch) {
+        if (theWire->dirty) return;
+        const_cast<WireBase*>(theWire)->dirty = true;
+        if (last_changed_wire_batch >= changed_wire_batches.size() || 
+            changed_wire_batches[last_changed_wire_batch].fn != batch) {
+            std::unordered_map<pv::NegEdgeBatchFn, size_t>::const_iterator it = changed_wire_batch_index.find(batch);
+            if (it == changed_wire_batch_index.end()) {
+                it = changed_wire_batch_index.insert(std::make_pair(batch, changed_wire_batches.size())).first;
+                changed_wire_batches.push_back(pv::ChangedWireBatch(batch));
+            }
+            last_changed_wire_batch = it->second;
+        }
+        changed_wire_batches[last_changed_wire_batch].wires.push_back(theWire);
+    }
+#endif
+    void add_changed_register(const RegisterBase* theRegister) 
+        { stats.register_updates++; changed_registers.insert(theRegister); }
 
     // Methods to recursively clock all registers.
     void pos_edge(const Module* m) {
+        // Skip gated subtrees.
+        if (!m->get_clock_enable()) {
+            stats.gated_registers += get_gate_counts(m).registers;
+            return;
+        }
+
         // Clock all local registers first.
         for (std::set<const RegisterBase*>::const_iterator it = m->r_begin(); it != m->r_end(); it++)
             const_cast<RegisterBase*>(*it)->pos_edge();
@@ -465,10 +1652,114 @@ private:
             this->pos_edge(*it);
     }
 
+    /*
+     * Clock gates (see Module::set_clock_enable()): the number of modules and registers in the
+     * subtree of each clock gate, used for gating statistics. Valid while gate_plan_generation
+     * equals design_generation (declaring a clock gate counts as a design change).
+     */
+    struct GateCounts {
+        uint64_t modules;
+        uint64_t registers;
+    };
+    std::unordered_map<const Module*, GateCounts> gate_counts;
+    uint64_t gate_plan_generation;
+
+    // Return the subtree counts of clock gate m.
+    const GateCounts& get_gate_counts(const Module* m) {
+        if (gate_plan_generation != design_generation) {
+            gate_counts.clear();
+            count_gate_subtree(this);
+            gate_plan_generation = design_generation;
+        }
+        return gate_counts[m];
+    }
+    GateCounts count_gate_subtree(const Module* m) {
+        GateCounts c = { 1, (uint64_t) std::distance(m->r_begin(), m->r_end()) };
+        for (std::set<const Module*>::const_iterator it = m->m_begin(); it != m->m_end(); it++) {
+            const GateCounts s = count_gate_subtree(*it);
+            c.modules += s.modules;
+            c.registers += s.registers;
+        }
+        if (m->has_clock_gate()) gate_counts[m] = c;
+        return c;
+    }
+
+    /*
+     * Clock domains, and the registers clocked by each domain (index 0: the Testbench clock; index
+     * i + 1: clock_domains[i]), in groups by innermost clock gate (NULL: none). The plan is valid
+     * while domain_plan_generation equals design_generation (domain assignments count as design
+     * changes).
+     */
+    struct GateGroup {
+        const Module* gate;
+        std::vector<RegisterBase*> registers;
+    };
+    std::vector<std::unique_ptr<pv::ClockDomain> > clock_domains;
+    std::vector<std::vector<GateGroup> > domain_registers;
+    uint64_t domain_plan_generation;
+
+    // Clock the registers of the Testbench clock and of the domains with an edge at this clock,
+    // except for those of gated subtrees.
+    void pos_edge_domains(const uint32_t clock) {
+        if (domain_plan_generation != design_generation) {
+            domain_registers.assign(clock_domains.size() + 1, std::vector<GateGroup>());
+            collect_domain_registers(this, NULL);
+            domain_plan_generation = design_generation;
+        }
+        pos_edge_groups(domain_registers[0]);
+        for (size_t d = 0; d < clock_domains.size(); d++) {
+            if (!clock_domains[d]->has_edge(clock)) continue;
+            clock_domains[d]->edges++;
+            pos_edge_groups(domain_registers[d + 1]);
+        }
+    }
+    void pos_edge_groups(const std::vector<GateGroup>& groups) {
+        for (size_t g = 0; g < groups.size(); g++) {
+            const std::vector<RegisterBase*>& regs = groups[g].registers;
+            if (groups[g].gate && !groups[g].gate->is_clock_enabled()) {
+                stats.gated_registers += regs.size();
+                continue;
+            }
+            for (size_t i = 0; i < regs.size(); i++)
+                regs[i]->pos_edge();
+        }
+    }
+    void collect_domain_registers(const Module* m, const Module* gate) {
+        if (m->has_clock_gate()) gate = m;
+        for (std::set<const RegisterBase*>::const_iterator it = m->r_begin(); it != m->r_end(); it++) {
+            const pv::ClockDomain* d = (*it)->get_clock_domain();
+            if (d && (d->index >= clock_domains.size() || clock_domains[d->index].get() != d))
+                throw std::invalid_argument("Register " + (*it)->instanceName() + 
+                    ": clock domain " + d->name() + " is not a domain of this testbench");
+            std::vector<GateGroup>& groups = domain_registers[d ? d->index + 1 : 0];
+            if (groups.empty() || groups.back().gate != gate)
+                groups.push_back(GateGroup{ gate, std::vector<RegisterBase*>() });
+            groups.back().registers.push_back(const_cast<RegisterBase*>(*it));
+        }
+        for (std::set<const Module*>::const_iterator it = m->m_begin(); it != m->m_end(); it++)
+            collect_domain_registers(*it, gate);
+    }
+
+    // VCD helper: emit the clock domain clocks that change at half clock h (all of them if "all").
+    void vcd_domain_clocks(const uint64_t h, const bool all = false) {
+        for (size_t i = 0; i < clock_domains.size(); i++) {
+            const bool level = clock_domains[i]->level(h);
+            if (all || h == 0 || level != clock_domains[i]->level(h - 1))
+                writer->emit_domain_clock(clock_domains[i].get(), level ? '1' : '0');
+        }
+    }
+    void vcd_domain_clocks_x() {
+        for (size_t i = 0; i < clock_domains.size(); i++)
+            writer->emit_domain_clock(clock_domains[i].get(), 'x');
+    }
+
     // VCD helper: generate header and definitions.
     void vcd_generate_header() {
+        std::vector<const pv::ClockDomain*> domains;
+        for (size_t i = 0; i < clock_domains.size(); i++)
+            domains.push_back(clock_domains[i].get());
         writer->emit_header();
-        writer->vcd_definition(this, true);
+        writer->vcd_definition(this, true, domains);
         writer->emit_end_definitions();
     }
 
@@ -477,6 +1768,7 @@ private:
         writer->emit_pos_edge_tick(clock_num);
         writer->emit_dumpvars();
         writer->emit_pos_edge_clock();
+        vcd_domain_clocks(2ull * clock_num, true);
         writer->vcd_dumpvars(this);
         writer->emit_dumpend();
         writer->set_emitting_change(true);
@@ -486,12 +1778,14 @@ private:
     void vcd_generate_falling_edge(const uint32_t clock_num) {
         writer->emit_neg_edge_tick(clock_num);
         writer->emit_neg_edge_clock();
+        vcd_domain_clocks(2ull * clock_num + 1);
     }
 
     // VCD helper: vcd_dumpon: performs VCD dumpon command.
     void vcd_dumpon() {
         writer->emit_dumpon();
         writer->emit_pos_edge_clock();
+        vcd_domain_clocks(2ull * clock_num, true);
         writer->vcd_dumpon(this);
         writer->emit_dumpend();
         writer->set_emitting_change(true);
@@ -501,6 +1795,7 @@ private:
     void vcd_dumpoff() {
         writer->emit_dumpoff();
         writer->emit_x_clock();
+        vcd_domain_clocks_x();
         writer->vcd_dumpoff(this);
         writer->emit_dumpend();
         writer->set_emitting_change(false);
@@ -512,7 +1807,15 @@ private:
         opt_cycle_limit = -1;
         opt_iteration_limit = -1;
         opt_idle_limit = -1;
+        opt_oscillation_history = 8;
+        delta_history.resize(opt_oscillation_history);
+        delta_slot = NULL;
+        current_eval_module = NULL;
+        last_changed_wire_batch = 0;
         writer = NULL;
+        profiler = NULL;
+        trace_events = NULL;
+        stats_running = false;
         exit_simulation = false;
         exit_code = 0;
         exit_string.clear();
@@ -525,6 +1828,13 @@ private:
         clock_num = 0;
         vcd_id_counter = 0;
 
+        // Activity counting off by default.
+        activity_counting = false;
+
+        // No snapshots nor reset plan yet.
+        design_generation = 1;
+        snapshot_generation = reset_plan_generation = domain_plan_generation = gate_plan_generation = 0;
+
         // Init value change trace string size structure.
         value_change_sizes.max_instance_name_len = 0;
         value_change_sizes.max_width = 0;
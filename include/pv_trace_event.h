@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2023 Michael C Shebanow
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <chrono>
+
+#ifndef _PV_TRACE_EVENT_H_
+#define _PV_TRACE_EVENT_H_
+
+/*
+ * Trace-event export of simulation phases.
+ *
+ * The pv::TraceEventWriter class writes a file in the Chrome trace-event JSON
+ * format, which can be loaded in chrome://tracing or https://ui.perfetto.dev.
+ * When a writer is installed in a Testbench (see
+ * Testbench::set_trace_event_writer()), the phases of every sampled clock are
+ * recorded as "complete" events: the clock itself, pre_clock, pos_edge, vcd
+ * (VCD emission), each delta iteration, each module eval(), neg_edge,
+ * post_clock, and dump_trace. Events nest by time, so a viewer shows where
+ * time goes within a clock without an external profiler.
+ *
+ * To bound file size, only every Nth clock is recorded (see
+ * set_sample_interval(); by default every clock). Events are timed with
+ * std::chrono::steady_clock relative to writer construction, in microseconds.
+ *
+ * pv::TraceScope is the scoped timer used for instrumentation: it records an
+ * event spanning its lifetime, and does nothing if constructed with a NULL
+ * writer.
+ */
+
+namespace pv {
+
+    // Chrome trace-event file writer.
+    class TraceEventWriter {
+    public:
+        // Constructor: opens the file (or sets error flag for object).
+        TraceEventWriter(const std::string& file_name) {
+            trace_file.open(file_name, std::ios::out);
+            if (!trace_file.is_open()) {
+                std::cerr << "File " << file_name << ": " << strerror(errno) << std::endl;
+                file_is_open = false;
+            } else {
+                file_is_open = true;
+                trace_file << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [" << std::endl;
+            }
+            opt_sample_interval = 1;
+            num_events = 0;
+            origin = std::chrono::steady_clock::now();
+        }
+        TraceEventWriter() = delete;
+        TraceEventWriter(const TraceEventWriter& w) = delete;
+
+        // Destructor: terminates the JSON document and closes the file.
+        virtual ~TraceEventWriter() {
+            if (file_is_open) {
+                trace_file << std::endl << "]}" << std::endl;
+                trace_file.close();
+            }
+        }
+
+        // Return file open status.
+        inline bool is_open() const { return file_is_open; }
+
+        // Sampling: only clocks that are a multiple of the sample interval are recorded.
+        inline void set_sample_interval(const uint32_t n) { opt_sample_interval = n ? n : 1; }
+        inline uint32_t get_sample_interval() const { return opt_sample_interval; }
+        inline bool is_sampled(const uint32_t clock_num) const
+            { return file_is_open && (clock_num % opt_sample_interval) == 0; }
+
+        // Number of events written so far.
+        inline uint64_t get_num_events() const { return num_events; }
+
+        // Current time stamp (in microseconds since writer construction).
+        inline double now() const {
+            return std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - origin).count();
+        }
+
+        // Emit a complete ("X") event.
+        void emit_complete(const std::string& name, const char* category, const double ts,
+            const double dur, const uint32_t clock_num) {
+                if (!file_is_open) return;
+                char buf[96];
+                snprintf(buf, sizeof(buf), "\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, ", ts, dur);
+                trace_file << (num_events++ ? ",\n" : "") << "{\"name\": " << json_string(name) << ", \"cat\": \""
+                    << category << buf << "\"pid\": 1, \"tid\": 1, \"args\": {\"clock\": " << clock_num << "}}";
+        }
+
+    private:
+        // Output file.
+        bool file_is_open;
+        std::ofstream trace_file;
+
+        // Options and counters.
+        uint32_t opt_sample_interval;
+        uint64_t num_events;
+
+        // Time origin.
+        std::chrono::steady_clock::time_point origin;
+    };
+
+    // Scoped timer: emits a complete event covering its lifetime (if writer is non-NULL).
+    class TraceScope {
+    public:
+        TraceScope(TraceEventWriter* w, const char* nm, const char* cat, const uint32_t clk) :
+            writer(w), name(w ? nm : ""), category(cat), clock_num(clk), start(w ? w->now() : 0.0) {}
+        TraceScope(TraceEventWriter* w, const std::string& nm, const char* cat, const uint32_t clk) :
+            writer(w), name(w ? nm : ""), category(cat), clock_num(clk), start(w ? w->now() : 0.0) {}
+        TraceScope(const TraceScope& ts) = delete;
+        ~TraceScope()
+            { if (writer) writer->emit_complete(name, category, start, writer->now() - start, clock_num); }
+
+    private:
+        TraceEventWriter* writer;
+        const std::string name;
+        const char* category;
+        const uint32_t clock_num;
+        const double start;
+    };
+
+} // end namespace pv
+
+#endif // _PV_TRACE_EVENT_H_
@@ -0,0 +1,330 @@
+/*
+ * Copyright (c) 2023 Michael C Shebanow
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <stdexcept>
+
+#ifndef _PV_TRANSACTION_H_
+#define _PV_TRANSACTION_H_
+
+/*
+ * Transaction-level ports.
+ *
+ * Rather than writing the Inputs of a DUT one by one from pre_clock() or
+ * eval(), a testbench can describe stimulus as transactions (structs) and let
+ * small components move them to and from the signals of the DUT:
+ *
+ * - TransactionDriver<T> is a Module holding a queue of transactions that the
+ *   testbench fills in bulk ahead of time (push()). Each clock, the driver
+ *   pops one transaction and calls a drive function that assigns it to the
+ *   Inputs of the DUT (the transaction is applied for the whole clock, and
+ *   sampled by the DUT's registers at the next edge). When the queue is empty,
+ *   an optional idle function is called instead. The driver's register "txn"
+ *   counts the transactions driven (and shows the transaction number in VCD
+ *   dumps).
+ * - pv::TransactionMonitor<T> is a pv::ClockAgent that calls a sample function
+ *   at the end of each clock (once the wires have settled). If the sample
+ *   function reports a transaction, the monitor pushes it into a lock-free
+ *   single-producer single-consumer queue (pv::SpscQueue<T>). If the queue is
+ *   full, the monitor waits for the consumer (see pv::Backoff), or throws
+ *   std::logic_error if no checker is running.
+ * - pv::TransactionChecker<T> consumes the transactions of a monitor in a
+ *   thread of its own, concurrently with the simulation, calling a check
+ *   function on each one and counting failures. finish() waits for all
+ *   observed transactions to be checked. A monitor has one running checker at
+ *   a time; a checker created after finish() continues with the transactions
+ *   observed since. While no transactions arrive, the checker backs off to
+ *   sleeping, so an idle checker does not keep a core busy.
+ *
+ * The driver is deterministic (it never depends on the checker), so
+ * simulation results do not depend on thread timing; only the check function
+ * runs concurrently and must not access the design. Transaction queues are
+ * testbench state: they are not part of checkpoints and snapshots, nor reset
+ * by reset_to_instance_state(). Programs using a TransactionChecker must be
+ * linked with -pthread.
+ */
+
+namespace pv {
+
+    // Lock-free single-producer single-consumer queue (bounded ring buffer).
+    template <typename T>
+    class SpscQueue {
+    public:
+        // Constructor: capacity is rounded up to a power of two.
+        SpscQueue(const size_t capacity = 4096) : mask(round_up(capacity) - 1),
+            slots(new T[mask + 1]), head(0), cached_tail(0), tail(0), cached_head(0), closed(false) {}
+        SpscQueue(const SpscQueue& q) = delete;
+
+        // Producer: append t; returns false if the queue is full.
+        bool push(const T& t) {
+            const size_t t0 = tail.load(std::memory_order_relaxed);
+            if (t0 - cached_head > mask) {
+                cached_head = head.load(std::memory_order_acquire);
+                if (t0 - cached_head > mask) return false;
+            }
+            slots[t0 & mask] = t;
+            tail.store(t0 + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer: remove the oldest entry into t; returns false if the queue is empty.
+        bool pop(T& t) {
+            const size_t h0 = head.load(std::memory_order_relaxed);
+            if (h0 == cached_tail) {
+                cached_tail = tail.load(std::memory_order_acquire);
+                if (h0 == cached_tail) return false;
+            }
+            t = slots[h0 & mask];
+            head.store(h0 + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Producer: no more entries will be pushed (until the queue is reopened for a new consumer).
+        inline void close() { closed.store(true, std::memory_order_release); }
+        inline void reopen() { closed.store(false, std::memory_order_release); }
+        inline bool is_closed() const { return closed.load(std::memory_order_acquire); }
+
+        // Entries in the queue (approximate while the other side is running), and capacity.
+        inline size_t size() const { return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire); }
+        inline bool empty() const { return size() == 0; }
+        inline size_t capacity() const { return mask + 1; }
+
+    private:
+        static size_t round_up(const size_t n) { size_t c = 1; while (c < n) c <<= 1; return c; }
+
+        // Ring buffer. The consumer's and the producer's indices are on separate cache lines (padded
+        // rather than aligned, so no over-aligned new is needed); each side also caches the other
+        // side's index to avoid reading it on every access.
+        const size_t mask;
+        std::unique_ptr<T[]> slots;
+        char pad0[64];
+        std::atomic<size_t> head;
+        size_t cached_tail;                             // consumer's copy of tail
+        char pad1[64];
+        std::atomic<size_t> tail;
+        size_t cached_head;                             // producer's copy of head
+        std::atomic<bool> closed;
+        char pad2[64];
+    };
+
+    // Backoff of a thread waiting on a queue: spin briefly, then yield, then sleep for exponentially
+    // longer periods (up to about 1 ms) until reset() is called.
+    class Backoff {
+    public:
+        Backoff() : waits(0) {}
+        inline void reset() { waits = 0; }
+        void wait() {
+            waits++;
+            if (waits <= spin_waits) return;
+            if (waits <= spin_waits + yield_waits) {
+                std::this_thread::yield();
+                return;
+            }
+            const uint32_t shift = std::min<uint32_t>(waits - spin_waits - yield_waits, 10);
+            std::this_thread::sleep_for(std::chrono::microseconds(1u << shift));
+        }
+
+    private:
+        static const uint32_t spin_waits = 64;
+        static const uint32_t yield_waits = 64;
+        uint32_t waits;
+    };
+
+} // end namespace pv
+
+template <typename T>
+class TransactionDriver : public Module {
+public:
+    // Drive function (assigns a transaction to the DUT's Inputs) and idle function (no transaction).
+    typedef std::function<void(const T& t)> DriveFunction;
+    typedef std::function<void()> IdleFunction;
+
+    // Constructors.
+    TransactionDriver(const Module* p, const std::string& nm, const DriveFunction& drive,
+        const IdleFunction& idle = IdleFunction()) : Module(p, nm), txn(this, "txn", 0),
+            drive(drive), idle(idle), base(0), next_txn(0) {}
+    TransactionDriver() = delete;
+    TransactionDriver(const TransactionDriver& d) = delete;
+
+    // Queue transactions, one or in bulk. They are driven from the next clock on.
+    void push(const T& t) { compact(); queue.push_back(t); force_eval_next_clock(); }
+    template <typename It>
+    void push(It first, It last) { compact(); queue.insert(queue.end(), first, last); force_eval_next_clock(); }
+
+    // Discard the transactions not yet driven.
+    void clear() { queue.clear(); base = next_txn; }
+
+    // Transactions driven so far (including the current clock's), and transactions waiting.
+    inline uint64_t get_driven() const { return next_txn; }
+    inline size_t pending() const { return queue.size() - std::min<uint64_t>(done(), queue.size()); }
+
+    // Each clock, drive the next transaction (or idle).
+    void eval() {
+        const uint64_t i = txn;
+        next_txn = i;
+        if (i >= base && i - base < queue.size()) {
+            drive(queue[i - base]);
+            txn <= ++next_txn;
+        } else if (idle)
+            idle();
+    }
+
+private:
+    // Transactions driven (index of the transaction of the current clock).
+    Register<uint64_t> txn;
+
+    // Drive and idle functions.
+    DriveFunction drive;
+    IdleFunction idle;
+
+    // Queue: transaction "base" is at queue[0]; next_txn is the value of txn after the next edge.
+    std::vector<T> queue;
+    uint64_t base;
+    uint64_t next_txn;
+
+    // Drop the transactions already driven once they are the larger part of the queue.
+    void compact() {
+        const uint64_t n = std::min<uint64_t>(done(), queue.size());
+        if (n >= 1024 && 2 * n >= queue.size()) {
+            queue.erase(queue.begin(), queue.begin() + n);
+            base += n;
+        }
+    }
+
+    // Queued transactions already driven.
+    inline uint64_t done() const { return next_txn > base ? next_txn - base : 0; }
+};
+
+namespace pv {
+
+    template <typename T> class TransactionChecker;
+
+    // Monitor of DUT outputs, pushing observed transactions into a lock-free queue.
+    template <typename T>
+    class TransactionMonitor : public ClockAgent {
+    public:
+        // Sample function: returns true (and fills t) if there is a transaction this clock.
+        typedef std::function<bool(T& t)> SampleFunction;
+
+        // Constructor/destructor: adds itself to (removes itself from) the clock agents of tb.
+        TransactionMonitor(Testbench* tb, const SampleFunction& sample, const size_t capacity = 4096) :
+            tb(tb), sample(sample), queue(capacity), observed(0), stalls(0), consumers(0) 
+                { tb->add_clock_agent(this); }
+        TransactionMonitor(const TransactionMonitor& m) = delete;
+        virtual ~TransactionMonitor() { tb->remove_clock_agent(this); }
+
+        // Sample at the end of each clock. Waits for the consumer if the queue is full; with no
+        // running checker to wait for, a full queue is an error.
+        void post_clock(const uint32_t cycle_num) override {
+            T t;
+            if (!sample(t)) return;
+            if (!queue.push(t)) {
+                if (consumers == 0 || queue.is_closed())
+                    throw std::logic_error("TransactionMonitor::post_clock(): the transaction queue is full "
+                        "and no checker is running");
+                stalls++;
+                Backoff backoff;
+                while (!queue.push(t))
+                    backoff.wait();
+            }
+            observed++;
+        }
+
+        // Queue of observed transactions, and counts of observed transactions and full queue stalls.
+        inline SpscQueue<T>& get_queue() { return queue; }
+        inline uint64_t get_observed() const { return observed; }
+        inline uint64_t get_stalls() const { return stalls; }
+
+        // The monitor depends on the thread of a running checker (see Testbench::fork_branches()).
+        bool has_threads() const override { return consumers > 0; }
+
+    private:
+        friend class TransactionChecker<T>;
+        Testbench* tb;
+        SampleFunction sample;
+        SpscQueue<T> queue;
+        uint64_t observed;
+        uint64_t stalls;
+        uint32_t consumers;                             // running checkers
+    };
+
+    // Checker of the transactions of a monitor, running in a thread of its own.
+    template <typename T>
+    class TransactionChecker {
+    public:
+        // Check function: returns false if transaction number n (0, 1, ...) fails.
+        typedef std::function<bool(const T& t, const uint64_t n)> CheckFunction;
+
+        // Constructor: (re)opens the monitor's queue and starts the checker thread. A monitor
+        // has at most one running checker (its queue has a single consumer).
+        TransactionChecker(TransactionMonitor<T>& m, const CheckFunction& check) :
+            monitor(attach(m)), queue(m.get_queue()), check(check), checked(0), failures(0),
+            thread(&TransactionChecker::consume, this) {}
+        TransactionChecker(const TransactionChecker& c) = delete;
+        ~TransactionChecker() { finish(); }
+
+        // Wait until all transactions observed so far are checked, then stop the thread.
+        void finish() {
+            if (!thread.joinable()) return;
+            queue.close();
+            thread.join();
+            monitor.consumers--;
+        }
+
+        // Transactions checked and failed.
+        inline uint64_t get_checked() const { return checked.load(std::memory_order_acquire); }
+        inline uint64_t get_failures() const { return failures.load(std::memory_order_acquire); }
+
+    private:
+        TransactionMonitor<T>& monitor;
+        SpscQueue<T>& queue;
+        CheckFunction check;
+        std::atomic<uint64_t> checked;
+        std::atomic<uint64_t> failures;
+        std::thread thread;
+
+        // Attach to a monitor without a running checker.
+        static TransactionMonitor<T>& attach(TransactionMonitor<T>& m) {
+            if (m.consumers > 0)
+                throw std::logic_error("TransactionChecker(): the monitor already has a running checker");
+            m.queue.reopen();
+            m.consumers++;
+            return m;
+        }
+
+        // Thread body: check transactions until the queue is closed and drained.
+        void consume() {
+            T t;
+            Backoff backoff;
+            for (;;) {
+                if (queue.pop(t)) {
+                    if (!check(t, checked.load(std::memory_order_relaxed)))
+                        failures.fetch_add(1, std::memory_order_release);
+                    checked.fetch_add(1, std::memory_order_release);
+                    backoff.reset();
+                } else if (queue.is_closed()) {
+                    if (queue.empty()) return;
+                } else
+                    backoff.wait();
+            }
+        }
+    };
+
+} // end namespace pv
+
+#endif // _PV_TRANSACTION_H_
@@ -21,6 +21,10 @@
  * Value change record for tracing.
  */
 
+// Forward declarations.
+class Module;
+class WireBase;
+
 namespace pv {
     // This record records information about traced entities.
     struct ValueChangeRecord {
@@ -39,6 +43,53 @@ namespace pv {
         int max_instance_name_len;              // max number of characters in any instance name
         int max_width;                          // maximum width
     };
+
+    // This record captures one delta (eval) iteration for combinational oscillation diagnostics:
+    // the modules evaluated and, for each wire change that triggered a module, the module that was
+    // being evaluated when the wire was written (NULL if written outside of any eval()).
+    struct DeltaRecord {
+        uint32_t clock;                                                 // clock number
+        uint32_t iteration;                                             // delta iteration in clock
+        std::vector<const Module*> evaluated;                           // modules evaluated
+        std::vector<std::pair<const Module*, const WireBase*> > triggers; // (writer, wire) pairs
+    };
+
+    // This record accumulates activity of a single signal over a whole run (see
+    // Testbench::set_activity_counting()). Records are kept in a flat array indexed by signal ID.
+    struct ActivityRecord {
+        uint64_t NTR;                           // # of writes changing the current value (transitions)
+        uint64_t NST;                           // # of writes leaving the current value unchanged (static)
+        uint64_t NTG;                           // # of clocks ending with a changed value (toggles)
+    };
+
+    // Interned signal names. Wires and registers hold a pointer to a single shared copy of their
+    // (local) name rather than a std::string each; names repeat heavily across instances of a
+    // module. Entries are never removed, so returned pointers remain valid for the whole run.
+    class NameTable {
+    public:
+        // Return the shared copy of a name, adding it if not present.
+        static const std::string* intern(const std::string& name) {
+            std::lock_guard<std::mutex> guard(lock());
+            return &*names().insert(name).first;
+        }
+
+        // Number of distinct names and the bytes they occupy (strings plus heap buffers).
+        static size_t size() {
+            std::lock_guard<std::mutex> guard(lock());
+            return names().size();
+        }
+        static size_t bytes() {
+            std::lock_guard<std::mutex> guard(lock());
+            size_t n = 0;
+            for (std::unordered_set<std::string>::const_iterator it = names().begin(); it != names().end(); it++)
+                n += sizeof(std::string) + (it->capacity() > 15 ? it->capacity() + 1 : 0);
+            return n;
+        }
+
+    private:
+        static std::unordered_set<std::string>& names() { static std::unordered_set<std::string> s; return s; }
+        static std::mutex& lock() { static std::mutex m; return m; }
+    };
 } // end namespace pv
 
 /*
@@ -137,6 +188,35 @@ namespace vcd {
         }
     };
 
+    /*
+     * shared_printer<T>(w): the shared printer for type T at width w. Printers carry no state other
+     * than their width, so rather than each signal holding its own printer object, all signals of
+     * the same type and width point to one printer, created on first use and kept for the run.
+     */
+
+    template <typename T>
+    const value2string_t<T>* shared_printer(const int w) {
+        static std::mutex lock;
+        static std::map<int, std::unique_ptr<value2string_t<T> > > printers;
+        std::lock_guard<std::mutex> guard(lock);
+        std::unique_ptr<value2string_t<T> >& p = printers[w];
+        if (!p) {
+            p.reset(new value2string_t<T>(T()));
+            p->set_width(w);
+        }
+        return p.get();
+    }
+
+    /*
+     * id2string(): convert a signal ID to its VCD identifier (i.e., "@<hex id>").
+     */
+
+    inline std::string id2string(const uint32_t id) {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "@%x", id);
+        return buf;
+    }
+
     /*
      * width2index(): convert a bit width to an index string (i.e., "[msb:lsb]").
      */
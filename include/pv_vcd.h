@@ -192,6 +192,10 @@ namespace vcd {
         inline void emit_vcd_clock_ID()
             { check_state(); *vcd_stream << "$var wire 1 " << vcd_clock_ID << " clk $end\n"; }
 
+        // Emit the definition of a clock domain's clock (see Testbench::add_clock_domain()).
+        inline void emit_domain_clock_definition(const pv::ClockDomain* d)
+            { check_state(); *vcd_stream << "$var wire 1 " << d->vcd_id() << " " << d->name() << " $end\n"; }
+
         // End definitons.
         inline void emit_end_definitions()
             { check_state(); *vcd_stream << "$enddefinitions $end" << std::endl; }
@@ -222,6 +226,12 @@ namespace vcd {
         inline void emit_x_clock()
             { check_state(); if (is_emitting_change) *vcd_stream <<  "x" << vcd_clock_ID << std::endl; }
 
+        // Emit the value ('0', '1', or 'x') of a clock domain's clock. Domain clocks are drawn on the
+        // ticks of the Testbench clock (see set_operating_point()): a domain dividing the Testbench
+        // clock by D has a period of D * get_ticks_per_clock() ticks.
+        inline void emit_domain_clock(const pv::ClockDomain* d, const char v)
+            { check_state(); if (is_emitting_change) *vcd_stream << v << d->vcd_id() << std::endl; }
+
         // Signal emits.
         inline void emit_change(const std::string& id, const int width, const std::string& value)
             { check_state(); if (is_emitting_change) *vcd_stream << value 
@@ -231,15 +241,19 @@ namespace vcd {
         inline void set_emitting_change(const bool en) { is_emitting_change = en; }
         inline bool get_emitting_change() const { return is_emitting_change; }
 
-        // VCD definition.
-        void vcd_definition(const Module* m, const bool define_clock = false) {
+        // VCD definition. The clocks of any clock domains are defined with the (Testbench) clock.
+        void vcd_definition(const Module* m, const bool define_clock = false, 
+            const std::vector<const pv::ClockDomain*>& domains = std::vector<const pv::ClockDomain*>()) {
             // Make sure file is open.
             check_state();
 
-            // Enter new scope for module "m"; define clock if asked for.
+            // Enter new scope for module "m"; define clock(s) if asked for.
             this->emit_scope(m->name());
-            if (define_clock)
+            if (define_clock) {
                 this->emit_vcd_clock_ID();
+                for (size_t i = 0; i < domains.size(); i++)
+                    this->emit_domain_clock_definition(domains[i]);
+            }
 
             // Dump local wires.
             for (std::set<const WireBase*>::const_iterator it = m->w_begin(); it != m->w_end(); it++)
@@ -346,12 +360,14 @@ namespace vcd {
             }
         }
 
-        // Method to emit current time (Zulu); utility only.
-        char* get_zulu_time() {
+        // Method to emit current time (Zulu); utility only. Reentrant (no static buffers).
+        std::string get_zulu_time() {
             time_t t; 
+            struct tm tt;
+            char buf[64];
             time(&t);
-            struct tm* tt = gmtime(&t);
-            return asctime(tt);
+            gmtime_r(&t, &tt);
+            return asctime_r(&tt, buf);
         }
     };
 
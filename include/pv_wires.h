@@ -21,13 +21,13 @@
 /*
  * This header actually defines 6 classes/subclasses:
  *
- *                         ┌─────────────────────┐
- *                         │      WireBase       │
- *                         └──────────┬──────────┘
+ *                         ┌───────────────────────┐
+ *                         │       WireBase        │
+ *                         └──────────┬────────────┘
  *                                    │
- *                         ┌──────────▼──────────┐
- *                         │ WireTemplateBase<T> │
- *                         └──────────┬──────────┘
+ *                         ┌──────────▼────────────┐
+ *                         │ WireTemplateBase<T,W> │
+ *                         └──────────┬────────────┘
  *                                    │
  *        ┌──────────────────┬────────┴────────┬─────────────────┐
  * ┌──────▼──────┐    ┌──────▼──────┐   ┌──────▼──────┐   ┌──────▼──────┐
@@ -41,13 +41,14 @@
  * grouped in a single global database as well as allow iteration across all
  * wire instances.
  *
- * Below that is a templated base class, WireTemplateBase whose type is T. All
+ * Below that is a templated base class, WireTemplateBase whose type is T and
+ * whose (optional) width is W. All
  * generic operator overloads are implemented in this subclass. In addition,
  * means to get wire state/set wire state are included along with trigger
  * propogation to all connected modules. Lastly, VCD change detection support
  * is also included.
  *
- * Lastly, below the WireTemplateBase<T> subclass are four variant
+ * Lastly, below the WireTemplateBase<T,W> subclass are four variant
  * subsubclasses, Inputs, Wires, QWires, and Outputs. Inputs are intended to be
  * instances as input ports on a module, and the subsubclass auto-sensitizes
  * its parent container to input changes. The Wire subsubclass are intended to
@@ -58,7 +59,7 @@
  * intended to be instances as output ports of a module, and the subsubclass
  * auto-sensitizes its grandparent (if it exists) to value changes. All four
  * subsubclasses are "final", meaning they cannot be further subclassed. All
- * four classes also support setting a custom wire width (in bits) as well as
+ * four classes also support declaring a custom wire width (in bits) as well as
  * allowing for initialization when instanced (non-initialized begin in an 'x'
  * state).
  */
@@ -76,17 +77,17 @@
  *      - {virtual, abstract} get_width() - returns width of wire in bits.
  */
 
-class WireBase {
+class WireBase : public pv::StateHolder {
 protected:
     // Constructor/Destructor: protected so only subclass can use. Note that
     // every wire type must have a parent module. The test to set root instance
     // checks for null parent regardless in case the constructor is erroneously
     // invoked; the common_constructor() call will catch the error. 
     WireBase(const Module* p, const char* str) : parent_module(p), 
-        root_instance(p ? p->root_instance : NULL), wire_name(str)
+        root_instance(p ? p->root_instance : NULL), wire_name(pv::NameTable::intern(str))
             { constructor_common(); } 
     WireBase(const Module* p, const std::string& nm) : parent_module(p), 
-        root_instance(p ? p->root_instance : NULL), wire_name(nm)
+        root_instance(p ? p->root_instance : NULL), wire_name(pv::NameTable::intern(nm))
             { constructor_common(); } 
     virtual ~WireBase() 
         { const_cast<Module*>(parent_module)->remove_wire_instance(this); }
@@ -98,9 +99,9 @@ public:
 
     // General naming methods.
     const inline std::string name() const 
-        { return wire_name; }
+        { return *wire_name; }
     const std::string instanceName() const 
-        { return parent_module->instanceName() + "." + wire_name; }
+        { return parent_module->instanceName() + "." + *wire_name; }
 
     // Get parent module & top level (root/testbench) pointer. Both are non-NULL.
     inline const Module* parent() const { return parent_module; }
@@ -109,30 +110,56 @@ public:
     // Required getter for width of wire.
     virtual const int get_width() const = 0;
 
+    // Memory footprint of this wire in bytes.
+    virtual const size_t footprint() const = 0;
+
 protected:
     // Friend classes.
     friend class Testbench;
     friend class vcd::writer; 
 
-    // Parent modules and name.
+    // Parent modules and name (interned; see pv::NameTable).
     const Module* parent_module;
     const Module* root_instance;
-    const std::string wire_name;
-
-    // Save sensitized module (if any)
-    Module *sensitized_module;
-
-    // Optional tracing.
-    bool tracing;
-
-    // Wire class type and state; declared here so WireTemplateBase can use
+    const std::string* wire_name;
+
+    // Signal ID (unique per Testbench); used for VCD IDs and activity counters.
+    uint32_t signal_id;
+
+    // State flags, packed in a single byte: the 'x' states of the wire (see
+    // WireTemplateBase), optional tracing, whether the wire is in the
+    // Testbench's set of wires changed this clock, and the wire class type.
+    // (With PV_SOA_SIGNALS, the current and previous 'x' states are kept in
+    // the wire's pool slot instead.)
+#ifndef PV_SOA_SIGNALS
+    bool current_x : 1;
+    bool previous_x : 1;
+#endif
+    bool init_x : 1;
+    bool tracing : 1;
+    bool dirty : 1;
+    uint8_t type_code : 3;
+
+    // Wire class type; declared here so WireTemplateBase can use
     enum class WireType {
         unknown = 0,
         wire,
         qwire,
         input,
         output
-    } wire_type;
+    };
+    inline WireType wire_type() const { return (WireType) type_code; }
+
+    // Module sensitized to this wire (if any), derived from the wire class type: the
+    // parent of a Wire or an Input, the grandparent of an Output, none for a QWire.
+    inline Module* sensitized_module() const {
+        switch (wire_type()) {
+        case WireType::wire:
+        case WireType::input:   return const_cast<Module*>(parent_module);
+        case WireType::output:  return const_cast<Module*>(parent_module->parent());
+        default:                return NULL;
+        }
+    }
 
     // Disable direct assignment.
     template <typename T> WireBase& operator=(const T& wb) = delete;
@@ -141,7 +168,7 @@ protected:
     // Convert wire type to a string
     const std::string type2string() const {
         std::string str;
-        switch (wire_type) {
+        switch (wire_type()) {
         case WireType::unknown: str = "<UNK>"; break;
         case WireType::wire:    str = "Wire"; break;
         case WireType::qwire:   str = "QWire"; break;
@@ -155,7 +182,7 @@ protected:
     // Convert wire type to a character code.
     const char type2char() const {
         char ch;
-        switch (wire_type) {
+        switch (wire_type()) {
         case WireType::unknown: ch = 'U'; break;
         case WireType::wire:    ch = 'W'; break;
         case WireType::qwire:   ch = 'Q'; break;
@@ -174,21 +201,25 @@ protected:
     // Implemented in WireTemplateBase<T>.
     virtual void reset_to_instance_state() = 0;
 
+    // Virtual method returning the handler that resets a batch of wires of this type.
+    // Implemented in WireTemplateBase<T>.
+    virtual pv::WireResetBatchFn reset_batch_fn() const = 0;
+
     // Virtual method for mandatory negative clock edge update. 
     // Implemented in WireTemplateBase<T>.
     virtual void neg_edge_update() = 0;
 
-    // VCD related. The virtual methods below can't be implemented in the base
-    // class as the data type is not known in the base class. However, we do
-    // want methods using the Wire-type classes the ability to execute these
-    // methods in a type-independent manner, hence the virtual functions
-    // below.
-    std::string vcd_id_str; virtual void emit_vcd_definition
-    (std::ostream* vcd_stream) const = 0; virtual void emit_vcd_dumpvars
-    (std::ostream* vcd_stream) const = 0; virtual void emit_vcd_dumpon
-    (std::ostream* vcd_stream) const = 0; virtual void emit_vcd_dumpoff
-    (std::ostream* vcd_stream) const = 0; virtual void emit_vcd_neg_edge_update
-    (std::ostream* vcd_stream) = 0;
+    // VCD related. The VCD ID is derived from the signal ID. The virtual
+    // methods below can't be implemented in the base class as the data type is
+    // not known in the base class. However, we do want methods using the
+    // Wire-type classes the ability to execute these methods in a
+    // type-independent manner, hence the virtual functions below.
+    inline std::string vcd_id() const { return vcd::id2string(signal_id); }
+    virtual void emit_vcd_definition(std::ostream* vcd_stream) const = 0;
+    virtual void emit_vcd_dumpvars(std::ostream* vcd_stream) const = 0;
+    virtual void emit_vcd_dumpon(std::ostream* vcd_stream) const = 0;
+    virtual void emit_vcd_dumpoff(std::ostream* vcd_stream) const = 0;
+    virtual void emit_vcd_neg_edge_update(std::ostream* vcd_stream) = 0;
 
 private: 
     // Common constructor code.
@@ -197,20 +228,16 @@ private:
         if (parent_module == NULL)
             throw std::invalid_argument("Wire must be declared withing a Module");
 
-        // Associate to parent module. Default is no sensitization.
+        // Associate to parent module.
         const_cast<Module*>(parent_module)->add_wire_instance(this);
-        sensitized_module = NULL;
-
-        // Set unknown (in here) wire type.
-        wire_type = WireType::unknown;
 
-        // Initialize VCD ID.
-        std::stringstream ss;
-        ss << "@" << std::hex << const_cast<Module*>(root_instance)->vcd_id_count()++;
-        vcd_id_str = ss.str();
+        // Set unknown (in here) wire type; clear flags.
+        type_code = (uint8_t) WireType::unknown;
+        init_x = true;
+        tracing = dirty = false;
 
-        // Initialize trace stream off.
-        tracing = false;
+        // Initialize signal ID.
+        signal_id = const_cast<Module*>(root_instance)->vcd_id_count()++;
     }
 };
 
@@ -220,14 +247,16 @@ private:
  * are maintained by the WireBase superclass.
  *
  * Of note, wires can have a width (in bits). By default, when a wire is
- * created, its width is infered from the template type (T). This of course can
- * be overridden by a setter to set the actual width a user wants. The specific
- * wire subclasses (Wire, Input, Output) all have optional width parameters
- * that do this from the template declaration.
+ * created, its width is infered from the template type (T). The specific
+ * wire subclasses (Wire, QWire, Input, Output) all have an optional width
+ * template parameter (W) that overrides it. The width is a compile-time
+ * constant. For integral and enum types narrower than T, every value assigned
+ * to the wire (including its initializer) is truncated to W bits, as in
+ * Verilog (see pv::width_mask); for other types W only sets the VCD width.
  *
  * Public methods in this class:
- *  Width setter/getter:
- *      - set_width(): set the width of the wire
+ *  Width getter:
+ *      - width: compile-time constant width of the wire
  *      - get_width(): return the width of the wire
  *  Value getter/setter:
  *      - operator T(): return current value of the wire
@@ -249,30 +278,34 @@ private:
  *      - The usual suspects...
  */
 
-template <typename T>
+template <typename T, int W = -1>
 class WireTemplateBase : public WireBase {
 protected:
     // Constructor/Destructor.
-    WireTemplateBase(const Module* p, const char* str, const int W, const T* init, 
-        const WireBase::WireType type) : WireBase(p, str), v2s(def_printer)
-            { constructor_common(W, init, type); }
-    WireTemplateBase(const Module* p, const std::string& nm, const int W, const T* init, 
-        const WireBase::WireType type) : WireBase(p, nm), v2s(def_printer)
-            { constructor_common(W, init, type); }
+    WireTemplateBase(const Module* p, const char* str, const T* init, 
+        const WireBase::WireType type) : WireBase(p, str)
+            { constructor_common(init, type); }
+    WireTemplateBase(const Module* p, const std::string& nm, const T* init, 
+        const WireBase::WireType type) : WireBase(p, nm)
+            { constructor_common(init, type); }
+#ifdef PV_SOA_SIGNALS
+    virtual ~WireTemplateBase() { chunk->pool->release(chunk, slot); }
+#else
     virtual ~WireTemplateBase() {}
+#endif
 
 public:
     // Disable default and copy constructors.
     WireTemplateBase() = delete;
     WireTemplateBase(const WireTemplateBase& w) = delete;
-    template <typename U> WireTemplateBase(const WireTemplateBase<U>& wtb) = delete;
+    template <typename U, int UW> WireTemplateBase(const WireTemplateBase<U, UW>& wtb) = delete;
 
-    // Width setter/getter.
-    void set_width(const int wv) { width = wv; v2s.set_width(width); }
+    // Bit width (compile-time constant) and its getter.
+    static constexpr int width = (W > 0) ? W : vcd::bitwidth<T>();
     const int get_width() const { return width; }
 
     // Wire value getter/setter.
-    inline operator T() const { return value; }
+    inline operator T() const { return value(); }
     WireTemplateBase& operator=(const T& v) 
         { common_assignment(false, v, "operator=(const T& v)"); return *this; }
     template <typename U> WireTemplateBase& operator=(const U& v) 
@@ -280,116 +313,118 @@ public:
 
     // General wire->wire assignment (same or different source type).
     WireTemplateBase& operator=(const WireTemplateBase& wv)
-        { common_assignment(wv.is_x, wv.value, "operator=(const WireTemplateBase& wv)"); return *this; }
-    template <typename U> WireTemplateBase& operator=(const WireTemplateBase<U>& wv)
-        { common_assignment(wv.is_x, (T) wv.value, "operator=(const WireTemplateBase<U>& wv)"); return *this; }
+        { common_assignment(wv.is_x(), wv.value(), "operator=(const WireTemplateBase& wv)"); return *this; }
+    template <typename U, int UW> WireTemplateBase& operator=(const WireTemplateBase<U, UW>& wv)
+        { common_assignment(wv.is_x(), (T) wv.value(), "operator=(const WireTemplateBase<U>& wv)"); return *this; }
 
     // X state setters/getters.
-    inline bool value_is_x() const { return is_x; }
-    inline bool value_was_x() const { return was_x; }
-    inline void assign_x() { common_assignment(true, value, "operator=('X')"); }
+    inline bool value_is_x() const { return is_x(); }
+    inline bool value_was_x() const { return was_x(); }
+    inline void assign_x() { common_assignment(true, value(), "operator=('X')"); }
 
-    // VCD string printer setter (override default).
-    inline void set_vcd_string_printer(const vcd::value2string_t<T>& printer) { v2s = printer; }
+    // VCD string printer setter (override default). Printers of a type differ only
+    // in width, so the wire switches to the shared printer of the printer's width.
+    inline void set_vcd_string_printer(const vcd::value2string_t<T>& printer) 
+        { v2s = vcd::shared_printer<T>(printer.get_width()); }
 
     // Operator-assign overloads with 'T' type value.
     inline WireTemplateBase& operator+=(const T& v)
-		{ T new_v = value + v; common_assignment(is_x, new_v, 
+		{ T new_v = value() + v; common_assignment(is_x(), new_v, 
             "operator+=(const T& v)"); return *this; }
     inline WireTemplateBase& operator-=(const T& v)
-		{ T new_v = value - v; common_assignment(is_x, new_v, 
+		{ T new_v = value() - v; common_assignment(is_x(), new_v, 
             "operator-=(const T& v)"); return *this; }
     inline WireTemplateBase& operator*=(const T& v)
-		{ T new_v = value * v; common_assignment(is_x, new_v, 
+		{ T new_v = value() * v; common_assignment(is_x(), new_v, 
             "operator*=(const T& v)"); return *this; }
     inline WireTemplateBase& operator/=(const T& v)
-		{ T new_v = value / v; common_assignment(is_x, new_v, 
+		{ T new_v = value() / v; common_assignment(is_x(), new_v, 
             "operator/=(const T& v)"); return *this; }
     inline WireTemplateBase& operator%=(const T& v)
-		{ T new_v = value % v; common_assignment(is_x, new_v, 
+		{ T new_v = value() % v; common_assignment(is_x(), new_v, 
             "operator%=(const T& v)"); return *this; }
     inline WireTemplateBase& operator^=(const T& v)
-		{ T new_v = value ^ v; common_assignment(is_x, new_v, 
+		{ T new_v = value() ^ v; common_assignment(is_x(), new_v, 
             "operator^=(const T& v)"); return *this; }
     inline WireTemplateBase& operator&=(const T& v)
-		{ T new_v = value & v; common_assignment(is_x, new_v, 
+		{ T new_v = value() & v; common_assignment(is_x(), new_v, 
             "operator&=(const T& v)"); return *this; }
     inline WireTemplateBase& operator|=(const T& v)
-		{ T new_v = value | v; common_assignment(is_x, new_v, 
+		{ T new_v = value() | v; common_assignment(is_x(), new_v, 
             "operator|=(const T& v)"); return *this; }
 
     // Operator-assign overloads with "WireTemplateBase<T>" type value.
     inline WireTemplateBase& operator+=(const WireTemplateBase& wv)
-		{ T new_v = value + wv.value; common_assignment(is_x|wv.is_x, new_v, 
+		{ T new_v = value() + wv.value(); common_assignment(is_x()|wv.is_x(), new_v, 
             "operator+=(const WireTemplateBase& wv)"); return *this; }
     inline WireTemplateBase& operator-=(const WireTemplateBase& wv)
-		{ T new_v = value - wv.value; common_assignment(is_x|wv.is_x, new_v, 
+		{ T new_v = value() - wv.value(); common_assignment(is_x()|wv.is_x(), new_v, 
             "operator-=(const WireTemplateBase& wv)"); return *this; }
     inline WireTemplateBase& operator*=(const WireTemplateBase& wv)
-		{ T new_v = value * wv.value; common_assignment(is_x|wv.is_x, new_v, 
+		{ T new_v = value() * wv.value(); common_assignment(is_x()|wv.is_x(), new_v, 
             "operator*=(const WireTemplateBase& wv)"); return *this; }
     inline WireTemplateBase& operator/=(const WireTemplateBase& wv)
-		{ T new_v = value / wv.value; common_assignment(is_x|wv.is_x, new_v, 
+		{ T new_v = value() / wv.value(); common_assignment(is_x()|wv.is_x(), new_v, 
             "operator/=(const WireTemplateBase& wv)"); return *this; }
     inline WireTemplateBase& operator%=(const WireTemplateBase& wv)
-		{ T new_v = value % wv.value; common_assignment(is_x|wv.is_x, new_v, 
+		{ T new_v = value() % wv.value(); common_assignment(is_x()|wv.is_x(), new_v, 
             "operator%=(const WireTemplateBase& wv)"); return *this; }
     inline WireTemplateBase& operator^=(const WireTemplateBase& wv)
-		{ T new_v = value ^ wv.value; common_assignment(is_x|wv.is_x, new_v, 
+		{ T new_v = value() ^ wv.value(); common_assignment(is_x()|wv.is_x(), new_v, 
             "operator^=(const WireTemplateBase& wv)"); return *this; }
     inline WireTemplateBase& operator&=(const WireTemplateBase& wv)
-		{ T new_v = value & wv.value; common_assignment(is_x|wv.is_x, new_v, 
+		{ T new_v = value() & wv.value(); common_assignment(is_x()|wv.is_x(), new_v, 
             "operator&=(const WireTemplateBase& wv)"); return *this; }
     inline WireTemplateBase& operator|=(const WireTemplateBase& wv)
-		{ T new_v = value | wv.value; common_assignment(is_x|wv.is_x, new_v, 
+		{ T new_v = value() | wv.value(); common_assignment(is_x()|wv.is_x(), new_v, 
             "operator|=(const WireTemplateBase& wv)"); return *this; }
 
     // Operator-assign overloads with "WireTemplateBase<U>" type value.
-    template <typename U> inline WireTemplateBase& operator+=(const WireTemplateBase& wv)
-		{ T new_v = value + (T) wv.value; common_assignment(is_x|wv.is_x, new_v, 
+    template <typename U, int UW> inline WireTemplateBase& operator+=(const WireTemplateBase<U, UW>& wv)
+		{ T new_v = value() + (T) wv.value(); common_assignment(is_x()|wv.is_x(), new_v, 
             "operator+=(const WireTemplateBase<U>& wv)"); return *this; }
-    template <typename U> inline WireTemplateBase& operator-=(const WireTemplateBase& wv)
-		{ T new_v = value - (T) wv.value; common_assignment(is_x|wv.is_x, new_v, 
+    template <typename U, int UW> inline WireTemplateBase& operator-=(const WireTemplateBase<U, UW>& wv)
+		{ T new_v = value() - (T) wv.value(); common_assignment(is_x()|wv.is_x(), new_v, 
             "operator-=(const WireTemplateBase<U>& wv)"); return *this; }
-    template <typename U> inline WireTemplateBase& operator*=(const WireTemplateBase& wv)
-		{ T new_v = value * (T) wv.value; common_assignment(is_x|wv.is_x, new_v, 
+    template <typename U, int UW> inline WireTemplateBase& operator*=(const WireTemplateBase<U, UW>& wv)
+		{ T new_v = value() * (T) wv.value(); common_assignment(is_x()|wv.is_x(), new_v, 
             "operator*=(const WireTemplateBase<U>& wv)"); return *this; }
-    template <typename U> inline WireTemplateBase& operator/=(const WireTemplateBase& wv)
-		{ T new_v = value / (T) wv.value; common_assignment(is_x|wv.is_x, new_v, 
+    template <typename U, int UW> inline WireTemplateBase& operator/=(const WireTemplateBase<U, UW>& wv)
+		{ T new_v = value() / (T) wv.value(); common_assignment(is_x()|wv.is_x(), new_v, 
             "operator/=(const WireTemplateBase<U>& wv)"); return *this; }
-    template <typename U> inline WireTemplateBase& operator%=(const WireTemplateBase& wv)
-		{ T new_v = value % (T) wv.value; common_assignment(is_x|wv.is_x, new_v, 
+    template <typename U, int UW> inline WireTemplateBase& operator%=(const WireTemplateBase<U, UW>& wv)
+		{ T new_v = value() % (T) wv.value(); common_assignment(is_x()|wv.is_x(), new_v, 
             "operator%=(const WireTemplateBase<U>& wv)"); return *this; }
-    template <typename U> inline WireTemplateBase& operator^=(const WireTemplateBase& wv)
-		{ T new_v = value ^ (T) wv.value; common_assignment(is_x|wv.is_x, new_v, 
+    template <typename U, int UW> inline WireTemplateBase& operator^=(const WireTemplateBase<U, UW>& wv)
+		{ T new_v = value() ^ (T) wv.value(); common_assignment(is_x()|wv.is_x(), new_v, 
                 "operator^=(const WireTemplateBase<U>& wv)"); return *this; }
-    template <typename U> inline WireTemplateBase& operator&=(const WireTemplateBase& wv)
-		{ T new_v = value & (T) wv.value; common_assignment(is_x|wv.is_x, new_v, 
+    template <typename U, int UW> inline WireTemplateBase& operator&=(const WireTemplateBase<U, UW>& wv)
+		{ T new_v = value() & (T) wv.value(); common_assignment(is_x()|wv.is_x(), new_v, 
             "operator+=(const WireTemplateBase<U>& wv)"); return *this; }
-    template <typename U> inline WireTemplateBase& operator|=(const WireTemplateBase& wv)
-		{ T new_v = value | (T) wv.value; common_assignment(is_x|wv.is_x, new_v, 
+    template <typename U, int UW> inline WireTemplateBase& operator|=(const WireTemplateBase<U, UW>& wv)
+		{ T new_v = value() | (T) wv.value(); common_assignment(is_x()|wv.is_x(), new_v, 
             "operator+=(const WireTemplateBase<U>& wv)"); return *this; }
 
     // Shift-assign overloads.
     inline WireTemplateBase& operator>>=(const int& v)
-		{ T new_v = value >> v; common_assignment(is_x, new_v, "operator>>=(const int& v)"); return *this; }
+		{ T new_v = value() >> v; common_assignment(is_x(), new_v, "operator>>=(const int& v)"); return *this; }
     inline WireTemplateBase& operator<<=(const int& v)
-		{ T new_v = value << v; common_assignment(is_x, new_v, "operator<<=(const int& v)"); return *this; }
+		{ T new_v = value() << v; common_assignment(is_x(), new_v, "operator<<=(const int& v)"); return *this; }
 
     // Auto increment/decrement overloads.
     inline WireTemplateBase& operator++()   
-		{ T new_v = value + 1; common_assignment(is_x, new_v, "operator++()"); return *this; }
+		{ T new_v = value() + 1; common_assignment(is_x(), new_v, "operator++()"); return *this; }
     inline WireTemplateBase& operator--()   
-		{ T new_v = value - 1; common_assignment(is_x, new_v, "operator++()"); return *this; }
+		{ T new_v = value() - 1; common_assignment(is_x(), new_v, "operator++()"); return *this; }
     inline WireTemplateBase  operator++(int)
-		{ WireTemplateBase tmp = *this; T new_v = value + 1; 
-            common_assignment(is_x, new_v, "operator++(int)"); return tmp; }
+		{ WireTemplateBase tmp = *this; T new_v = value() + 1; 
+            common_assignment(is_x(), new_v, "operator++(int)"); return tmp; }
     inline WireTemplateBase  operator--(int)
-		{ WireTemplateBase tmp = *this; T new_v = value - 1; 
-            common_assignment(is_x, new_v, "operator++(int)"); return tmp; }
+		{ WireTemplateBase tmp = *this; T new_v = value() - 1; 
+            common_assignment(is_x(), new_v, "operator++(int)"); return tmp; }
 
     // Method to return std::string for value of this wire type.
-    const std::string value_string() const { return is_x ? v2s.undefined() : (v2s)(value); }
+    const std::string value_string() const { return is_x() ? v2s->undefined() : (*v2s)(value()); }
 
     // Set up a trace or tear it down.
     inline void enable_trace(const bool en) {
@@ -399,84 +434,188 @@ public:
     inline void trace() { enable_trace(true); }
     inline void untrace() { enable_trace(false); }
 
-protected:
-    // Width parameter.
-    int width;
-
-    // Record the "x" state of the wire. This takes precedence over the value of
-    // the wire. "is_x" is the current state of the wire, "was_x" is the state it had at
-    // the start of a clock, and "init_x" is the state it had when the wire was created.
-    bool is_x; bool was_x; bool init_x;
+    // Memory footprint of this wire in bytes (including its pool slot, if any).
+#ifdef PV_SOA_SIGNALS
+    const size_t footprint() const { return sizeof(*this) + pool_type::slot_bytes; }
+#else
+    const size_t footprint() const { return sizeof(*this); }
+#endif
 
-    // The current and old value of the wire. "old" means the value it had at the start of a clock.
-    T value;
-    T old_value;
-    T init_value;
+protected:
+    // The "x" state of the wire takes precedence over the value of the wire. "is_x" is the
+    // current state of the wire, "was_x" is the state it had at the start of a clock, and
+    // "init_x" (in WireBase) is the state it had when the wire was created. Likewise for the
+    // current, old, and initial value of the wire ("old" means the value it had at the start
+    // of a clock). The state is stored in the wire itself or, with PV_SOA_SIGNALS, in the
+    // wire's slot of the Testbench's pool for this wire type (see pv::SignalPool).
+#ifdef PV_SOA_SIGNALS
+    inline T& value() { return chunk->value[slot]; }
+    inline const T& value() const { return chunk->value[slot]; }
+    inline T& old_value() { return chunk->old_value[slot]; }
+    inline const T& old_value() const { return chunk->old_value[slot]; }
+    inline T& init_value() { return chunk->init_value[slot]; }
+    inline const T& init_value() const { return chunk->init_value[slot]; }
+    inline bool is_x() const { return chunk->x[slot]; }
+    inline bool was_x() const { return chunk->was_x[slot]; }
+    inline void set_is_x(const bool x) { chunk->x[slot] = x; }
+    inline void set_was_x(const bool x) { chunk->was_x[slot] = x; }
+#else
+    inline T& value() { return current_value; }
+    inline const T& value() const { return current_value; }
+    inline T& old_value() { return previous_value; }
+    inline const T& old_value() const { return previous_value; }
+    inline T& init_value() { return initial_value; }
+    inline const T& init_value() const { return initial_value; }
+    inline bool is_x() const { return current_x; }
+    inline bool was_x() const { return previous_x; }
+    inline void set_is_x(const bool x) { current_x = x; }
+    inline void set_was_x(const bool x) { previous_x = x; }
+#endif
+
+    // Storage of the state: current, old, and initial value, or the wire's pool slot.
+#ifdef PV_SOA_SIGNALS
+    typedef pv::SignalPool<T, W> pool_type;
+    uint16_t slot;
+    typename pool_type::Chunk* chunk;
+#else
+    T current_value;
+    T previous_value;
+    T initial_value;
+#endif
+
+    // VCD string printer: shared by all wires of the same type and width (see vcd::shared_printer).
+    const vcd::value2string_t<T>* v2s;
 
     // Method to wipe both past and present X states w/o triggering an eval.
-    inline void clear_x_states() { is_x = was_x = false; }
+    inline void clear_x_states() { set_is_x(false); set_was_x(false); }
 
 private:
     // Friend classes.
     friend class Testbench;
     friend class vcd::writer;
+    template <typename U, int UW> friend class WireTemplateBase;
 
     // Reset state of wire back to the state it had when it was instanced.
     // This is considered a change and does potentially cause tracing and a VCD update.
     inline void reset_to_instance_state()
-        { common_assignment(init_x, init_value, "<reset>"); }
-
-    // VCD string printer (default)
-    vcd::value2string_t<T> def_printer = { value }; 
-    vcd::value2string_t<T>& v2s;
+        { common_assignment(init_x, init_value(), "<reset>"); }
+
+    // Reset a batch of wires of this type to their initial state: the effect of calling
+    // reset_to_instance_state() on each, but with the changed wires and the modules to trigger
+    // collected into "result" for the Testbench to apply in bulk. Traced wires are reset
+    // individually. Activity is not recorded (the Testbench does not use batches when counting).
+    static void reset_batch(const WireBase* const* wires, const size_t n, pv::ResetBatchResult& result) {
+        result.neg_edge = &neg_edge_batch;
+        for (size_t i = 0; i < n; i++) {
+            if (i + 8 < n) __builtin_prefetch(wires[i + 8], 1);
+            WireTemplateBase* w = static_cast<WireTemplateBase*>(const_cast<WireBase*>(wires[i]));
+            if (w->tracing) {
+                w->WireTemplateBase::reset_to_instance_state();
+                continue;
+            }
+            const bool to_x = w->init_x;
+            const T& v = w->init_value();
+            if (to_x ? !w->is_x() : (w->is_x() || v != w->value())) {
+                Module* const sensitized = w->sensitized_module();
+                if (sensitized) result.triggered.push_back(sensitized);
+            }
+            if (to_x ? !w->was_x() : (w->was_x() || v != w->old_value())) {
+                if (!w->dirty) result.changed_wires.push_back(w);
+            } else
+                w->dirty = false;
+            w->set_is_x(to_x);
+            if (!to_x) w->value() = v;
+            result.wire_writes++;
+        }
+    }
+    pv::WireResetBatchFn reset_batch_fn() const { return &reset_batch; }
 
     // VCD dump methods.
     // Should NOT be called if vcd_stream is NULL (i.e., we are not dumping a VCD).
     void emit_vcd_definition(std::ostream* vcd_stream) const
-        { *vcd_stream << "$var wire " << this->width << " " << vcd_id_str 
-        << " " << wire_name << vcd::width2index(this->width) << " $end" << std::endl; }
+        { *vcd_stream << "$var wire " << this->width << " " << vcd_id() 
+        << " " << *wire_name << vcd::width2index(this->width) << " $end" << std::endl; }
     void emit_vcd_dumpvars(std::ostream* vcd_stream) const
-        { *vcd_stream << (is_x ? v2s.undefined() : (v2s)(value)) 
-        << (width > 1 ? " " : "") << vcd_id_str << std::endl; }
+        { *vcd_stream << (is_x() ? v2s->undefined() : (*v2s)(value())) 
+        << (width > 1 ? " " : "") << vcd_id() << std::endl; }
     void emit_vcd_dumpon(std::ostream* vcd_stream) const
-        { *vcd_stream << (is_x ? v2s.undefined() : (v2s)(value)) 
-        << (width > 1 ? " " : "") << vcd_id_str << std::endl; }
+        { *vcd_stream << (is_x() ? v2s->undefined() : (*v2s)(value())) 
+        << (width > 1 ? " " : "") << vcd_id() << std::endl; }
     void emit_vcd_dumpoff(std::ostream* vcd_stream) const
-        { *vcd_stream << v2s.undefined() << (width > 1 ? " " : "") 
-        << vcd_id_str << std::endl; }
+        { *vcd_stream << v2s->undefined() << (width > 1 ? " " : "") 
+        << vcd_id() << std::endl; }
 
     // VCD updates on negative edge of clock: if value has changed print the change.
     // Should NOT be called if vcd_stream is NULL (i.e., we are not dumping a VCD).
     void emit_vcd_neg_edge_update(std::ostream* vcd_stream) {
-        if (is_x ? !was_x : (was_x || value != old_value))
-            *vcd_stream << (is_x ? v2s.undefined() : (v2s)(value)) 
-                << (width > 1 ? " " : "") << vcd_id_str << std::endl;
+        if (is_x() ? !was_x() : (was_x() || value() != old_value()))
+            *vcd_stream << (is_x() ? v2s->undefined() : (*v2s)(value())) 
+                << (width > 1 ? " " : "") << vcd_id() << std::endl;
+    }
+
+    // Save/restore the state of the wire: current and old value and 'x' states. A restored
+    // wire whose state differs from its old state is again a changed wire of the clock.
+    void save_state(pv::StateWriter& w) const {
+        w.put(value());
+        w.put(old_value());
+        w.put((uint8_t) (is_x() | (was_x() << 1)));
+    }
+    void restore_state(pv::StateReader& r) {
+        uint8_t x;
+        r.get(value());
+        r.get(old_value());
+        r.get(x);
+        set_is_x(x & 1);
+        set_was_x((x >> 1) & 1);
+        dirty = false;
+        if (is_x() ? !was_x() : (was_x() || value() != old_value()))
+            const_cast<Module*>(root_instance)->add_changed_wire(this, &neg_edge_batch);
     }
 
     // Mandatory negedge update call.
     inline void neg_edge_update() {
-        was_x = is_x;
-        old_value = value;
+        set_was_x(is_x());
+        old_value() = value();
+        dirty = false;
+    }
+
+    // Negative edge update of a batch of changed wires of this type: one call per wire type
+    // rather than a virtual call per wire. Entries whose dirty flag is clear (wires changed back
+    // to their old state, or repeated entries) are skipped.
+    static void neg_edge_batch(const WireBase* const* wires, const size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            if (i + 8 < n) __builtin_prefetch(wires[i + 8], 1);
+            WireTemplateBase* w = static_cast<WireTemplateBase*>(const_cast<WireBase*>(wires[i]));
+            if (w->dirty) w->WireTemplateBase::neg_edge_update();
+        }
     }
 
     // Common assignment code for all cases (whether transition to X or regular value).
-    void common_assignment(const bool to_x, const T& v, const char* info) {
+    void common_assignment(const bool to_x, const T& wv, const char* info) {
         bool change = false;
+        Module* const sensitized = sensitized_module();
+
+        // Truncate the new value to the declared width (an identity for most types).
+        const T& v = pv::width_mask<T, W>::apply(wv);
 
         // If assigning a X, value "v" is ignored.
         if (to_x) {
             // If wire was an X, then wire is unchanged. Otherwise, mark it as changed.
-            if (was_x)
+            if (was_x())
                 const_cast<Module*>(root_instance)->remove_changed_wire(this);
             else {
-                const_cast<Module*>(root_instance)->add_changed_wire(this);
+                const_cast<Module*>(root_instance)->add_changed_wire(this, &neg_edge_batch);
                 change = true;
             }
 
             // If the wire is not X, treat this as a potential change and force
             // eval on any sensitized module.
-            if (!is_x && sensitized_module != NULL) const_cast<Module*>
-            (root_instance)->trigger_module(sensitized_module);
+            if (!is_x() && sensitized != NULL) {
+                const_cast<Module*>(root_instance)->trigger_module(sensitized);
+                const_cast<Module*>(root_instance)->record_wire_trigger(this);
+            }
+            if (root_instance->counting_activity)
+                const_cast<Module*>(root_instance)->record_activity(signal_id, !is_x());
 
             // If tracing...
             if (tracing) {
@@ -484,9 +623,9 @@ private:
                     const_cast<Module*>(root_instance)->get_trace_change(instanceName());
                 if (vcr.type == 'U') {
                     vcr.type = type2char();
-                    vcr.start_value = was_x ? v2s.undefined() : (v2s)(old_value);
+                    vcr.start_value = was_x() ? v2s->undefined() : (*v2s)(old_value());
                 }
-                vcr.end_value = v2s.undefined();
+                vcr.end_value = v2s->undefined();
                 if (change) {
                     vcr.is_changed = true;
                     vcr.NTR++;
@@ -498,7 +637,7 @@ private:
             }
 
             // Wire is now X.
-            is_x = true;
+            set_is_x(true);
         }
 
         // Change logic if not to 'x' state:
@@ -516,13 +655,18 @@ private:
         //  1       1       -               -           |   Y           Y
         // 
         else {
-            if (was_x || v != old_value) {
-                const_cast<Module*>(root_instance)->add_changed_wire(this);
+            if (was_x() || v != old_value()) {
+                const_cast<Module*>(root_instance)->add_changed_wire(this, &neg_edge_batch);
                 change = true;
             } else
                 const_cast<Module*>(root_instance)->remove_changed_wire(this);
-            if ((is_x || v != value) && sensitized_module != NULL)
-                const_cast<Module*>(root_instance)->trigger_module(sensitized_module);
+            const bool transition = is_x() || v != value();
+            if (transition && sensitized != NULL) {
+                const_cast<Module*>(root_instance)->trigger_module(sensitized);
+                const_cast<Module*>(root_instance)->record_wire_trigger(this);
+            }
+            if (root_instance->counting_activity)
+                const_cast<Module*>(root_instance)->record_activity(signal_id, transition);
 
             // If tracing...
             if (tracing) {
@@ -530,9 +674,9 @@ private:
                     const_cast<Module*>(root_instance)->get_trace_change(instanceName());
                 if (vcr.type == 'U') {
                     vcr.type = type2char();
-                    vcr.start_value = was_x ? v2s.undefined() : (v2s)(old_value);
+                    vcr.start_value = was_x() ? v2s->undefined() : (*v2s)(old_value());
                 }
-                vcr.end_value = (v2s)(v);
+                vcr.end_value = (*v2s)(v);
                 if (change) {
                     vcr.is_changed = true;
                     vcr.NTR++;
@@ -544,26 +688,37 @@ private:
             }
 
             // Clear any X state and save new value.
-            is_x = false;
-            value = v;
+            set_is_x(false);
+            value() = v;
         }
     }
 
     // Common constructor code.
     // Set default VCD string printer and initialize wire to X state.
-    // If initializer is provided, use it; otherwise, set state to 'X'.
-    void constructor_common(const int W, const T* init, const WireBase::WireType type) {
-        width = (W > 0) ? W : vcd::bitwidth<T>();
-        v2s.set_width(width);
-        this->wire_type = type;
-        if (init) {
-            init_x = was_x = is_x = false;
-            init_value = old_value = value = *init;
-        } else
-            init_x = was_x = is_x = true;
+    // If initializer is provided, use it (truncated to the wire width); otherwise, set state to 'X'.
+    void constructor_common(const T* init, const WireBase::WireType type) {
+        static const vcd::value2string_t<T>* const def_printer = vcd::shared_printer<T>(width);
+        v2s = def_printer;
+        this->type_code = (uint8_t) type;
+#ifdef PV_SOA_SIGNALS
+        // Allocate a slot in the Testbench's pool for this wire type.
+        pv::SignalPoolBase* pool = const_cast<Module*>(root_instance)->signal_pool(typeid(pool_type), 
+            &pool_type::create);
+        if (pool == NULL)
+            throw std::invalid_argument("Wire must be instanced under a Testbench (PV_SOA_SIGNALS)");
+        static_cast<pool_type*>(pool)->allocate(this, chunk, slot);
+#endif
+        init_x = init == NULL;
+        set_is_x(init_x);
+        set_was_x(init_x);
+        init_value() = old_value() = value() = init ? pv::width_mask<T, W>::apply(*init) : T();
     }
 };
 
+// Definition of the bit width constant (required if odr-used).
+template <typename T, int W>
+constexpr int WireTemplateBase<T, W>::width;
+
 /*
  * Wire: a specialization of the WireTemplateBase class. Wires are intended for
  * use inside a Module, and will auto-sensitize the parent module to changes in
@@ -571,39 +726,37 @@ private:
  */
 
 template <typename T, int W = -1>
-class Wire final : public WireTemplateBase<T> {
+class Wire final : public WireTemplateBase<T, W> {
 public:
     // Constructors/Destructor.
     Wire(const Module* p, const char* str) : 
-        WireTemplateBase<T>(p, str, W, NULL, WireBase::WireType::wire) 
+        WireTemplateBase<T, W>(p, str, NULL, WireBase::WireType::wire) 
             { constructor_common(p); }
     Wire(const Module* p, const char* str, const T& init) : 
-        WireTemplateBase<T>(p, str, W, &init, WireBase::WireType::wire) 
+        WireTemplateBase<T, W>(p, str, &init, WireBase::WireType::wire) 
             { constructor_common(p); }
     Wire(const Module* p, const std::string& nm) : 
-        WireTemplateBase<T>(p, nm, W, NULL, WireBase::WireType::wire) 
+        WireTemplateBase<T, W>(p, nm, NULL, WireBase::WireType::wire) 
             { constructor_common(p); }
     Wire(const Module* p, const std::string& nm, const T& init) : 
-        WireTemplateBase<T>(p, nm, W, &init, WireBase::WireType::wire) 
+        WireTemplateBase<T, W>(p, nm, &init, WireBase::WireType::wire) 
             { constructor_common(p); }
     virtual ~Wire() {}
 
     // Call superclass for assignment operator.
     inline Wire& operator=(const T& value) 
-        { return (Wire&) WireTemplateBase<T>::operator=(value); }
+        { return (Wire&) WireTemplateBase<T, W>::operator=(value); }
     template <typename U> inline Wire& operator=(const U& value) 
-        { return (Wire&) WireTemplateBase<T>::operator=((T) value); }
-    inline Wire& operator=(const WireTemplateBase<T>& wv) 
-        { return (Wire&) WireTemplateBase<T>::operator=(wv); }
-    template <typename U> inline Wire& operator=(const WireTemplateBase<U>& wv) 
-        { return (Wire&) WireTemplateBase<T>::operator=(wv); }
+        { return (Wire&) WireTemplateBase<T, W>::operator=((T) value); }
+    inline Wire& operator=(const WireTemplateBase<T, W>& wv) 
+        { return (Wire&) WireTemplateBase<T, W>::operator=(wv); }
+    template <typename U, int UW> inline Wire& operator=(const WireTemplateBase<U, UW>& wv) 
+        { return (Wire&) WireTemplateBase<T, W>::operator=(wv); }
 
 private:
     // Common constructor for all four variants.
-    void constructor_common(const Module* p) {
-        if (p) this->sensitized_module = const_cast<Module*>(p);
-        else throw std::invalid_argument("Wire must be declared inside a module");
-    }
+    void constructor_common(const Module* p)
+        { if (!p) throw std::invalid_argument("Wire must be declared inside a module"); }
 };
 
 /*
@@ -613,32 +766,32 @@ private:
  */
 
 template <typename T, int W = -1>
-class QWire final : public WireTemplateBase<T> {
+class QWire final : public WireTemplateBase<T, W> {
 public:
     // Constructors/Destructor.
     QWire(const Module* p, const char* str) : 
-        WireTemplateBase<T>(p, str, W, NULL, WireBase::WireType::qwire) 
+        WireTemplateBase<T, W>(p, str, NULL, WireBase::WireType::qwire) 
             { constructor_common(p); }
     QWire(const Module* p, const char* str, const T& init) : 
-        WireTemplateBase<T>(p, str, W, &init, WireBase::WireType::qwire) 
+        WireTemplateBase<T, W>(p, str, &init, WireBase::WireType::qwire) 
             { constructor_common(p); }
     QWire(const Module* p, const std::string& nm) : 
-        WireTemplateBase<T>(p, nm, W, NULL, WireBase::WireType::qwire) 
+        WireTemplateBase<T, W>(p, nm, NULL, WireBase::WireType::qwire) 
             { constructor_common(p); }
     QWire(const Module* p, const std::string& nm, const T& init) : 
-        WireTemplateBase<T>(p, nm, W, &init, WireBase::WireType::qwire) 
+        WireTemplateBase<T, W>(p, nm, &init, WireBase::WireType::qwire) 
             { constructor_common(p); }
     virtual ~QWire() {}
 
     // Call superclass for assignment operator.
     inline QWire& operator=(const T& value) 
-        { return (QWire&) WireTemplateBase<T>::operator=(value); }
+        { return (QWire&) WireTemplateBase<T, W>::operator=(value); }
     template <typename U> inline QWire& operator=(const U& value) 
-            { return (QWire&) WireTemplateBase<T>::operator=((T) value); }
-    inline QWire& operator=(const WireTemplateBase<T>& wv) 
-        { return (QWire&) WireTemplateBase<T>::operator=(wv); }
-    template <typename U> inline QWire& operator=(const WireTemplateBase<U>& wv) 
-        { return (QWire&) WireTemplateBase<T>::operator=(wv); }
+            { return (QWire&) WireTemplateBase<T, W>::operator=((T) value); }
+    inline QWire& operator=(const WireTemplateBase<T, W>& wv) 
+        { return (QWire&) WireTemplateBase<T, W>::operator=(wv); }
+    template <typename U, int UW> inline QWire& operator=(const WireTemplateBase<U, UW>& wv) 
+        { return (QWire&) WireTemplateBase<T, W>::operator=(wv); }
 
 private:
     // Common constructor for all four variants.
@@ -653,39 +806,37 @@ private:
  */
 
 template <typename T, int W = -1>
-class Input final : public WireTemplateBase<T> {
+class Input final : public WireTemplateBase<T, W> {
 public:
     // Constructors/Destructor.
     Input(const Module* p, const char* str) : 
-        WireTemplateBase<T>(p, str, W, NULL, WireBase::WireType::input) 
+        WireTemplateBase<T, W>(p, str, NULL, WireBase::WireType::input) 
             { constructor_common(p); }
     Input(const Module* p, const char* str, const T& init) : 
-        WireTemplateBase<T>(p, str, W, &init, WireBase::WireType::input) 
+        WireTemplateBase<T, W>(p, str, &init, WireBase::WireType::input) 
             { constructor_common(p); }
     Input(const Module* p, const std::string& nm) : 
-        WireTemplateBase<T>(p, nm, W, NULL, WireBase::WireType::input) 
+        WireTemplateBase<T, W>(p, nm, NULL, WireBase::WireType::input) 
             { constructor_common(p); }
     Input(const Module* p, const std::string& nm, const T& init) : 
-        WireTemplateBase<T>(p, nm, W, &init, WireBase::WireType::input) 
+        WireTemplateBase<T, W>(p, nm, &init, WireBase::WireType::input) 
             { constructor_common(p); }
     virtual ~Input() {}
 
     // Call superclass for assignment operator.
     inline Input& operator=(const T& value) 
-        { return (Input&) WireTemplateBase<T>::operator=(value); }
+        { return (Input&) WireTemplateBase<T, W>::operator=(value); }
     template <typename U> inline Input& operator=(const U& value) 
-        { return (Input&) WireTemplateBase<T>::operator=((T) value); }
-    inline Input& operator=(const WireTemplateBase<T>& wv) 
-        { return (Input&) WireTemplateBase<T>::operator=(wv); }
-    template <typename U> inline Input& operator=(const WireTemplateBase<U>& wv) 
-        { return (Input&) WireTemplateBase<T>::operator=(wv); }
+        { return (Input&) WireTemplateBase<T, W>::operator=((T) value); }
+    inline Input& operator=(const WireTemplateBase<T, W>& wv) 
+        { return (Input&) WireTemplateBase<T, W>::operator=(wv); }
+    template <typename U, int UW> inline Input& operator=(const WireTemplateBase<U, UW>& wv) 
+        { return (Input&) WireTemplateBase<T, W>::operator=(wv); }
 
 private:
     // Common constructor for all four variants.
-    void constructor_common(const Module* p) {
-        if (p) this->sensitized_module = const_cast<Module*>(p);
-        else throw std::invalid_argument("Input must be declared inside a module");
-    }
+    void constructor_common(const Module* p)
+        { if (!p) throw std::invalid_argument("Input must be declared inside a module"); }
 };
 
 /*
@@ -696,40 +847,38 @@ private:
  */
 
 template <typename T, int W = -1>
-class Output final : public WireTemplateBase<T> {
+class Output final : public WireTemplateBase<T, W> {
 public:
     // Constructors/Destructor.
     Output(const Module* p, const char* str) : 
-        WireTemplateBase<T>(p, str, W, NULL, WireBase::WireType::output) 
+        WireTemplateBase<T, W>(p, str, NULL, WireBase::WireType::output) 
             { constructor_common(p); }
     Output(const Module* p, const char* str, const T& init) : 
-        WireTemplateBase<T>(p, str, W, &init, WireBase::WireType::output) 
+        WireTemplateBase<T, W>(p, str, &init, WireBase::WireType::output) 
             { constructor_common(p); }
     Output(const Module* p, const std::string& nm) : 
-        WireTemplateBase<T>(p, nm, W, NULL, WireBase::WireType::output) 
+        WireTemplateBase<T, W>(p, nm, NULL, WireBase::WireType::output) 
             { constructor_common(p); }
     Output(const Module* p, const std::string& nm, const T& init) : 
-        WireTemplateBase<T>(p, nm, W, &init, WireBase::WireType::output) 
+        WireTemplateBase<T, W>(p, nm, &init, WireBase::WireType::output) 
             { constructor_common(p); }
     virtual ~Output() {}
 
     // Call superclass for assignment operator.
     inline Output& operator=(const T& value) 
-        { return (Output&) WireTemplateBase<T>::operator=(value); }
+        { return (Output&) WireTemplateBase<T, W>::operator=(value); }
     template <typename U> inline Output& operator=(const U& value) 
-        { return (Output&) WireTemplateBase<T>::operator=((T) value); }
-    inline Output& operator=(const WireTemplateBase<T>& wv) 
-        { return (Output&) WireTemplateBase<T>::operator=(wv); }
-    template <typename U> inline Output& operator=(const WireTemplateBase<U>& wv) 
-        { return (Output&) WireTemplateBase<T>::operator=(wv); }
+        { return (Output&) WireTemplateBase<T, W>::operator=((T) value); }
+    inline Output& operator=(const WireTemplateBase<T, W>& wv) 
+        { return (Output&) WireTemplateBase<T, W>::operator=(wv); }
+    template <typename U, int UW> inline Output& operator=(const WireTemplateBase<U, UW>& wv) 
+        { return (Output&) WireTemplateBase<T, W>::operator=(wv); }
 
 private:
     // Common constructor for all four variants.
     void constructor_common(const Module* p) {
-        if (p) {
-            if (p->parent()) this->sensitized_module = const_cast<Module*>(p->parent());
-            else throw std::invalid_argument("Output cannot be declared on a top-level module");
-        } else throw std::invalid_argument("Output must be declared inside a module");
+        if (!p) throw std::invalid_argument("Output must be declared inside a module");
+        if (!p->parent()) throw std::invalid_argument("Output cannot be declared on a top-level module");
     }
 };
 
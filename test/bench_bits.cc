@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2023 Michael C Shebanow
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "pv.h"
+
+/*
+ * pv::Bits<N> micro-benchmark.
+ *
+ * Times the word-parallel operators over an array of operands and reports
+ * ns/op at several widths. The Makefile builds it plain, with -mavx2, and with
+ * -mavx512f ("make bench"), so the three kernel paths can be compared:
+ *
+ *      ./bench_bits [iterations]
+ */
+
+static volatile uint64_t sink;
+
+template <int N, typename F>
+static void time_op(const char* name, const std::vector<pv::Bits<N> >& v, const int iterations, F op) {
+    const size_t n = v.size();
+    pv::Bits<N> acc;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int it = 0; it < iterations; it++)
+        for (size_t i = 0; i + 1 < n; i++)
+            acc = op(acc, v[i], v[i + 1]);
+    const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    sink = acc.word(0);
+    std::printf("  %-6s %8.2f ns/op\n", name, s * 1e9 / ((double) iterations * (n - 1)));
+}
+
+template <int N>
+static void bench_width(const int iterations) {
+    typedef pv::Bits<N> B;
+    std::vector<B> v(1024);
+    for (size_t i = 0; i < v.size(); i++)
+        for (int j = 0; j < B::num_words; j++) v[i].set_word(j, ((uint64_t) std::rand() << 32) ^ (uint64_t) std::rand());
+    v[v.size() / 2] = v[v.size() / 2 + 1];
+    std::printf("Bits<%d>:\n", N);
+    time_op<N>("&", v, iterations, [](const B& acc, const B& a, const B& b) { return acc ^ (a & b); });
+    time_op<N>("|", v, iterations, [](const B& acc, const B& a, const B& b) { return acc ^ (a | b); });
+    time_op<N>("~", v, iterations, [](const B& acc, const B& a, const B&) { return acc ^ ~a; });
+    time_op<N>("==", v, iterations, [](const B& acc, const B& a, const B& b) { return (a == b) ? acc + 1 : acc; });
+    time_op<N>("+", v, iterations, [](const B& acc, const B& a, const B& b) { return acc ^ (a + b); });
+    time_op<N>("-", v, iterations, [](const B& acc, const B& a, const B& b) { return acc ^ (a - b); });
+    time_op<N>("<<", v, iterations, [](const B& acc, const B& a, const B& b) { return acc ^ (a << (int) (b.word(0) % N)); });
+    time_op<N>(">>", v, iterations, [](const B& acc, const B& a, const B& b) { return acc ^ (a >> (int) (b.word(0) % N)); });
+    time_op<N>("*", v, iterations / 16 + 1, [](const B& acc, const B& a, const B& b) { return acc ^ (a * b); });
+}
+
+int main(int argc, char** argv) {
+    const int iterations = argc > 1 ? std::atoi(argv[1]) : 1000;
+#if defined(__AVX512F__)
+    std::printf("kernels: avx512\n");
+#elif defined(__AVX2__)
+    std::printf("kernels: avx2\n");
+#else
+    std::printf("kernels: scalar\n");
+#endif
+    bench_width<128>(iterations);
+    bench_width<512>(iterations);
+    bench_width<2048>(iterations / 4 + 1);
+    return 0;
+}
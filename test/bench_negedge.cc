@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2023 Michael C Shebanow
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+#include "pv.h"
+
+/*
+ * Negative edge update benchmark.
+ *
+ * A testbench with a large number of wires (1M by default), every one of them
+ * written with a new value each clock, so the negative edge update of the
+ * changed wires dominates the run time. The wires are split across three types
+ * (uint32_t, uint8_t, and bool) so several per-type batches are in play, and
+ * every eighth wire is written twice per clock, the second write restoring its
+ * old value. The Makefile builds it with the default wire storage and with
+ * -DPV_SOA_SIGNALS ("make bench"):
+ *
+ *      ./bench_negedge [wires] [clocks]
+ */
+
+class NegEdgeBench : public Testbench {
+public:
+    NegEdgeBench(const int n) : Testbench("bench") {
+        for (int i = 0; i < n; i++) {
+            const std::string name = "w" + std::to_string(i);
+            if (i % 4 == 0) w8.emplace_back(new QWire<uint8_t>(this, name, 0));
+            else if (i % 4 == 1) w1.emplace_back(new QWire<bool>(this, name, false));
+            else w32.emplace_back(new QWire<uint32_t>(this, name, 0));
+        }
+    }
+
+    void main(int, char**) {}
+    void eval() {}
+
+    void pre_clock(const uint32_t clock_num) {
+        for (size_t i = 0; i < w32.size(); i++) {
+            *w32[i] = clock_num + (uint32_t) i;
+            if (i % 8 == 0) { *w32[i] = clock_num + (uint32_t) i + 1; *w32[i] = clock_num + (uint32_t) i; }
+        }
+        for (size_t i = 0; i < w8.size(); i++) *w8[i] = (uint8_t) (clock_num + i);
+        for (size_t i = 0; i < w1.size(); i++) *w1[i] = (clock_num & 1) != 0;
+    }
+
+    std::vector<std::unique_ptr<QWire<uint32_t> > > w32;
+    std::vector<std::unique_ptr<QWire<uint8_t> > > w8;
+    std::vector<std::unique_ptr<QWire<bool> > > w1;
+};
+
+int main(int argc, char** argv) {
+    const int wires = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    const int clocks = argc > 2 ? std::atoi(argv[2]) : 20;
+#ifdef PV_SOA_SIGNALS
+    const char* storage = "soa";
+#else
+    const char* storage = "aos";
+#endif
+    NegEdgeBench tb(wires);
+    tb.set_cycle_limit(clocks);
+    const auto t0 = std::chrono::steady_clock::now();
+    tb.simulation();
+    const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::printf("bench_negedge (%s): %d wires, %d clocks: %.2f ms/clock\n", storage, wires, clocks, s * 1e3 / clocks);
+    return 0;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2023 Michael C Shebanow
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <iostream>
+#include <sstream>
+
+#ifndef _CHECK_H_
+#define _CHECK_H_
+
+/*
+ * Minimal check harness for the check_*.cc behavior tests.
+ *
+ * CHECK(cond) reports the file and line of a failing condition on std::cout and
+ * keeps going; check_summary() prints the tally and returns the process exit
+ * code, so each test's main() ends with "return check_summary("name");" (the
+ * tally of a PV_SOA_SIGNALS build is marked "(soa)"). A CaptureCerr object
+ * collects what is written to std::cerr during its lifetime (e.g., the messages
+ * of an expected load failure) instead of printing it.
+ */
+
+static int check_count = 0;
+static int check_failures = 0;
+
+#define CHECK(cond) do { \
+        check_count++; \
+        if (!(cond)) { \
+            check_failures++; \
+            std::cout << __FILE__ << ":" << __LINE__ << ": CHECK(" #cond ") failed" << std::endl; \
+        } \
+    } while (0)
+
+static inline int check_summary(const char* name) {
+#ifdef PV_SOA_SIGNALS
+    const char* build = " (soa)";
+#else
+    const char* build = "";
+#endif
+    std::cout << name << build << ": " << (check_count - check_failures) << "/" << check_count
+              << " checks passed" << std::endl;
+    return check_failures ? 1 : 0;
+}
+
+// Redirect std::cerr into a string for the lifetime of the object.
+class CaptureCerr {
+public:
+    CaptureCerr() : saved(std::cerr.rdbuf(captured.rdbuf())) {}
+    ~CaptureCerr() { std::cerr.rdbuf(saved); }
+    inline std::string str() const { return captured.str(); }
+
+private:
+    std::ostringstream captured;
+    std::streambuf* saved;
+};
+
+#endif
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2023 Michael C Shebanow
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <csignal>
+#include <memory>
+#include <sys/wait.h>
+#include "pv.h"
+#include "check.h"
+
+/*
+ * Simulation branches and batches: each forked branch continues from the
+ * common state exactly as a separate run would, and its result records how it
+ * ended; testbenches run by a BatchRunner on several threads produce the same
+ * results as when run one after the other.
+ */
+
+// A testbench accumulating a pseudo-random stimulus; the seed can be changed between runs.
+struct BranchTB : public Testbench {
+    BranchTB() : Testbench("tb"), seed(1) {}
+    Register<uint32_t> instance(r, 0);
+    Register<uint32_t> instance(acc, 0);
+    uint32_t seed;
+
+    void main(int, char**) {}
+    void eval() {}
+    void post_clock(const uint32_t) {
+        seed = seed * 1103515245u + 12345u;
+        r <= r + 1;
+        acc <= acc + (seed >> 16);
+    }
+};
+
+static const uint32_t boot_clocks = 100;
+static const uint32_t branch_clocks = 50;
+
+// What branch b reports: the state after running it.
+static std::string branch_report(BranchTB& tb, const uint32_t b) {
+    tb.seed = 1000 + b;
+    tb.set_cycle_limit(tb.get_clock() + branch_clocks);
+    tb.simulation(true);
+    std::ostringstream os;
+    os << "acc=" << (uint32_t) tb.acc << " r=" << (uint32_t) tb.r << " clock=" << tb.get_clock() << "\n";
+    return os.str();
+}
+
+static void check_fork_branches() {
+    BranchTB tb;
+    tb.set_cycle_limit(boot_clocks);
+    tb.simulation();
+    const uint32_t acc = tb.acc;
+
+    // Branch 2 returns an exit code, 3 throws, 4 is killed, and 5 writes more than a pipe holds.
+    std::vector<pv::BranchResult> res;
+    {
+        CaptureCerr err;
+        res = tb.fork_branches(6, [&tb](const uint32_t b, std::ostream& os) {
+            const std::string report = branch_report(tb, b);
+            if (b == 3) throw std::runtime_error("boom");
+            if (b == 4) raise(SIGKILL);
+            for (int i = 0; i < (b == 5 ? 10000 : 1); i++) os << report;
+            return b == 2 ? -7 : 0;
+        }, 2);
+    }
+    CHECK(res.size() == 6);
+    if (res.size() != 6) return;
+
+    // Completed branches report what a separate run from the same state reports.
+    bool same = true;
+    for (uint32_t b = 0; b < 6; b++) {
+        CHECK(res[b].branch == b && res[b].pid > 0);
+        BranchTB ref;
+        ref.set_cycle_limit(boot_clocks);
+        ref.simulation();
+        const std::string report = branch_report(ref, b);
+        if (b == 5) {
+            CHECK(res[b].output.size() == 10000 * report.size());
+            same = same && res[b].output.compare(0, report.size(), report) == 0;
+        } else if (res[b].completed)
+            same = same && res[b].output == report;
+    }
+    CHECK(same);
+    CHECK(res[0].completed && res[0].exit_code == 0 && res[0].status == 0);
+    CHECK(res[2].completed && res[2].exit_code == -7);
+    CHECK(!res[3].completed && WIFEXITED(res[3].status) && WEXITSTATUS(res[3].status) == 1);
+    CHECK(res[3].output.empty());
+    CHECK(!res[4].completed && WIFSIGNALED(res[4].status) && WTERMSIG(res[4].status) == SIGKILL);
+    CHECK(res[5].completed && res[5].exit_code == 0);
+
+    // The parent is where it was.
+    CHECK(tb.get_clock() == boot_clocks);
+    CHECK((uint32_t) tb.acc == acc);
+    CHECK(branch_report(tb, 0) == res[0].output);
+}
+
+class Sub : public Module {
+public:
+    Sub(const Module* p, const std::string& n) : Module(p, n) {}
+    Input<uint32_t> instance(a);
+    Output<uint32_t> instance(o);
+    Register<uint32_t> instance(cnt, 1);
+    void eval() { o = a ^ cnt; cnt <= cnt * 3 + a; }
+};
+
+// Seeds 3 mod 7 fail at clock 200 and seed 11 throws at clock 100.
+struct BatchTB : public Testbench {
+    BatchTB(const uint32_t s) : Testbench("tb"), seed(s), hash(0), r(this, "r", s) {
+        for (int i = 0; i < 20; i++) {
+            std::ostringstream name;
+            name << "s" << i;
+            subs.push_back(std::unique_ptr<Sub>(new Sub(this, name.str())));
+        }
+    }
+    const uint32_t seed;
+    uint64_t hash;
+    Register<uint32_t> r;
+    std::vector<std::unique_ptr<Sub> > subs;
+
+    void main(int, char**) {}
+    void eval() { for (size_t i = 0; i < subs.size(); i++) subs[i]->a = r + i; }
+    void post_clock(const uint32_t clock_num) {
+        r <= r * 1103515245u + 12345u;
+        for (size_t i = 0; i < subs.size(); i++) hash = hash * 31 + (uint32_t) subs[i]->o;
+        if (clock_num == 200) {
+            if (seed % 7 == 3) end_simulation(5, "seed %u failed", seed);
+            else end_simulation(0, "ok");
+        }
+        if (seed == 11 && clock_num == 100) throw std::runtime_error("boom");
+    }
+};
+
+static void check_batch_runner() {
+    const uint32_t n = 32;
+    std::vector<uint64_t> sequential(n), parallel(n);
+    for (uint32_t i = 0; i < n; i++) {
+        BatchTB tb(i);
+        try { tb.simulation(); }
+        catch (const std::exception&) {}
+        sequential[i] = tb.hash;
+    }
+
+    pv::BatchRunner batch(4);
+    for (uint32_t i = 0; i < n; i++) {
+        std::ostringstream name;
+        name << "tb" << i;
+        batch.add(name.str(), [i]() { return new BatchTB(i); },
+            [i, &parallel](Testbench& tb) { const int code = tb.simulation(); parallel[i] = ((BatchTB&) tb).hash; return code; });
+    }
+    CHECK(batch.size() == n && batch.get_threads() == 4);
+    const std::vector<pv::BatchResult>& res = batch.run();
+    CHECK(res.size() == n);
+    if (res.size() != n) return;
+
+    bool same = true, in_order = true;
+    uint32_t expect_passed = 0, clocks = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        if (i != 11) same = same && parallel[i] == sequential[i];
+        std::ostringstream name;
+        name << "tb" << i;
+        in_order = in_order && res[i].name == name.str();
+        expect_passed += (i % 7 != 3 && i != 11);
+        clocks += res[i].clocks;
+    }
+    CHECK(same);
+    CHECK(in_order);
+    CHECK(batch.passed() == expect_passed);
+    CHECK(res[0].passed() && res[0].clocks == 200);
+    CHECK(res[3].completed && res[3].exit_code == 5 && res[3].error.find("seed 3 failed") != std::string::npos);
+    CHECK(!res[11].completed && res[11].error == "boom" && res[11].clocks == 100);
+    CHECK(batch.total_statistics().clocks == clocks);
+
+    std::ostringstream os;
+    batch.print_summary(os);
+    CHECK(os.str().find("FAILED tb11: exception: boom") != std::string::npos);
+}
+
+int main() {
+    check_fork_branches();
+    check_batch_runner();
+    return check_summary("check_branches");
+}
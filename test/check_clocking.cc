@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2023 Michael C Shebanow
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "pv.h"
+#include "check.h"
+
+/*
+ * Clock domain and clock gate checks: registers in a divided domain update
+ * only at its edges and the domain counts them; a gated subtree holds its
+ * registers, and the statistics count the gated subtrees, modules, and
+ * register edges; and the gate state survives a checkpoint.
+ */
+
+static const char* ckpt_file = "check_clocking.ckpt";
+
+// A counter evaluated every clock: q counts the edges of its domain (less the first).
+class Ctr : public Module {
+public:
+    Ctr(const Module* p, const char* n) : Module(p, n) {}
+    Register<uint32_t> instance(q, 0);
+    void eval() { q <= q + 1; force_eval_next_clock(); }
+};
+
+struct DomainTB : public Testbench {
+    DomainTB() : Testbench("tb") {
+        div3 = add_clock_domain("div3", 3);
+        div4 = add_clock_domain("div4", 4, 1);
+        slow.set_clock_domain(div3);
+        reg.q.set_clock_domain(div4);
+    }
+    Ctr instance(fast);
+    Ctr instance(slow);
+    Ctr instance(reg);
+    pv::ClockDomain* div3;
+    pv::ClockDomain* div4;
+    std::vector<uint32_t> log;
+
+    void main(int, char**) {}
+    void eval() {}
+    void post_clock(const uint32_t) {
+        log.push_back(fast.q);
+        log.push_back(slow.q);
+        log.push_back(reg.q);
+    }
+};
+
+static void check_domains() {
+    DomainTB tb;
+    CHECK(tb.clock_domain_count() == 2 && tb.clock_domain(1) == tb.div4);
+    CHECK(tb.div3->has_edge(1) && !tb.div3->has_edge(2) && tb.div3->has_edge(4));
+    CHECK(!tb.div4->has_edge(1) && tb.div4->has_edge(2) && tb.div4->has_edge(6));
+    CHECK(tb.slow.get_clock_domain() == tb.div3 && tb.fast.get_clock_domain() == NULL);
+    tb.set_cycle_limit(10);
+    tb.simulation();
+
+    // div3 has edges at clocks 1, 4, 7, 10; div4 (phase 1) at clocks 2, 6, 10. A domain
+    // assigned to a register only clocks that register, however often its module is evaluated.
+    const uint32_t expect[] = {
+        0, 0, 0,    1, 0, 1,    2, 0, 1,    3, 1, 1,    4, 1, 1,
+        5, 1, 2,    6, 2, 2,    7, 2, 2,    8, 2, 2,    9, 3, 3
+    };
+    CHECK(tb.log == std::vector<uint32_t>(expect, expect + 30));
+    CHECK(tb.div3->get_edges() == 4);
+    CHECK(tb.div4->get_edges() == 3);
+
+    const char* bad[] = { "div3", "", "a b" };
+    int threw = 0;
+    for (int i = 0; i < 3; i++) {
+        try { tb.add_clock_domain(bad[i], 2); }
+        catch (const std::invalid_argument&) { threw++; }
+    }
+    try { tb.add_clock_domain("x", 2, 2); }
+    catch (const std::invalid_argument&) { threw++; }
+    try { tb.add_clock_domain("y", 0); }
+    catch (const std::invalid_argument&) { threw++; }
+    CHECK(threw == 5);
+    CHECK(tb.clock_domain_count() == 2);
+}
+
+// A gated block of two counters and an idle register.
+class Blk : public Module {
+public:
+    Blk(const Module* p, const char* n) : Module(p, n) {}
+    Ctr instance(a);
+    Ctr instance(b);
+    Register<uint8_t> instance(r, 0);
+    void eval() {}
+};
+
+// The block's gate is off from clock 4 to clock 7.
+struct GateTB : public Testbench {
+    GateTB(const bool divided) : Testbench("tb") {
+        if (divided) blk.b.set_clock_domain(add_clock_domain("div2", 2));
+    }
+    Ctr instance(fast);
+    Blk instance(blk);
+    std::vector<uint32_t> log;
+
+    void main(int, char**) {}
+    void eval() {}
+    void pre_clock(const uint32_t clock_num) {
+        if (clock_num == 4) blk.set_clock_enable(false);
+        if (clock_num == 8) blk.set_clock_enable(true);
+    }
+    void post_clock(const uint32_t) {
+        log.push_back(fast.q);
+        log.push_back(blk.a.q);
+    }
+};
+
+static void check_gates() {
+    GateTB tb(false);
+    CHECK(!tb.blk.has_clock_gate() && tb.blk.a.is_clock_enabled());
+    tb.set_cycle_limit(10);
+    tb.simulation();
+    const uint32_t expect[] = { 0, 0, 1, 1, 2, 2, 3, 2, 4, 2, 5, 2, 6, 2, 7, 3, 8, 4, 9, 5 };
+    CHECK(tb.log == std::vector<uint32_t>(expect, expect + 20));
+    CHECK(tb.blk.has_clock_gate() && tb.blk.get_clock_enable());
+
+    // 4 gated clocks of one subtree of 3 modules (blk, blk.a, blk.b) and 3 registers.
+    const pv::SimulationStats s = tb.get_statistics();
+    CHECK(s.gated_subtrees == 4);
+    CHECK(s.gated_modules == 12);
+    CHECK(s.gated_registers == 12);
+    std::ostringstream os;
+    s.print(os);
+    CHECK(os.str().find("gated modules       : 12 (1.200/clock)") != std::string::npos);
+
+    // blk.b.q in a divide-by-2 domain has edges at odd clocks: only those of clocks 5 and 7 are gated.
+    GateTB div(true);
+    div.set_cycle_limit(10);
+    div.simulation();
+    CHECK(div.log == tb.log);
+    CHECK(div.get_statistics().gated_registers == 10);
+    CHECK(div.get_statistics().gated_modules == 12);
+}
+
+// A checkpoint taken while the gate is off restores it off; the run continues as it did.
+static void check_gate_checkpoint() {
+    GateTB ref(false);
+    ref.set_cycle_limit(10);
+    ref.simulation();
+
+    GateTB tb(false);
+    tb.set_cycle_limit(5);
+    tb.simulation();
+    CHECK(!tb.blk.get_clock_enable());
+    CHECK(tb.save_checkpoint(ckpt_file));
+    GateTB restored(false);
+    CHECK(restored.restore_checkpoint(ckpt_file));
+    std::remove(ckpt_file);
+    CHECK(restored.blk.has_clock_gate() && !restored.blk.get_clock_enable());
+    CHECK(!restored.blk.a.is_clock_enabled());
+    restored.set_cycle_limit(10);
+    restored.simulation(true);
+    CHECK(restored.log == std::vector<uint32_t>(ref.log.begin() + 10, ref.log.end()));
+}
+
+int main() {
+    check_domains();
+    check_gates();
+    check_gate_checkpoint();
+    return check_summary("check_clocking");
+}
@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2023 Michael C Shebanow
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <string>
+#include "pv.h"
+#include "check.h"
+
+/*
+ * Coroutine stimulus checks (built as C++20): coroutines resume in the
+ * pre-clock phase after Testbench::pre_clock() or in the post-clock phase
+ * after Testbench::post_clock(), in the order they started waiting; inputs
+ * driven in the pre-clock phase take effect at that clock's edge; and an
+ * exception escaping a coroutine propagates out of simulation().
+ */
+
+// Two coroutines logging where they resume, interleaved with the testbench's own phases.
+struct PhaseTB : public Testbench {
+    PhaseTB() : Testbench("tb"), sched(this) {}
+    pv::StimulusScheduler sched;
+    std::vector<std::string> log;
+
+    void main(int, char**) {}
+    void eval() {}
+    void note(const std::string& s) { log.push_back(s + " " + std::to_string(get_clock())); }
+    void pre_clock(const uint32_t) { note("pre"); }
+    void post_clock(const uint32_t clock_num) {
+        note("post");
+        if (clock_num == 4) end_simulation(0, "done");
+    }
+
+    pv::Stimulus a() {
+        note("a start");
+        co_await pv::clocks(0);
+        note("a clocks(0)");
+        co_await pv::clocks(2);
+        note("a clocks(2)");
+        co_await pv::settled();
+        note("a settled");
+        co_await pv::clocks(1);
+        note("a clocks(1)");
+    }
+    pv::Stimulus b() {
+        note("b start");
+        co_await pv::settled();
+        note("b settled");
+        co_await pv::clocks(2);
+        note("b clocks(2)");
+        co_await pv::settled();
+        note("b settled");
+    }
+};
+
+static void check_phases() {
+    PhaseTB tb;
+    tb.sched.spawn(tb.a());
+    tb.sched.spawn(tb.b());
+    CHECK(tb.sched.active() == 2);
+    CHECK(tb.simulation() == SIM_NORMAL_EXIT);
+    const char* expect[] = {
+        "pre 1", "a start 1", "a clocks(0) 1", "b start 1", "post 1", "b settled 1",
+        "pre 2", "post 2",
+        "pre 3", "a clocks(2) 3", "b clocks(2) 3", "post 3", "a settled 3", "b settled 3",
+        "pre 4", "a clocks(1) 4", "post 4"
+    };
+    const size_t n = sizeof(expect) / sizeof(expect[0]);
+    CHECK(tb.log.size() == n);
+    bool same = tb.log.size() == n;
+    for (size_t i = 0; same && i < n; i++)
+        same = tb.log[i] == expect[i];
+    CHECK(same);
+    CHECK(tb.sched.active() == 0);
+}
+
+// A multiplier taking three clocks: start with x, then result = x * 8 while ready.
+class Dut : public Module {
+public:
+    Dut(const Module* p, const char* n) : Module(p, n) {}
+    Input<bool> instance(start, false);
+    Input<uint32_t> instance(x, 0);
+    Output<bool> instance(ready);
+    Output<uint32_t> instance(result);
+    Register<uint32_t> instance(busy, 0);
+    Register<uint32_t> instance(acc, 0);
+    void eval() {
+        if (start && busy == 0) {
+            busy <= 3;
+            acc <= x;
+        } else if (busy > 0) {
+            busy <= busy - 1;
+            acc <= acc * 2;
+        }
+        ready = (busy == 1);
+        result = acc;
+    }
+};
+
+struct OpTB : public Testbench {
+    OpTB() : Testbench("tb"), sched(this), fail(false) {}
+    Dut instance(dut);
+    pv::StimulusScheduler sched;
+    std::vector<std::string> log;
+    bool fail;
+
+    void main(int, char**) {}
+    void eval() {}
+    void note(const std::string& s) { log.push_back(s + " " + std::to_string(get_clock())); }
+
+    pv::Stimulus op(const uint32_t v) {
+        dut.x = v;
+        dut.start = true;
+        co_await pv::clocks(1);
+        dut.start = false;
+        co_await pv::until(dut.ready);
+        co_await pv::settled();
+        note("op " + std::to_string(v) + " -> " + std::to_string((uint32_t) dut.result));
+    }
+    pv::Stimulus drive() {
+        co_await op(5);
+        co_await pv::clocks(2);
+        co_await op(7);
+        co_await pv::until([this] { return get_clock() >= 20; });
+        note("until");
+        co_await pv::until([this] { return get_clock() >= 20; });
+        note("until again");
+        end_simulation(0, "done");
+    }
+    pv::Stimulus watch() {
+        for (;;) {
+            co_await pv::settled();
+            if (dut.ready) note("ready");
+            if (fail) throw std::runtime_error("boom");
+        }
+    }
+};
+
+static void check_stimulus() {
+    OpTB tb;
+    tb.sched.spawn(tb.drive());
+    tb.sched.spawn(tb.watch());
+    CHECK(tb.simulation() == SIM_NORMAL_EXIT);
+    CHECK(tb.get_clock() == 20);
+
+    // ready settles in clock 4; until() resumes in the pre-clock phase of clock 5, and settled()
+    // in its post-clock phase, with result = 5 * 8. The second op starts 2 clocks later.
+    const char* expect[] = {
+        "ready 4", "op 5 -> 40 5", "ready 10", "op 7 -> 56 11", "until 20", "until again 20"
+    };
+    const size_t n = sizeof(expect) / sizeof(expect[0]);
+    CHECK(tb.log.size() == n);
+    bool same = tb.log.size() == n;
+    for (size_t i = 0; same && i < n; i++)
+        same = tb.log[i] == expect[i];
+    CHECK(same);
+
+    // The watcher is still waiting; its exception ends the next run and the coroutine.
+    CHECK(tb.sched.active() == 1);
+    tb.fail = true;
+    tb.set_cycle_limit(tb.get_clock() + 3);
+    bool threw = false;
+    try { tb.simulation(true); }
+    catch (const std::runtime_error& e) { threw = std::string(e.what()) == "boom"; }
+    CHECK(threw);
+    CHECK(tb.sched.active() == 0);
+}
+
+int main() {
+    check_phases();
+    check_stimulus();
+    return check_summary("check_coroutine");
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2023 Michael C Shebanow
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "pv.h"
+#include "check.h"
+
+/*
+ * Fifo checks: push/pop ordering, overflow and underflow, and reset.
+ *
+ * The testbench runs a script by clock number: pushes and pops staged in
+ * clock c are committed by the positive edge of clock c + 1 and so are first
+ * seen by post_clock(c + 1).
+ */
+
+struct FifoTB : public Testbench {
+    FifoTB() : Testbench("tb") {}
+    Fifo<uint16_t, 4, 12> instance(f);
+
+    struct Seen { uint32_t count; int head; uint64_t overflows, underflows; };
+    std::vector<Seen> seen;
+
+    void main(int, char**) {}
+    void eval() {
+        force_eval_next_clock();
+        const uint32_t c = get_clock();
+        if (c == 1) f.pop();                                // underflow
+        if (c >= 2 && c <= 6) f.push(0x1000 + c - 1);       // 1 to 4, then an overflow
+        if (c == 7) { f.push(0xabc); f.pop(); }             // full: pop, then push
+        if (c >= 8 && c <= 12) f.pop();                     // drain, then an underflow
+    }
+    void post_clock(const uint32_t) {
+        Seen s = { f.count(), f.front_is_x() ? -1 : f.front(), f.get_overflows(), f.get_underflows() };
+        seen.push_back(s);
+    }
+};
+
+static void check_fifo() {
+    FifoTB tb;
+    tb.set_cycle_limit(13);
+    tb.simulation();
+    CHECK(tb.seen.size() == 13);
+    if (tb.seen.size() != 13) return;
+    const FifoTB::Seen expect[13] = {
+        { 0, -1, 0, 0 },            // clock 1
+        { 0, -1, 0, 1 },            // pop of empty FIFO dropped
+        { 1, 1, 0, 1 },             // pushes truncated to 12 bits
+        { 2, 1, 0, 1 },
+        { 3, 1, 0, 1 },
+        { 4, 1, 0, 1 },             // full
+        { 4, 1, 1, 1 },             // push to a full FIFO dropped
+        { 4, 2, 1, 1 },             // push and pop of a full FIFO
+        { 3, 3, 1, 1 },
+        { 2, 4, 1, 1 },
+        { 1, 0xabc, 1, 1 },
+        { 0, -1, 1, 1 },
+        { 0, -1, 1, 2 },
+    };
+    bool ok = true;
+    for (int i = 0; i < 13; i++)
+        ok = ok && tb.seen[i].count == expect[i].count && tb.seen[i].head == expect[i].head &&
+            tb.seen[i].overflows == expect[i].overflows && tb.seen[i].underflows == expect[i].underflows;
+    CHECK(ok);
+
+    // Contents after the full push and pop (clock 8), then reset.
+    FifoTB tb2;
+    tb2.set_cycle_limit(8);
+    tb2.simulation();
+    CHECK(tb2.f.full() && tb2.f.at(0) == 2 && tb2.f.at(3) == 0xabc);
+    tb2.reset_to_instance_state();
+    CHECK(tb2.f.empty() && tb2.f.front_is_x());
+}
+
+int main() {
+    check_fifo();
+    return check_summary("check_fifo");
+}
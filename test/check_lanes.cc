@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2023 Michael C Shebanow
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <random>
+#include "pv.h"
+#include "check.h"
+
+/*
+ * pv::Lanes<T, K> checks: the operators and masks apply lane by lane, a block
+ * simulated on K lanes produces, in every lane, what the scalar block produces
+ * for that lane's stimulus, a change in any one lane is a change of the
+ * signal, and VCD dumps print all lanes or the selected one.
+ */
+
+static const int K = 64;
+typedef pv::Lanes<uint16_t, K> L;
+
+static void check_operators() {
+    std::mt19937 rng(3);
+    bool ok = true;
+    for (int t = 0; t < 20; t++) {
+        L a, b, s;
+        for (int i = 0; i < K; i++) {
+            a.set_lane(i, rng());
+            b.set_lane(i, rng() | 1);
+            s.set_lane(i, rng() % 16);
+        }
+        const L r_and = a & b, r_or = a | b, r_xor = a ^ b, r_add = a + b, r_sub = a - b, r_mul = a * b;
+        const L r_div = a / b, r_mod = a % b, r_not = ~a, r_neg = -a, r_shl = a << 3, r_shr = a >> 5;
+        const L r_vshl = a << s, r_vshr = a >> s;
+        const L r_sel = pv::select(pv::lane_lt(a, b), a, b);
+        const pv::Lanes<bool, K> eq = pv::lane_eq(a, b), ge = pv::lane_ge(a, b);
+        for (int i = 0; i < K; i++) {
+            const uint16_t x = a.lane(i), y = b.lane(i), z = s.lane(i);
+            ok = ok && r_and.lane(i) == (uint16_t) (x & y) && r_or.lane(i) == (uint16_t) (x | y) &&
+                r_xor.lane(i) == (uint16_t) (x ^ y) && r_add.lane(i) == (uint16_t) (x + y) &&
+                r_sub.lane(i) == (uint16_t) (x - y) && r_mul.lane(i) == (uint16_t) (x * y) &&
+                r_div.lane(i) == (uint16_t) (x / y) && r_mod.lane(i) == (uint16_t) (x % y) &&
+                r_not.lane(i) == (uint16_t) ~x && r_neg.lane(i) == (uint16_t) -x &&
+                r_shl.lane(i) == (uint16_t) (x << 3) && r_shr.lane(i) == (uint16_t) (x >> 5) &&
+                r_vshl.lane(i) == (uint16_t) (x << z) && r_vshr.lane(i) == (uint16_t) (x >> z) &&
+                r_sel.lane(i) == std::min(x, y) && eq.lane(i) == (x == y) && ge.lane(i) == (x >= y);
+        }
+    }
+    CHECK(ok);
+
+    // Scalars broadcast; masks summarize.
+    const L seq = L::sequence(10, 3);
+    CHECK(seq.lane(0) == 10 && seq.lane(63) == 10 + 63 * 3);
+    CHECK((seq + 1).lane(5) == 26);
+    const pv::Lanes<bool, K> m = pv::lane_gt(seq, L(100));
+    CHECK(m.count() == K - 31 && m.first() == 31 && m.any() && !m.all());
+    CHECK(pv::lane_eq(seq, seq).all() && pv::lane_ne(seq, seq).none());
+    CHECK((~pv::Lanes<bool, 4>(true)).none());
+
+    // == and != compare all lanes.
+    L c = seq;
+    CHECK(c == seq);
+    c.set_lane(40, 0);
+    CHECK(c != seq);
+
+    std::ostringstream os;
+    os << pv::Lanes<uint8_t, 4>::sequence(250, 2);
+    CHECK(os.str() == "{250, 252, 254, 0}");
+}
+
+// A block written once for both the scalar and the lane-parallel type: values saturate through
+// a data-dependent select, and an accumulator feeds back.
+template <typename V>
+class Blk : public Module {
+public:
+    Blk(const Module* p, const char* n) : Module(p, n) {}
+    Input<V> instance(a);
+    Input<V> instance(b);
+    Output<V> instance(y);
+    Register<V> instance(acc, V(0));
+    void eval() {
+        const V s = a + b;
+        y = sel(s, V(a) ^ acc);
+        acc <= acc + (y >> 1) + 1;
+    }
+    static uint16_t sel(const uint16_t s, const uint16_t x) { return s > 300 ? x : s; }
+    static L sel(const L& s, const L& x) { return pv::select(pv::lane_gt(s, L(300)), x, s); }
+};
+
+// Stimulus of lane i (or of the scalar testbench for base 5 * i): base + 3 * clock, and 7 * clock.
+template <typename V>
+struct BlkTB : public Testbench {
+    BlkTB(const V& b) : Testbench("tb"), base(b) {}
+    Blk<V> instance(blk);
+    Register<uint16_t> instance(cnt, 0);
+    const V base;
+    std::vector<V> ys;
+
+    void main(int, char**) {}
+    void eval() {
+        blk.a = base + V(cnt * 3);
+        blk.b = V(cnt * 7);
+    }
+    void post_clock(const uint32_t clock_num) {
+        ys.push_back(blk.y);
+        cnt <= cnt + 1;
+        if (clock_num == 40) end_simulation(0, "done");
+    }
+};
+
+static void check_scalar_equivalence() {
+    BlkTB<L> lanes(L::sequence(0, 5));
+    CHECK(lanes.simulation() == SIM_NORMAL_EXIT);
+    CHECK(lanes.ys.size() == 40);
+    bool same = true;
+    for (int i = 0; i < K; i++) {
+        BlkTB<uint16_t> scalar(i * 5);
+        scalar.simulation();
+        same = same && scalar.ys.size() == lanes.ys.size();
+        for (size_t c = 0; same && c < scalar.ys.size(); c++)
+            same = scalar.ys[c] == lanes.ys[c].lane(i);
+    }
+    CHECK(same);
+
+    // One evaluation per clock covers all lanes.
+    CHECK(lanes.get_statistics().evals == 160);
+}
+
+// A sink whose input changes in one lane only, every other clock.
+class LaneSink : public Module {
+public:
+    LaneSink(const Module* p, const char* n) : Module(p, n), evals(0) {}
+    Input<L> instance(in);
+    int evals;
+    void eval() { evals++; }
+};
+
+struct SinkTB : public Testbench {
+    SinkTB() : Testbench("tb") {}
+    LaneSink instance(sink);
+    void main(int, char**) {}
+    void eval() {}
+    void pre_clock(const uint32_t clock_num) {
+        L v(1);
+        v.set_lane(K - 1, (clock_num / 2) & 1);
+        sink.in = v;
+    }
+};
+
+static void check_change_detection() {
+    SinkTB tb;
+    tb.set_cycle_limit(20);
+    tb.simulation();
+    // The kick-start in clock 1, then the 10 changes of lane K - 1 (clocks 2, 4, ..., 20).
+    CHECK(tb.sink.evals == 11);
+}
+
+static void check_vcd() {
+    typedef pv::Lanes<uint8_t, 4> L4;
+    const L4 s = L4::sequence(250, 2);
+    vcd::value2string_t<L4> p(s);
+    CHECK(p(s) == "b00000000111111101111110011111010");
+    pv::set_vcd_lane(1);
+    CHECK(p(s) == "b00000000000000000000000011111100");
+    pv::set_vcd_lane(-1);
+
+    typedef pv::Lanes<bool, 4> B4;
+    const B4 m = !L4::sequence(0);
+    vcd::value2string_t<B4> pb(m);
+    CHECK(pb(m) == "b0001");
+}
+
+int main() {
+    check_operators();
+    check_scalar_equivalence();
+    check_change_detection();
+    check_vcd();
+    return check_summary("check_lanes");
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2023 Michael C Shebanow
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <sstream>
+#include "pv.h"
+#include "check.h"
+
+/*
+ * Signal layout checks: names are interned once however many instances use
+ * them; wires and registers stay small; a wire written several times in a
+ * clock holds the last value written; and the footprint report counts every
+ * signal class.
+ */
+
+// A leaf whose input is written several times per clock by the testbench.
+class Leaf : public Module {
+public:
+    Leaf(const Module* p, const char* n) : Module(p, n), evals(0) {}
+    Input<uint32_t> instance(in, 0);
+    Wire<bool> instance(flag, false);
+    Register<bool> instance(q, false);
+    int evals;
+    void eval() { evals++; flag = (in & 1); q <= flag; }
+};
+
+struct LayoutTB : public Testbench {
+    LayoutTB() : Testbench("tb") {}
+    Leaf instance(a);
+    Leaf instance(b);
+    void main(int, char**) {}
+    void eval() {}
+    void pre_clock(const uint32_t clock_num) {
+        // a: back to 0 every clock, through 'x'. b: clock / 3.
+        a.in = clock_num;
+        a.in.assign_x();
+        a.in = 0;
+        b.in = 7;
+        b.in = clock_num / 3;
+    }
+};
+
+static void check_names() {
+    CHECK(pv::NameTable::intern("in") == pv::NameTable::intern(std::string("in")));
+    LayoutTB tb;
+    CHECK(tb.a.in.name() == "in" && tb.a.in.instanceName() == "tb.a.in");
+    const size_t names = pv::NameTable::size();
+    LayoutTB tb2;
+    CHECK(pv::NameTable::size() == names);
+    CHECK(tb2.b.q.name() == "q");
+}
+
+static void check_sizes() {
+    // Wire<bool> and Register<bool> were 136 and 120 bytes before the layout was slimmed.
+    CHECK(sizeof(Wire<bool>) <= 64);
+    CHECK(sizeof(Register<bool>) <= 64);
+    LayoutTB tb;
+    CHECK(tb.a.flag.footprint() >= sizeof(Wire<bool>));
+
+    std::ostringstream os;
+    tb.footprint_report(os);
+    CHECK(os.str().find("Wire<bool, -1>") != std::string::npos);
+    CHECK(os.str().find("Input<unsigned int, -1>") != std::string::npos);
+    CHECK(os.str().find("Name table:") != std::string::npos);
+}
+
+static void check_repeated_writes() {
+    LayoutTB tb;
+    tb.set_cycle_limit(8);
+    tb.simulation();
+
+    // The last write of a clock wins, including after an 'x' in between.
+    CHECK((uint32_t) tb.a.in == 0 && !tb.a.in.value_is_x() && !tb.a.in.value_was_x());
+    CHECK((uint32_t) tb.b.in == 2 && !tb.b.in.value_is_x());
+    CHECK(!tb.a.flag && !tb.b.flag && !tb.b.q.value_is_x());
+
+    // Continued, b.in changes to 3 at clock 9: b.flag follows, and b.q one edge later.
+    tb.set_cycle_limit(10);
+    tb.simulation(true);
+    CHECK((uint32_t) tb.b.in == 3 && tb.b.flag && (bool) tb.b.q);
+}
+
+int main() {
+    check_names();
+    check_sizes();
+    check_repeated_writes();
+    return check_summary("check_layout");
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2023 Michael C Shebanow
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <random>
+#include "pv.h"
+#include "check.h"
+
+/*
+ * pv::Logic<N> checks: per-bit four-state truth tables (on one bit and on a
+ * multi-word vector), x propagation through arithmetic, logical vs case
+ * equality, string parsing, VCD printing, and change detection of Logic
+ * signals on their unknown plane.
+ */
+
+static const char states[] = "01xz";
+
+// Verilog truth tables; z reads as x on input to an operator.
+static char ref_and(const char a, const char b) {
+    if (a == '0' || b == '0') return '0';
+    return (a == '1' && b == '1') ? '1' : 'x';
+}
+static char ref_or(const char a, const char b) {
+    if (a == '1' || b == '1') return '1';
+    return (a == '0' && b == '0') ? '0' : 'x';
+}
+static char ref_xor(const char a, const char b) {
+    if (a > '1' || b > '1') return 'x';
+    return a == b ? '0' : '1';
+}
+static char ref_not(const char a) { return a == '0' ? '1' : a == '1' ? '0' : 'x'; }
+
+static void check_truth_tables() {
+    typedef pv::Logic<1> L1;
+    for (int i = 0; i < 4; i++)
+        for (int j = 0; j < 4; j++) {
+            L1 a, b;
+            a.set(0, states[i]);
+            b.set(0, states[j]);
+            CHECK((a & b).get(0) == ref_and(states[i], states[j]));
+            CHECK((a | b).get(0) == ref_or(states[i], states[j]));
+            CHECK((a ^ b).get(0) == ref_xor(states[i], states[j]));
+            CHECK((~a).get(0) == ref_not(states[i]));
+        }
+
+    // The same tables bit by bit across a vector spanning several words.
+    typedef pv::Logic<200> L;
+    std::mt19937 rng(1);
+    for (int t = 0; t < 50; t++) {
+        L a, b;
+        for (int i = 0; i < L::width; i++) {
+            a.set(i, states[rng() % 4]);
+            b.set(i, states[rng() % 4]);
+        }
+        const L r_and = a & b, r_or = a | b, r_xor = a ^ b, r_not = ~a;
+        bool ok = true;
+        for (int i = 0; i < L::width; i++)
+            ok = ok && r_and.get(i) == ref_and(a.get(i), b.get(i)) && r_or.get(i) == ref_or(a.get(i), b.get(i)) &&
+                r_xor.get(i) == ref_xor(a.get(i), b.get(i)) && r_not.get(i) == ref_not(a.get(i));
+        CHECK(ok);
+    }
+}
+
+static void check_arithmetic() {
+    typedef pv::Logic<8> L8;
+    CHECK(L8(200) + L8(100) == L8(44));
+    CHECK(L8(3) - L8(5) == L8(254));
+    CHECK(L8(20) * L8(13) == L8(4));
+    CHECK(L8(200) / L8(7) == L8(28));
+    CHECK(L8(200) % L8(7) == L8(4));
+    CHECK(L8("0000_000x") + L8(1) == L8::x());
+    CHECK(L8(1) * L8("z0000000") == L8::x());
+    L8 c(254);
+    c++;
+    CHECK(c.to_uint64() == 255);
+
+    // Shifts move both planes and shift in known zeros.
+    CHECK((L8("1010xxzz") << 2).to_string() == "10xxzz00");
+    CHECK((L8("1010xxzz") >> 3).to_string() == "0001010x");
+
+    // Conversions count known ones only.
+    CHECK(L8("0000_1x1z").to_uint64() == 0x0a);
+    CHECK(!(bool) L8("0000_xxzz"));
+    CHECK((bool) L8("0000_x1zz"));
+    CHECK(L8(5).is_known() && !L8("101z").is_known());
+}
+
+static void check_equality() {
+    typedef pv::Logic<4> L4;
+    CHECK(L4(9).eq(L4(9)).get(0) == '1');
+    CHECK(L4(9).eq(L4(8)).get(0) == '0');
+    CHECK(L4("1x01").eq(L4("0x01")).get(0) == '0');
+    CHECK(L4("1x01").eq(L4("1x01")).get(0) == 'x');
+    CHECK(L4("1x01").ne(L4(13)).get(0) == 'x');
+
+    // Case equality compares both planes.
+    CHECK(L4("1x01") == L4("1x01"));
+    CHECK(L4("1x01") != L4("1z01"));
+    CHECK(L4::x() != L4::z());
+    CHECK(L4("4'b1_0_x_z").to_string() == "10xz");
+    CHECK(L4("1").to_string() == "0001");
+
+    bool threw = false;
+    try { L4 bad("10q1"); }
+    catch (const std::invalid_argument&) { threw = true; }
+    CHECK(threw);
+
+    // VCD strings: one character per bit.
+    const L4 v("x1z0");
+    vcd::value2string_t<L4> p(v);
+    CHECK(p(v) == "bx1z0");
+    CHECK(p(v, false) == "x1z0");
+}
+
+// A sink evaluated whenever its Logic input changes, including a change of unknown bits only.
+class Sink : public Module {
+public:
+    Sink(const Module* p, const char* n) : Module(p, n), evals(0) {}
+    Input<pv::Logic<4> > instance(in);
+    Register<pv::Logic<4> > instance(q, pv::Logic<4>("xxxx"));
+    int evals;
+    void eval() { evals++; q <= in; }
+};
+
+struct LogicTB : public Testbench {
+    LogicTB() : Testbench("tb"), toggle(true) {}
+    Sink instance(sink);
+    bool toggle;
+    void main(int, char**) {}
+    void eval() {}
+    void pre_clock(const uint32_t clock_num) {
+        sink.in = (toggle && (clock_num & 1)) ? pv::Logic<4>("01zz") : pv::Logic<4>("01xx");
+    }
+};
+
+static void check_signals() {
+    LogicTB tb;
+    tb.set_cycle_limit(10);
+    tb.simulation();
+    CHECK(tb.sink.evals == 10);
+    CHECK((pv::Logic<4>) tb.sink.q == pv::Logic<4>("01zz"));
+
+    // Writing the same value every clock: only the kick-start eval() of the continued run.
+    tb.toggle = false;
+    tb.set_cycle_limit(20);
+    tb.simulation(true);
+    CHECK(tb.sink.evals == 11);
+    CHECK((pv::Logic<4>) tb.sink.q == pv::Logic<4>("01xx"));
+}
+
+int main() {
+    check_truth_tables();
+    check_arithmetic();
+    check_equality();
+    check_signals();
+    return check_summary("check_logic");
+}
@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2023 Michael C Shebanow
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <fstream>
+#include "pv.h"
+#include "check.h"
+
+/*
+ * Memory checks: write and read ports, sparse storage, and image loaders
+ * (readmemh/readmemb, load_binary, map_image).
+ *
+ * The testbench runs a script by clock number: accesses staged in clock c
+ * are committed by the positive edge of clock c + 1 and so are first seen by
+ * post_clock(c + 1).
+ */
+
+/*
+ * Memory ports.
+ */
+struct MemoryTB : public Testbench {
+    MemoryTB() : Testbench("tb") {}
+    Memory<uint32_t, 64, 12, 2> instance(ram);
+    Memory<uint64_t, (1ull << 36)> instance(dram, 7);
+    uint32_t seen_before_commit;
+
+    // Committed state seen by post_clock(), by clock.
+    struct Seen { uint32_t ram1, ram2, q0, q1; bool q0_x, q1_x; uint64_t dram_hi; };
+    std::vector<Seen> seen;
+
+    void main(int, char**) {}
+    void eval() {
+        force_eval_next_clock();
+        switch (get_clock()) {
+        case 1:
+            ram.write(1, 0x1234);       // truncated to 12 bits
+            ram.write(2, 5);
+            ram.write(2, 6);            // last write wins
+            ram.read_sync(1, 0);        // read-first: sees the old contents
+            dram.write(1ull << 35, 42);
+            seen_before_commit = ram[1];
+            break;
+        case 2:
+            ram.read_sync(1, 0);
+            ram.read_sync(2, 1);
+            break;
+        }
+    }
+    void post_clock(const uint32_t) {
+        Seen s = { ram[1], ram[2], ram.q(0), ram.q(1), ram.q_is_x(0), ram.q_is_x(1), dram[1ull << 35] };
+        seen.push_back(s);
+    }
+};
+
+static void check_memory_ports() {
+    MemoryTB tb;
+    CHECK(tb.ram.is_dense() && !tb.dram.is_dense());
+    CHECK(tb.dram.allocated_bytes() == 0);
+    tb.set_cycle_limit(3);
+    tb.simulation();
+    CHECK(tb.seen.size() == 3);
+    if (tb.seen.size() != 3) return;
+
+    // Clock 1: nothing committed yet; read data is 'x'.
+    CHECK(tb.seen_before_commit == 0);
+    CHECK(tb.seen[0].ram1 == 0 && tb.seen[0].q0_x && tb.seen[0].q1_x);
+    CHECK(tb.seen[0].dram_hi == 7);
+
+    // Clock 2: writes committed; the registered read returned the old contents.
+    CHECK(tb.seen[1].ram1 == 0x234 && tb.seen[1].ram2 == 6);
+    CHECK(!tb.seen[1].q0_x && tb.seen[1].q0 == 0 && tb.seen[1].q1_x);
+    CHECK(tb.seen[1].dram_hi == 42);
+
+    // Clock 3: both read ports return the committed contents.
+    CHECK(tb.seen[2].q0 == 0x234 && tb.seen[2].q1 == 6 && !tb.seen[2].q1_x);
+
+    // Sparse storage: one page allocated; unwritten words read as the fill value.
+    CHECK(tb.dram.allocated_bytes() == pv::memory_page_words * sizeof(uint64_t));
+    CHECK(tb.dram[3] == 7);
+
+    // Reset keeps the contents but makes read data 'x'.
+    tb.reset_to_instance_state();
+    CHECK(tb.ram[1] == 0x234 && tb.ram.q_is_x(0));
+
+    bool threw = false;
+    try { tb.ram.read(64); }
+    catch (const std::out_of_range&) { threw = true; }
+    CHECK(threw);
+    threw = false;
+    try { tb.ram.q(2); }
+    catch (const std::out_of_range&) { threw = true; }
+    CHECK(threw);
+}
+
+/*
+ * Memory image loaders.
+ */
+struct ImageTB : public Testbench {
+    ImageTB() : Testbench("tb") {}
+    Memory<uint32_t, 64> instance(rom);
+    Memory<uint8_t, 8, 4> instance(nib);
+    Memory<pv::Bits<72>, 4> instance(wide);
+    Memory<uint64_t, 20000> instance(small);
+    Memory<uint64_t, (1ull << 36)> instance(dram);
+    void main(int, char**) {}
+    void eval() { if (get_clock() == 1) dram.write(5, 99); }
+};
+
+static void write_file(const char* name, const char* text) { std::ofstream(name) << text; }
+
+static void check_memory_images() {
+    ImageTB tb;
+    write_file("check_memory.hex", "// ROM image\n@10 dead_beef 1 /* block\ncomment */ 2\n@0 FF\n");
+    CHECK(tb.rom.readmemh("check_memory.hex"));
+    CHECK(tb.rom[0x10] == 0xdeadbeef && tb.rom[0x11] == 1 && tb.rom[0x12] == 2 && tb.rom[0] == 0xff);
+    CHECK(tb.rom[0x13] == 0 && tb.rom[1] == 0);
+
+    // Binary words are truncated to the memory width; x and z digits load as 0.
+    write_file("check_memory.bin", "1111 0101 11111 1x1z\n");
+    CHECK(tb.nib.readmemb("check_memory.bin", 2));
+    CHECK(tb.nib[2] == 0xf && tb.nib[3] == 5 && tb.nib[4] == 0xf && tb.nib[5] == 0xa);
+    CHECK(tb.nib[0] == 0);
+
+    // Words wider than 64 bits.
+    write_file("check_memory.hex", "1_0000_0000_0000_0001 ff\n");
+    CHECK(tb.wide.readmemh("check_memory.hex"));
+    CHECK(tb.wide[0] == (pv::Bits<72>(1) << 64) + 1 && tb.wide[1] == pv::Bits<72>(0xff));
+
+    // Errors: missing file, illegal digit, address outside of the load range.
+    {
+        CaptureCerr capture;
+        CHECK(!tb.rom.readmemh("check_memory.none"));
+        write_file("check_memory.hex", "12 3g\n");
+        CHECK(!tb.rom.readmemh("check_memory.hex"));
+        CHECK(capture.str().find("line 1: illegal digit 'g'") != std::string::npos);
+        write_file("check_memory.hex", "1 2 3 4\n");
+        CHECK(!tb.rom.readmemh("check_memory.hex", 0, 2));
+        CHECK(capture.str().find("outside of memory tb.rom load range") != std::string::npos);
+    }
+
+    // Binary images: copied into dense memories, mapped into sparse ones.
+    {
+        std::ofstream os("check_memory.img", std::ios::binary);
+        for (uint64_t i = 0; i < 10000; i++) os.write((const char*) &i, sizeof(i));
+    }
+    CHECK(tb.small.load_binary("check_memory.img", 100));
+    CHECK(tb.small[100] == 0 && tb.small[10099] == 9999 && tb.small[10100] == 0);
+    CHECK(tb.dram.map_image("check_memory.img", 3));
+    CHECK(tb.dram[3] == 0 && tb.dram[10002] == 9999 && tb.dram[10003] == 0);
+    CHECK(tb.dram.allocated_bytes() == 0);
+
+    // Writes to a mapped image go to its private copy-on-write mapping; the file is not modified.
+    tb.set_cycle_limit(2);
+    tb.simulation();
+    CHECK(tb.dram[5] == 99 && tb.dram[6] == 3);
+    CHECK(tb.dram.allocated_bytes() == 0);
+    ImageTB tb2;
+    CHECK(tb2.dram.map_image("check_memory.img"));
+    CHECK(tb2.dram[5] == 5);
+
+    std::remove("check_memory.hex");
+    std::remove("check_memory.bin");
+    std::remove("check_memory.img");
+}
+
+int main() {
+    check_memory_ports();
+    check_memory_images();
+    return check_summary("check_memory");
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2023 Michael C Shebanow
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <sstream>
+#include "pv.h"
+#include "check.h"
+
+/*
+ * Combinational oscillation diagnostics: an exceeded iteration limit names the
+ * loop of modules and wires, and the report lists the recorded iterations.
+ */
+
+class Inverter : public Module {
+public:
+    Inverter(const Module* p, const char* n) : Module(p, n) {}
+    Input<bool> instance(in);
+    Output<bool> instance(out);
+    void eval() { out = !in; }
+};
+
+// Two inverters in a ring, through the testbench.
+struct RingTB : public Testbench {
+    RingTB() : Testbench("ring") {}
+    Inverter instance(a);
+    Inverter instance(b);
+    void main(int, char**) {}
+    void eval() { b.in = a.out; a.in = b.out; }
+};
+
+// A module that inverts its own wire.
+class Toggler : public Module {
+public:
+    Toggler(const Module* p, const char* n) : Module(p, n) {}
+    Wire<bool> instance(w, false);
+    void eval() { w = !w; }
+};
+
+struct SelfTB : public Testbench {
+    SelfTB() : Testbench("self") {}
+    Toggler instance(t);
+    void main(int, char**) {}
+    void eval() {}
+};
+
+// A chain of stages, each driving the input of the next directly: settling takes as many
+// delta iterations as there are stages, but there is no loop.
+class Stage : public Module {
+public:
+    Stage(const Module* p, const char* n) : Module(p, n), next(NULL) {}
+    Input<bool> instance(in);
+    Stage* next;
+    void eval() { if (next) next->in = !in; }
+};
+
+struct ChainTB : public Testbench {
+    ChainTB() : Testbench("chain") { a.next = &b; b.next = &c; }
+    Stage instance(a);
+    Stage instance(b);
+    Stage instance(c);
+    void main(int, char**) {}
+    void eval() {}
+    void pre_clock(const uint32_t clock_num) { a.in = (clock_num & 1) != 0; }
+};
+
+static bool starts_with(const std::string& s, const std::string& prefix) {
+    return s.compare(0, prefix.size(), prefix) == 0;
+}
+
+static int count_lines(const std::string& s, const std::string& prefix) {
+    std::istringstream is(s);
+    std::string line;
+    int n = 0;
+    while (std::getline(is, line))
+        if (starts_with(line, prefix)) n++;
+    return n;
+}
+
+int main() {
+    {
+        RingTB tb;
+        tb.set_iteration_limit(10);
+        tb.set_cycle_limit(5);
+        CHECK(tb.simulation() == SIM_ERR_ITERATION_LIMIT);
+        const std::string loop = "combinational loop through modules {ring, ring.a, ring.b} "
+            "via wires {ring.a.in, ring.a.out, ring.b.in, ring.b.out}";
+        CHECK(tb.error_string().find("iteration limit exceeded at clock cycle 1; " + loop) != std::string::npos);
+        const std::string& report = tb.get_oscillation_report();
+        CHECK(starts_with(report, loop + "\n"));
+        CHECK(count_lines(report, "  iteration ") == 8);
+        CHECK(report.find("  iteration 10: evaluated ring ring.a ring.b; changed") != std::string::npos);
+    }
+    {
+        RingTB tb;
+        tb.set_iteration_limit(10);
+        tb.set_oscillation_history(3);
+        tb.simulation();
+        CHECK(count_lines(tb.get_oscillation_report(), "  iteration ") == 3);
+        CHECK(tb.get_oscillation_report().find("  iteration 8:") != std::string::npos);
+    }
+    {
+        RingTB tb;
+        tb.set_iteration_limit(10);
+        tb.set_oscillation_history(0);
+        CHECK(tb.simulation() == SIM_ERR_ITERATION_LIMIT);
+        CHECK(tb.get_oscillation_report().empty());
+        CHECK(tb.error_string() == "Simulation error: iteration limit exceeded at clock cycle 1");
+    }
+    {
+        SelfTB tb;
+        tb.set_iteration_limit(6);
+        CHECK(tb.simulation() == SIM_ERR_ITERATION_LIMIT);
+        CHECK(starts_with(tb.get_oscillation_report(), "combinational loop through modules {self.t} via wires {self.t.w}\n"));
+    }
+    {
+        ChainTB tb;
+        tb.set_iteration_limit(2);
+        CHECK(tb.simulation() == SIM_ERR_ITERATION_LIMIT);
+        CHECK(starts_with(tb.get_oscillation_report(), "no combinational loop found in the last 2 iterations\n"));
+
+        // With room to settle, the chain runs to the clock limit.
+        ChainTB ok;
+        ok.set_iteration_limit(5);
+        ok.set_cycle_limit(3);
+        CHECK(ok.simulation() == SIM_CLOCK_LIMIT);
+        CHECK(ok.get_oscillation_report().empty());
+    }
+    return check_summary("check_oscillation");
+}
@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2023 Michael C Shebanow
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include "pv.h"
+#include "check.h"
+
+/*
+ * Profiler, simulation statistics, and activity counter checks.
+ *
+ * The testbench drives a doubler whose outputs feed back into the testbench:
+ * every clock the testbench is evaluated, then the doubler, then the testbench
+ * again (three delta iterations). Counts are compared over a continued run of
+ * a known number of clocks so the start-up clocks do not matter. Note that
+ * simulation() kick-starts every module: in the first clock of the continued
+ * run the doubler is evaluated along with the testbench in the first delta
+ * iteration and again in the second, which settles that clock in two.
+ */
+
+class Doubler : public Module {
+public:
+    Doubler(const Module* p, const char* n) : Module(p, n) {}
+    Input<uint32_t> instance(in);
+    Output<uint32_t> instance(out);
+    Output<uint32_t> instance(half);
+    void eval() { out = in * 2; half = in / 2; }
+};
+
+// Signal IDs are assigned in construction order: cnt = 0, hold = 1, dbl.in = 2, dbl.out = 3, dbl.half = 4.
+struct ProfileTB : public Testbench {
+    ProfileTB() : Testbench("tb") {}
+    Register<uint32_t> instance(cnt, 0);
+    Register<uint8_t> instance(hold, 5);
+    Doubler instance(dbl);
+    bool doubled;
+
+    void main(int, char**) {}
+    void eval() {
+        cnt <= cnt + 1;
+        hold <= 5;
+        dbl.in = cnt;
+    }
+    void post_clock(const uint32_t) { doubled = (dbl.out == 2 * cnt) && (dbl.half == cnt / 2); }
+};
+
+static const pv::ModuleProfileRecord* find_record(const std::vector<pv::ModuleProfileRecord>& v, const std::string& name) {
+    for (size_t i = 0; i < v.size(); i++)
+        if (v[i].name == name) return &v[i];
+    return NULL;
+}
+
+static void check_profiler() {
+    ProfileTB tb;
+    pv::Profiler p;
+    tb.set_profiler(&p);
+    tb.set_cycle_limit(10);
+    tb.simulation();
+    std::vector<pv::ModuleProfileRecord> before = p.sorted_records();
+    const pv::ModuleProfileRecord* t0 = find_record(before, "tb");
+    const pv::ModuleProfileRecord* d0 = find_record(before, "tb.dbl");
+    CHECK(t0 != NULL && d0 != NULL);
+    if (!t0 || !d0) return;
+    const pv::SimulationStats s0 = tb.get_statistics();
+    CHECK(s0.clocks == 10);
+    CHECK(s0.evals == t0->evals + d0->evals);
+
+    tb.set_cycle_limit(30);
+    tb.simulation(true);
+    std::vector<pv::ModuleProfileRecord> after = p.sorted_records();
+    const pv::ModuleProfileRecord* t1 = find_record(after, "tb");
+    const pv::ModuleProfileRecord* d1 = find_record(after, "tb.dbl");
+    CHECK(after.size() == 2);
+    CHECK(t1->evals - t0->evals == 40);
+    CHECK(t1->reevals - t0->reevals == 20);
+    CHECK(d1->evals - d0->evals == 21);
+    CHECK(d1->reevals - d0->reevals == 1);
+    CHECK(p.get_total_ticks() >= t1->ticks + d1->ticks);
+    CHECK(p.ticks_per_second() > 0.0);
+    CHECK(tb.doubled);
+
+    // Statistics accumulate across runs: 20 more clocks, 3 evals and 3 delta iterations each
+    // (but for the kick-start clock).
+    const pv::SimulationStats s1 = tb.get_statistics();
+    CHECK(s1.clocks == 30);
+    CHECK(s1.evals - s0.evals == 61);
+    CHECK(s1.delta_iterations - s0.delta_iterations == 59);
+    CHECK(s1.delta_depth.size() == 4);
+    CHECK(s1.delta_depth[3] - (s0.delta_depth.size() > 3 ? s0.delta_depth[3] : 0) == 19);
+    CHECK(s1.evals == t1->evals + d1->evals);
+    tb.reset_statistics();
+    CHECK(tb.get_statistics().clocks == 0);
+
+    // Report and exports name both modules.
+    std::ostringstream os;
+    p.report(os);
+    CHECK(os.str().find("tb.dbl") != std::string::npos);
+    CHECK(p.write_csv("check_profile.csv"));
+    CHECK(p.write_json("check_profile.json"));
+    std::ifstream csv("check_profile.csv");
+    std::string line;
+    int lines = 0;
+    while (std::getline(csv, line)) lines++;
+    CHECK(lines == 3);
+    std::remove("check_profile.csv");
+    std::remove("check_profile.json");
+
+    // Profiler::reset() clears the records.
+    p.reset();
+    CHECK(p.sorted_records().empty());
+}
+
+// A run left by an exception is stopped: the statistics no longer count wall time, the
+// profiler calibration covers the run, and a later run works.
+struct ThrowTB : public ProfileTB {
+    ThrowTB() : throw_at(3) {}
+    uint32_t throw_at;
+    void post_clock(const uint32_t clock_num) {
+        if (clock_num == throw_at) throw std::runtime_error("post_clock");
+    }
+};
+
+static void check_run_exception() {
+    ThrowTB tb;
+    pv::Profiler p;
+    tb.set_profiler(&p);
+    tb.set_cycle_limit(10);
+    bool threw = false;
+    try { tb.simulation(); }
+    catch (const std::runtime_error&) { threw = true; }
+    CHECK(threw);
+    const double wall = tb.get_statistics().wall_seconds;
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK(tb.get_statistics().wall_seconds == wall);
+    CHECK(p.ticks_per_second() > 0.0);
+
+    tb.throw_at = 0;
+    CHECK(tb.simulation(true) == SIM_CLOCK_LIMIT);
+    CHECK(tb.get_clock() == 10);
+    CHECK(tb.get_statistics().clocks == 10);
+    CHECK(tb.get_statistics().wall_seconds > wall);
+}
+
+static void check_activity() {
+    ProfileTB tb;
+    tb.set_activity_counting(true);
+    tb.set_cycle_limit(10);
+    tb.simulation();
+    const std::vector<pv::ActivityRecord> a0 = tb.get_activity_counters();
+    CHECK(a0.size() == 5);
+    if (a0.size() != 5) return;
+
+    tb.set_cycle_limit(30);
+    tb.simulation(true);
+    const std::vector<pv::ActivityRecord>& a1 = tb.get_activity_counters();
+
+    // cnt changes every clock.
+    CHECK(a1[0].NTG - a0[0].NTG == 20);
+    CHECK(a1[0].NTR - a0[0].NTR == 20);
+    CHECK(a1[0].NST == a0[0].NST);
+
+    // hold is written with its current value, twice per clock: static writes only.
+    CHECK(a1[1].NTR == 0 && a1[1].NTG == 0);
+    CHECK(a1[1].NST - a0[1].NST == 40);
+
+    // dbl.half (cnt / 2) is written once per clock (twice in the kick-start clock) and changes
+    // every other clock.
+    CHECK(a1[4].NTG - a0[4].NTG == 10);
+    CHECK(a1[4].NTR - a0[4].NTR == 10);
+    CHECK(a1[4].NST - a0[4].NST == 11);
+
+    std::ostringstream os;
+    tb.activity_report(os);
+    CHECK(os.str().find("tb.dbl.half") != std::string::npos);
+
+    // Counting off: counters stay put.
+    tb.set_activity_counting(false);
+    tb.set_cycle_limit(40);
+    tb.simulation(true);
+    CHECK(tb.get_activity_counters()[0].NTG == a1[0].NTG);
+    tb.reset_activity_counters();
+    CHECK(tb.get_activity_counters()[0].NTG == 0);
+}
+
+// A register type with only operator!= (and a VCD printer).
+struct Pair {
+    uint16_t a, b;
+    bool operator!=(const Pair& p) const { return a != p.a || b != p.b; }
+};
+
+namespace vcd {
+    template <>
+    struct value2string_t<Pair> : public value2string_base_t {
+        value2string_t(const Pair&) : value2string_base_t(32) {}
+        std::string operator()(const Pair& v, const bool add_b_prefix = true) const
+            { return value2string(((uint64_t) v.a << 16) | v.b, add_b_prefix); }
+    };
+}
+
+struct PairTB : public Testbench {
+    PairTB() : Testbench("tb") {}
+    Register<Pair> instance(p);
+    void main(int, char**) {}
+    void eval() {}
+    void post_clock(const uint32_t clock_num) {
+        const Pair v = { 1, (uint16_t) (clock_num / 4) };
+        p <= v;
+    }
+};
+
+static void check_struct_activity() {
+    PairTB tb;
+    tb.set_activity_counting(true);
+    tb.set_cycle_limit(12);
+    tb.simulation();
+
+    // Written in clocks 1 to 12; the writes of clocks 1 ('x' to a value), 4, and 8 change it
+    // at the next edge, the one of clock 12 is still pending, and the other 8 are static.
+    const std::vector<pv::ActivityRecord>& a = tb.get_activity_counters();
+    CHECK(a.size() == 1);
+    CHECK(a[0].NTG == 3 && a[0].NST == 8);
+}
+
+int main() {
+    check_profiler();
+    check_run_exception();
+    check_activity();
+    check_struct_activity();
+    return check_summary("check_profile");
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2023 Michael C Shebanow
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <fstream>
+#include "pv.h"
+#include "check.h"
+
+/*
+ * RegisterArray checks: element semantics (truncation, 'x' state, element to
+ * element copies), parent triggering, activity counting, reset, and the VCD
+ * dump of a reset to 'x'.
+ *
+ * The testbench runs a script by clock number: element writes staged in clock
+ * c are committed by the positive edge of clock c + 1 and so are first seen by
+ * post_clock(c + 1).
+ */
+
+class Bank : public Module {
+public:
+    Bank(const Module* p, const char* n) : Module(p, n), evals(0) {}
+    RegisterArray<uint32_t, 8> instance(regs, 0);
+    int evals;
+    void eval() { evals++; }
+};
+
+struct ArrayTB : public Testbench {
+    ArrayTB() : Testbench("tb") {}
+    RegisterArray<uint32_t, 70, 8> instance(rf);
+    RegisterArray<uint16_t, 3> instance(z, 5);
+    Bank instance(bank);
+
+    struct Seen { bool rf0_x, rf66_x, rf69_x; uint32_t rf0, rf1, rf69, bank3; int bank_evals; };
+    std::vector<Seen> seen;
+
+    void main(int, char**) {}
+    void eval() {
+        force_eval_next_clock();
+        switch (get_clock()) {
+        case 1:
+            rf[0] <= 0x1ff;             // truncated to 8 bits
+            rf[1] <= 7;
+            rf[66] <= 3;
+            break;
+        case 2:
+            rf[69] <= rf[0];            // element to element copy
+            rf[66] <= rf[68];           // copying an 'x' element
+            bank.regs[3] <= 9;
+            break;
+        case 3:
+            bank.regs[3] <= 9;          // unchanged: the bank is not triggered
+            z[1] <= (uint16_t) z[1];
+            break;
+        }
+    }
+    void pre_clock(const uint32_t clock_num) {
+        if (clock_num == 6) reset_to_instance_state();
+    }
+    void post_clock(const uint32_t) {
+        Seen s = { rf.value_is_x(0), rf.value_is_x(66), rf.value_is_x(69), rf.q(0), rf.q(1), rf.q(69),
+            bank.regs.q(3), bank.evals };
+        seen.push_back(s);
+    }
+};
+
+static void check_register_array(const bool counting) {
+    ArrayTB tb;
+    tb.set_activity_counting(counting);
+    CHECK(tb.rf.value_is_x(5) && tb.z.q(2) == 5);
+    tb.set_cycle_limit(7);
+    tb.simulation();
+    CHECK(tb.seen.size() == 7);
+    if (tb.seen.size() != 7) return;
+
+    CHECK(tb.seen[0].rf0_x && tb.seen[0].rf69_x);
+    CHECK(!tb.seen[1].rf0_x && tb.seen[1].rf0 == 0xff && tb.seen[1].rf1 == 7 && !tb.seen[1].rf66_x);
+    CHECK(!tb.seen[2].rf69_x && tb.seen[2].rf69 == 0xff && tb.seen[2].rf66_x);
+    CHECK(tb.seen[2].bank3 == 9);
+
+    // The bank is evaluated by the kick-start, when its array changes (clock 3), and when
+    // the reset in clock 6 changes it back.
+    CHECK(tb.seen[0].bank_evals == 1);
+    CHECK(tb.seen[2].bank_evals == 2);
+    CHECK(tb.seen[4].bank_evals == 2);
+    CHECK(tb.seen[5].bank_evals == 3 && tb.seen[5].bank3 == 0);
+    CHECK(tb.seen[6].bank_evals == 3);
+    CHECK(tb.seen[5].rf0_x && tb.seen[5].rf69_x);
+
+    // Activity counters count each element: rf[0] changed at clocks 2 and 6 (reset to 'x').
+    if (counting) {
+        const std::vector<pv::ActivityRecord>& a = tb.get_activity_counters();
+        CHECK(a.size() == 70 + 3 + 8);
+        CHECK(a[0].NTG == 2 && a[1].NTG == 2 && a[2].NTG == 0);
+        CHECK(a[70 + 1].NST == 1 && a[70 + 1].NTG == 0);
+        CHECK(a[73 + 3].NTG == 2);
+    }
+
+    bool threw = false;
+    try { tb.rf.q(70); }
+    catch (const std::out_of_range&) { threw = true; }
+    CHECK(threw);
+}
+
+// An array reset to 'x' before the positive edge of clock 2; rf[4] written for clock 3.
+struct XTB : public Testbench {
+    XTB() : Testbench("tb") {}
+    RegisterArray<uint32_t, 10> instance(rf, 0);
+    Register<uint8_t> instance(after, 1);  // VCD ID and activity counter next to rf[9]
+
+    void main(int, char**) {}
+    void eval() {}
+    void pre_clock(const uint32_t clock_num) { if (clock_num == 2) rf.reset_to_x(); }
+    void post_clock(const uint32_t clock_num) { if (clock_num == 2) rf[4] <= 6; }
+};
+
+// The value changes (other than the clock's) of a VCD dump at #<time>.
+static std::vector<std::string> vcd_changes_at(const std::string& file, const std::string& time) {
+    std::ifstream is(file.c_str());
+    std::vector<std::string> changes;
+    std::string line;
+    bool in = false;
+    while (std::getline(is, line)) {
+        if (line[0] == '#') in = line == "#" + time;
+        else if (in && line[0] != '$' && line.find(' ') != std::string::npos) changes.push_back(line);
+    }
+    return changes;
+}
+
+// Every element is dumped as 'x' at the edge after the reset, and only the elements: the
+// change mask holds no bits past the last element.
+static void check_vcd_reset_to_x() {
+    const char* vcd_file = "check_register_array.vcd";
+    {
+        XTB tb;
+        vcd::writer w(vcd_file);
+        tb.set_vcd_writer(&w);
+        tb.set_activity_counting(true);
+        tb.set_cycle_limit(5);
+        tb.simulation();
+        CHECK(tb.rf.value_is_x(0) && !tb.rf.value_is_x(4) && tb.rf.q(4) == 6);
+
+        // Activity: each element toggled once (to 'x'), rf[4] twice.
+        const std::vector<pv::ActivityRecord>& a = tb.get_activity_counters();
+        CHECK(a[0].NTG == 1 && a[9].NTG == 1 && a[4].NTG == 2 && a[10].NTG == 0);
+    }
+    const std::vector<std::string> at2 = vcd_changes_at(vcd_file, "4");
+    CHECK(at2.size() == 10);
+    int xs = 0;
+    for (size_t i = 0; i < at2.size(); i++) xs += at2[i][0] == 'b' && at2[i][1] == 'x';
+    CHECK(xs == 10);
+    CHECK(vcd_changes_at(vcd_file, "6").size() == 1);
+    CHECK(vcd_changes_at(vcd_file, "8").empty());
+    std::remove(vcd_file);
+}
+
+int main() {
+    check_register_array(false);
+    check_register_array(true);
+    check_vcd_reset_to_x();
+    return check_summary("check_register_array");
+}
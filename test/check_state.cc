@@ -0,0 +1,324 @@
+/*
+ * Copyright (c) 2023 Michael C Shebanow
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include "pv.h"
+#include "check.h"
+
+/*
+ * Simulation state checks: a checkpoint restored into a fresh testbench, and a
+ * snapshot rewound to, continue exactly as the uninterrupted run did; damaged
+ * or mismatched checkpoint files are refused without changing any state; and
+ * the batched reset plan leaves the same state as the recursive reset walk.
+ */
+
+static const char* ckpt_file = "check_state.ckpt";
+static const char* state_file = "check_state_now.ckpt";
+static const char* bad_file = "check_state_bad.ckpt";
+
+// A design with a state of every kind: wires, registers, a dense and a sparse memory, a FIFO,
+// and a register array.
+class Dut : public Module {
+public:
+    Dut(const Module* p, const char* n) : Module(p, n) {}
+    Input<uint32_t> instance(in);
+    Output<uint32_t> instance(out);
+    Register<uint32_t> instance(acc, 7);
+    Memory<uint32_t, 64> instance(mem);
+    Memory<uint64_t, (1ull << 30)> instance(big);
+    Fifo<uint16_t, 4> instance(f);
+    RegisterArray<uint32_t, 70> instance(ra, 1);
+    Wire<uint32_t> instance(w);
+    void eval() {
+        w = in * 3 + 1;
+        acc <= (uint32_t) acc * 1103515245u + w;
+        mem.write(acc % 64, acc);
+        big.write(((uint64_t) acc * 4099) % (1ull << 30), acc);
+        mem.read_sync(in % 64);
+        if (acc & 1) f.push(acc & 0xffff);
+        if (acc & 2) f.pop();
+        ra[acc % 70] <= (uint32_t) ra[(acc >> 8) % 70] + acc;
+        out = acc ^ (f.empty() ? 0 : f.front()) ^ mem.q() ^ (uint32_t) ra[5] ^
+            (uint32_t) big.read(((uint64_t) in * 4099) % (1ull << 30));
+    }
+};
+
+// Logs the output every clock; optionally takes a snapshot every 5 clocks.
+struct StateTB : public Testbench {
+    StateTB() : Testbench("tb"), snap(false) {}
+    Dut instance(dut);
+    Register<uint32_t> instance(r, 0);
+    std::ostringstream log;
+    bool snap;
+    std::vector<pv::SnapshotHandle> handles;
+
+    void main(int, char**) {}
+    void eval() { dut.in = r; }
+    void post_clock(const uint32_t clock_num) {
+        r <= r + 5;
+        log << clock_num << " " << (uint32_t) dut.out << " " << dut.f.count() << "\n";
+        if (snap && clock_num % 5 == 0) handles.push_back(snapshot());
+    }
+};
+
+// A different design under the same top-level name.
+struct OtherTB : public Testbench {
+    OtherTB() : Testbench("tb") {}
+    Register<int> instance(q);
+    void main(int, char**) {}
+    void eval() {}
+};
+
+// The lines of a log after clock c.
+static std::string log_after(const std::string& log, const uint32_t c) {
+    if (c == 0) return log;
+    std::ostringstream key;
+    key << "\n" << (c + 1) << " ";
+    const size_t at = log.find(key.str());
+    return at == std::string::npos ? std::string() : log.substr(at + 1);
+}
+
+static std::string read_file(const char* name) {
+    std::ifstream is(name, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+}
+
+static void write_file(const char* name, const std::string& s) {
+    std::ofstream os(name, std::ios::binary | std::ios::trunc);
+    os.write(s.data(), s.size());
+}
+
+// The state of a testbench, as saved in a checkpoint.
+static std::string state_of(const Testbench& tb) {
+    tb.save_checkpoint(state_file);
+    return read_file(state_file);
+}
+
+static std::string reference_log() {
+    StateTB tb;
+    tb.set_cycle_limit(40);
+    tb.simulation();
+    return tb.log.str();
+}
+
+static void check_checkpoints(const std::string& reference) {
+    std::string saved;
+    {
+        StateTB tb;
+        tb.set_cycle_limit(20);
+        tb.simulation();
+        CHECK(tb.save_checkpoint(ckpt_file));
+        saved = read_file(ckpt_file);
+    }
+
+    // Restored into a fresh testbench, the run continues as it did uninterrupted.
+    StateTB tb;
+    CHECK(tb.restore_checkpoint(ckpt_file));
+    CHECK(tb.get_clock() == 20);
+    CHECK(state_of(tb) == saved);
+    tb.set_cycle_limit(40);
+    tb.simulation(true);
+    CHECK(tb.log.str() == log_after(reference, 20));
+    const std::string at40 = state_of(tb);
+
+    // Files that cannot be restored are refused, with a message, and leave the state as it was.
+    {
+        CaptureCerr err;
+        CHECK(!tb.restore_checkpoint("check_state_missing.ckpt"));
+        CHECK(err.str().find("No such file or directory") != std::string::npos);
+    }
+    CHECK(state_of(tb) == at40);
+    {
+        CaptureCerr err;
+        write_file(bad_file, saved.substr(0, 10));
+        CHECK(!tb.restore_checkpoint(bad_file));
+        CHECK(err.str().find("not a checkpoint file") != std::string::npos);
+    }
+    CHECK(state_of(tb) == at40);
+    {
+        CaptureCerr err;
+        write_file(bad_file, std::string(saved.size(), 'x'));
+        CHECK(!tb.restore_checkpoint(bad_file));
+    }
+    CHECK(state_of(tb) == at40);
+    {
+        CaptureCerr err;
+        write_file(bad_file, saved.substr(0, saved.size() - 3));
+        CHECK(!tb.restore_checkpoint(bad_file));
+        CHECK(err.str().find("checkpoint is truncated or corrupt") != std::string::npos);
+    }
+    CHECK(state_of(tb) == at40);
+
+    // Every truncation is refused.
+    {
+        CaptureCerr err;
+        bool refused = true;
+        for (size_t n = 0; n < saved.size(); n += 1 + saved.size() / 97) {
+            write_file(bad_file, saved.substr(0, n));
+            refused = refused && !tb.restore_checkpoint(bad_file);
+        }
+        CHECK(refused);
+    }
+    CHECK(state_of(tb) == at40);
+
+    // A corrupt byte anywhere is either refused, leaving the state unchanged, or restored as
+    // some other valid state; it never crashes, throws, or half-restores. Every byte of the
+    // header and the first signal states is tried, then a sample of the rest.
+    {
+        CaptureCerr err;
+        CHECK(tb.restore_checkpoint(ckpt_file));
+        bool unchanged = true;
+        int refusals = 0;
+        for (size_t i = 0; i < saved.size(); i += (i < 256 ? 1 : 1 + saved.size() / 61)) {
+            std::string bad = saved;
+            bad[i] = ~bad[i];
+            write_file(bad_file, bad);
+            if (tb.restore_checkpoint(bad_file))
+                unchanged = unchanged && tb.restore_checkpoint(ckpt_file);
+            else
+                refusals++;
+            unchanged = unchanged && state_of(tb) == saved;
+        }
+        CHECK(unchanged);
+        CHECK(refusals > 0);
+    }
+
+    // A checkpoint of a different design is refused.
+    {
+        CaptureCerr err;
+        OtherTB other;
+        CHECK(!other.restore_checkpoint(ckpt_file));
+        CHECK(err.str().find("checkpoint does not match the design") != std::string::npos);
+    }
+    std::remove(ckpt_file);
+    std::remove(state_file);
+    std::remove(bad_file);
+}
+
+static void check_snapshots(const std::string& reference) {
+    StateTB tb;
+    tb.snap = true;
+    tb.handles.push_back(tb.snapshot());
+    tb.set_cycle_limit(40);
+    tb.simulation();
+    tb.snap = false;
+    CHECK(tb.log.str() == reference);
+    CHECK(tb.snapshot_count() == 9);
+    CHECK(tb.snapshot_clock(4) == 20);
+
+    // Rewinding discards the later snapshots but keeps the one rewound to.
+    const pv::SnapshotHandle order[] = { 4, 2, 2, 0 };
+    const size_t counts[] = { 5, 3, 3, 1 };
+    for (size_t i = 0; i < 4; i++) {
+        tb.log.str("");
+        tb.rewind(order[i]);
+        const uint32_t c = tb.get_clock();
+        CHECK(c == 5 * order[i]);
+        tb.simulation(true);
+        CHECK(tb.log.str() == log_after(reference, c));
+        CHECK(tb.snapshot_count() == counts[i]);
+    }
+
+    bool threw = false;
+    try { tb.rewind(7); }
+    catch (const std::out_of_range&) { threw = true; }
+    CHECK(threw);
+    tb.clear_snapshots();
+    CHECK(tb.snapshot_count() == 0);
+}
+
+// Fifty submodules of several signal types, for the reset plan.
+class Sub : public Module {
+public:
+    Sub(const Module* p, const std::string& n) : Module(p, n) {}
+    Input<uint32_t> instance(a);
+    Output<uint8_t, 4> instance(o, 3);
+    QWire<uint16_t> instance(q);
+    Wire<bool> instance(k, true);
+    Register<uint32_t> instance(cnt, 1);
+    Fifo<uint8_t, 2> instance(f);
+    void eval() {
+        o = a + cnt;
+        q = a * 7;
+        k = (a & 1);
+        cnt <= cnt + a;
+        if (a & 2) f.push(a);
+        else f.pop();
+    }
+};
+
+struct ResetTB : public Testbench {
+    ResetTB() : Testbench("tb") {
+        for (int i = 0; i < 50; i++) {
+            std::ostringstream name;
+            name << "s" << i;
+            subs.push_back(std::unique_ptr<Sub>(new Sub(this, name.str())));
+        }
+    }
+    Register<uint32_t> instance(r, 0);
+    Wire<uint32_t> instance(x);
+    std::vector<std::unique_ptr<Sub> > subs;
+    std::ostringstream log;
+
+    void main(int, char**) {}
+    void eval() {
+        for (size_t i = 0; i < subs.size(); i++) subs[i]->a = r + i;
+        x = r;
+    }
+    void post_clock(const uint32_t clock_num) {
+        r <= r + 3;
+        uint32_t h = 0;
+        for (size_t i = 0; i < subs.size(); i++)
+            h = h * 31 + (uint8_t) subs[i]->o + (uint32_t) subs[i]->cnt + subs[i]->f.count();
+        log << clock_num << " " << h << "\n";
+    }
+};
+
+// Reset with activity counting off (the reset plan) and on (the recursive walk) several times,
+// once with a design input forced between the reset and the next run.
+static void check_reset_plan() {
+    ResetTB plan, walk;
+    walk.set_activity_counting(true);
+    bool same_state = true;
+    ResetTB* tbs[] = { &plan, &walk };
+    for (int t = 0; t < 4; t++) {
+        for (int i = 0; i < 2; i++) {
+            ResetTB& tb = *tbs[i];
+            if (t) tb.reset_to_instance_state();
+            if (t == 2) tb.subs[7]->a = 99;
+        }
+        same_state = same_state && state_of(plan) == state_of(walk);
+        for (int i = 0; i < 2; i++) {
+            tbs[i]->set_cycle_limit(tbs[i]->get_clock() + 10);
+            tbs[i]->simulation(t != 0);
+        }
+        same_state = same_state && state_of(plan) == state_of(walk);
+    }
+    CHECK(same_state);
+    CHECK(plan.log.str() == walk.log.str());
+    CHECK(plan.get_statistics().wire_writes == walk.get_statistics().wire_writes);
+    CHECK(plan.get_statistics().register_updates == walk.get_statistics().register_updates);
+    std::remove(state_file);
+}
+
+int main() {
+    const std::string reference = reference_log();
+    check_checkpoints(reference);
+    check_snapshots(reference);
+    check_reset_plan();
+    return check_summary("check_state");
+}
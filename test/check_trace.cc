@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2023 Michael C Shebanow
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <fstream>
+#include <iterator>
+#include "pv.h"
+#include "check.h"
+
+/*
+ * Trace-event checks: a run records one complete event per sampled clock,
+ * with its phases, delta iterations, and module evaluations nested in it,
+ * instance names are escaped as JSON strings, and the file is a complete JSON
+ * document once the writer is destroyed.
+ */
+
+static const char* trace_file = "check_trace.json";
+
+class Inc : public Module {
+public:
+    Inc(const Module* p, const char* n) : Module(p, n) {}
+    Input<uint32_t> instance(in);
+    Output<uint32_t> instance(out);
+    void eval() { out = in + 1; }
+};
+
+// The second incrementer has a name that has to be escaped in JSON.
+struct TraceTB : public Testbench {
+    TraceTB() : Testbench("tb"), odd(this, "odd\"\\\tname") {}
+    Register<uint32_t> instance(cnt, 0);
+    Inc instance(inc);
+    Inc odd;
+    void main(int, char**) {}
+    void eval() { inc.in = cnt; odd.in = cnt; }
+    void post_clock(const uint32_t) { cnt <= inc.out; }
+};
+
+static std::string read_file(const char* name) {
+    std::ifstream is(name);
+    return std::string(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+}
+
+static int count(const std::string& s, const std::string& what) {
+    int n = 0;
+    for (size_t at = s.find(what); at != std::string::npos; at = s.find(what, at + 1)) n++;
+    return n;
+}
+
+static void check_trace_events() {
+    uint64_t events = 0;
+    {
+        pv::TraceEventWriter w(trace_file);
+        CHECK(w.is_open());
+        w.set_sample_interval(4);
+        CHECK(w.is_sampled(8) && !w.is_sampled(9));
+        TraceTB tb;
+        tb.set_trace_event_writer(&w);
+        tb.set_cycle_limit(10);
+        tb.simulation();
+        events = w.get_num_events();
+    }
+    const std::string json = read_file(trace_file);
+    std::remove(trace_file);
+
+    // Clocks 4 and 8 are sampled: each has a clock event, its phases, its three delta
+    // iterations, and its evaluations.
+    CHECK(json.compare(0, 31, "{\"displayTimeUnit\": \"ns\", \"trac") == 0);
+    CHECK(json.size() > 3 && json.compare(json.size() - 3, 3, "]}\n") == 0);
+    CHECK((uint64_t) count(json, "\"ph\": \"X\"") == events);
+    CHECK(count(json, "{\"name\": \"clock\"") == 2);
+    CHECK(count(json, "{\"name\": \"pre_clock\"") == 2);
+    CHECK(count(json, "{\"name\": \"post_clock\"") == 2);
+    CHECK(count(json, "{\"name\": \"delta ") == 6 && count(json, "{\"name\": \"delta 3\"") == 2);
+    CHECK(count(json, "{\"name\": \"tb.inc\"") >= 2);
+    CHECK(count(json, "{\"name\": \"tb.odd\\\"\\\\\\u0009name\"") >= 2);
+    CHECK(count(json, "\"args\": {\"clock\": 4}") + count(json, "\"args\": {\"clock\": 8}") == (int) events);
+
+    // A file that cannot be written is reported, and nothing is recorded.
+    CaptureCerr err;
+    pv::TraceEventWriter bad("no_such_directory/check_trace.json");
+    CHECK(!bad.is_open() && !bad.is_sampled(0));
+    CHECK(err.str().find("No such file or directory") != std::string::npos);
+    TraceTB tb;
+    tb.set_trace_event_writer(&bad);
+    tb.set_cycle_limit(3);
+    tb.simulation();
+    CHECK(bad.get_num_events() == 0);
+}
+
+int main() {
+    check_trace_events();
+    return check_summary("check_trace");
+}
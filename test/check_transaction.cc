@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2023 Michael C Shebanow
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "pv.h"
+#include "check.h"
+
+/*
+ * Transaction-level port checks: the SPSC queue, and a driver, monitor, and
+ * checker around a pipelined adder. Every transaction is driven once, in
+ * order, one per clock; every result is observed and checked once, in order;
+ * and the counts of driven, pending, observed, checked, and failed
+ * transactions add up, across runs, also with a queue small enough that the
+ * monitor has to wait for the checker; and a monitor has one checker at a
+ * time.
+ */
+
+static void check_queue() {
+    pv::SpscQueue<int> q(5);
+    CHECK(q.capacity() == 8 && q.empty());
+    int n = 0;
+    while (q.push(n)) n++;
+    CHECK(n == 8 && q.size() == 8);
+    int v = -1;
+    bool in_order = true;
+    for (int i = 0; i < 3; i++) in_order = in_order && q.pop(v) && v == i;
+    CHECK(in_order);
+    CHECK(q.push(100) && q.size() == 6);
+    for (int i = 3; i < 8; i++) in_order = in_order && q.pop(v) && v == i;
+    CHECK(in_order && q.pop(v) && v == 100);
+    CHECK(!q.pop(v) && q.empty());
+    CHECK(!q.is_closed());
+    q.close();
+    CHECK(q.is_closed());
+}
+
+struct Req {
+    uint32_t a, b;
+    bool valid;
+};
+struct Resp {
+    uint32_t clock, sum;
+};
+
+// A registered adder: sum = a + b two edges after valid.
+class Adder : public Module {
+public:
+    Adder(const Module* p, const char* n) : Module(p, n) {}
+    Input<uint32_t> instance(a, 0);
+    Input<uint32_t> instance(b, 0);
+    Input<bool> instance(valid, false);
+    Register<uint32_t> instance(sum_q, 0);
+    Register<bool> instance(valid_q, false);
+    Output<uint32_t> instance(sum);
+    Output<bool> instance(out_valid);
+    void eval() {
+        if (valid) sum_q <= a + b;
+        valid_q <= valid;
+        sum = sum_q;
+        out_valid = valid_q;
+    }
+};
+
+struct TransactionTB : public Testbench {
+    TransactionTB(const size_t capacity) : Testbench("tb"), idles(0),
+        drv(this, "drv", [this](const Req& r) { dut.a = r.a; dut.b = r.b; dut.valid = r.valid; },
+            [this]() { dut.valid = false; idles++; }),
+        mon(this, [this](Resp& r) {
+            if (!dut.out_valid) return false;
+            r.clock = get_clock();
+            r.sum = dut.sum;
+            return true;
+        }, capacity) {}
+    Adder instance(dut);
+    uint32_t idles;
+    TransactionDriver<Req> drv;
+    pv::TransactionMonitor<Resp> mon;
+    void main(int, char**) {}
+    void eval() {}
+};
+
+static void check_ports(const size_t capacity) {
+    const uint32_t n = 5000;
+    TransactionTB tb(capacity);
+    std::vector<Req> reqs;
+    for (uint32_t i = 0; i < n; i++) {
+        const Req r = { i, 3 * i, (i % 5) != 4 };
+        reqs.push_back(r);
+    }
+    tb.drv.push(reqs.begin(), reqs.end());
+    CHECK(tb.drv.pending() == n && tb.drv.get_driven() == 0);
+
+    // Results of valid requests, in order: transaction i is driven in clock i + 1, and its sum
+    // is registered at the next edge and observed in clock i + 2. One expected value is wrong.
+    std::vector<Resp> expect;
+    for (uint32_t i = 0; i < n; i++)
+        if (reqs[i].valid) {
+            const Resp r = { i + 2, 4 * i };
+            expect.push_back(r);
+        }
+    expect.push_back(Resp{ n + 2, 2 });
+    expect[777].sum ^= 1;
+    pv::TransactionChecker<Resp> chk(tb.mon, [&expect](const Resp& r, const uint64_t k) {
+        return k < expect.size() && r.sum == expect[k].sum && r.clock == expect[k].clock;
+    });
+
+    // While the checker runs, the design cannot be forked.
+    bool threw = false;
+    try { tb.fork_branches(1, [](const uint32_t, std::ostream&) { return 0; }); }
+    catch (const std::logic_error&) { threw = true; }
+    CHECK(threw);
+
+    tb.set_cycle_limit(n / 2);
+    tb.simulation();
+    CHECK(tb.drv.get_driven() == n / 2);
+    CHECK(tb.drv.pending() == n - n / 2);
+
+    // Appended between runs: driven after the others, in clock n + 1.
+    tb.drv.push(Req{ 1, 1, true });
+    tb.set_cycle_limit(n + 10);
+    tb.simulation(true);
+    chk.finish();
+    CHECK(tb.drv.get_driven() == n + 1 && tb.drv.pending() == 0);
+    // The driver is evaluated only while it has work: it idled once, when its queue ran dry.
+    CHECK(tb.idles == 1);
+    CHECK(tb.mon.get_observed() == expect.size());
+    CHECK(chk.get_checked() == expect.size());
+    CHECK(chk.get_failures() == 1);
+
+    // Once the checker has finished, forking is allowed again; clear() drops what is pending.
+    std::vector<pv::BranchResult> res = tb.fork_branches(1, [](const uint32_t, std::ostream&) { return 3; });
+    CHECK(res.size() == 1 && res[0].completed && res[0].exit_code == 3);
+    tb.drv.push(reqs.begin(), reqs.begin() + 10);
+    tb.drv.clear();
+    CHECK(tb.drv.pending() == 0);
+    tb.set_cycle_limit(n + 20);
+    tb.simulation(true);
+
+    // Nothing more is driven; the kick-start of the run idled the driver once more.
+    CHECK(tb.drv.get_driven() == n + 1);
+    CHECK(tb.idles == 2);
+}
+
+// A monitor has one checker at a time; a later checker continues with the transactions observed
+// since, and a monitor left without a checker fails when its queue fills up.
+static void check_checkers() {
+    TransactionTB tb(4);
+    uint64_t first = 0, second = 0;
+    for (uint32_t i = 0; i < 10; i++) tb.drv.push(Req{ i, i, true });
+    {
+        pv::TransactionChecker<Resp> chk(tb.mon,
+            [](const Resp& r, const uint64_t k) { return r.sum == 2 * k; });
+        bool threw = false;
+        try { pv::TransactionChecker<Resp> again(tb.mon, [](const Resp&, const uint64_t) { return true; }); }
+        catch (const std::logic_error&) { threw = true; }
+        CHECK(threw);
+        tb.set_cycle_limit(20);
+        tb.simulation();
+        chk.finish();
+        first = chk.get_checked();
+        CHECK(first == 10 && chk.get_failures() == 0);
+    }
+
+    // Three transactions observed with no checker wait in the queue for the next one.
+    for (uint32_t i = 10; i < 13; i++) tb.drv.push(Req{ i, i, true });
+    tb.set_cycle_limit(40);
+    tb.simulation(true);
+    CHECK(tb.mon.get_queue().size() == 3);
+    {
+        pv::TransactionChecker<Resp> chk(tb.mon,
+            [](const Resp& r, const uint64_t k) { return r.sum == 2 * (k + 10); });
+        for (uint32_t i = 13; i < 30; i++) tb.drv.push(Req{ i, i, true });
+        tb.set_cycle_limit(60);
+        tb.simulation(true);
+        chk.finish();
+        second = chk.get_checked();
+        CHECK(second == 20 && chk.get_failures() == 0);
+    }
+    CHECK(tb.mon.get_observed() == first + second);
+
+    // Without a checker, the fifth transaction finds the queue full.
+    for (uint32_t i = 0; i < 10; i++) tb.drv.push(Req{ i, i, true });
+    tb.set_cycle_limit(80);
+    bool threw = false;
+    try { tb.simulation(true); }
+    catch (const std::logic_error&) { threw = true; }
+    CHECK(threw);
+    CHECK(tb.mon.get_observed() == first + second + 4);
+}
+
+int main() {
+    check_queue();
+    check_ports(4096);
+    check_ports(4);
+    check_checkers();
+    return check_summary("check_transaction");
+}
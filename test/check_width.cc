@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2023 Michael C Shebanow
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "pv.h"
+#include "check.h"
+
+/*
+ * Declared width checks: integral and enum values assigned to a wire or a
+ * register of width W are truncated to W bits (unsigned), including the
+ * initializer; a write that truncates to the current value is not a change;
+ * and the width is a compile-time constant of the signal type.
+ */
+
+enum Op { OP_ADD = 1, OP_SUB = 6, OP_BIG = 13 };
+
+static_assert(Wire<uint32_t, 4>::width == 4, "declared wire width");
+static_assert(Wire<uint16_t>::width == 16, "inferred wire width");
+static_assert(Register<bool>::width == 1, "bool register width");
+static_assert(pv::width_mask<int8_t, 3>::mask == 7, "mask of a signed type");
+
+// Counts its evaluations: one per change of its 4-bit input.
+class Sink : public Module {
+public:
+    Sink(const Module* p, const char* n) : Module(p, n), evals(0) {}
+    Input<uint8_t, 4> instance(in);
+    int evals;
+    void eval() { evals++; }
+};
+
+struct WidthTB : public Testbench {
+    WidthTB() : Testbench("tb") {}
+    Wire<uint32_t, 12> instance(w);
+    Wire<Op, 3> instance(op);
+    Register<int8_t, 3> instance(r, -1);
+    Register<uint64_t, 40> instance(wide, ~0ull);
+    Register<uint32_t, 8> instance(from);
+    Register<uint16_t, 4> instance(to);
+    Register<double, 4> instance(real, 2.5);
+    Sink instance(sink);
+
+    void main(int, char**) {}
+    void eval() {}
+    void pre_clock(const uint32_t clock_num) {
+        switch (clock_num) {
+        case 1:
+            sink.in = 0x1f;
+            from <= 0x3ab;
+            break;
+        case 2:
+            sink.in = 0x2f;             // same 4 bits: not a change
+            to <= from;                 // cross-type <= reads the register's current value
+            break;
+        case 3:
+            sink.in = 0x10;             // truncates to 0
+            r <= -3;
+            wide <= wide + 1;
+            break;
+        }
+    }
+};
+
+static void check_truncation() {
+    WidthTB tb;
+
+    // Initializers are truncated; W does not apply to non-integral types.
+    CHECK((int) tb.r == 7 && tb.r.get_width() == 3);
+    CHECK((uint64_t) tb.wide == 0xffffffffffull);
+    CHECK((double) tb.real == 2.5);
+
+    tb.w = 0x12345;
+    CHECK((uint32_t) tb.w == 0x345);
+    tb.op = OP_BIG;
+    CHECK(tb.op == OP_SUB - 1);
+    tb.op = OP_SUB;
+    CHECK(tb.op == OP_SUB);
+
+    tb.set_cycle_limit(4);
+    tb.simulation();
+    CHECK((uint8_t) tb.sink.in == 0);
+    CHECK((uint32_t) tb.from == 0xab);
+    CHECK((uint16_t) tb.to == 0xb);
+    CHECK((int) tb.r == 5);
+    CHECK((uint64_t) tb.wide == 0);
+
+    // Evaluated in clock 1 (the kick-start) and on the change in clock 3, but not in clock 2.
+    CHECK(tb.sink.evals == 2);
+}
+
+int main() {
+    check_truncation();
+    return check_summary("check_width");
+}